@@ -0,0 +1,234 @@
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+#include "cpu/cartridge.h"
+#include "cpu/cpu.h"
+#include "cpu/gameboy.h"
+#include "cpu/memory.h"
+#include "util/units.h"
+
+#include "perfcounters.h"
+
+namespace {
+
+// Micro-benchmark programs repeat one block of instructions up to ProgramEnd
+// and jump back to 0. Calls go to a RET at Subroutine.
+const size_t ProgramEnd = 0x7F00;
+const gb::Word Subroutine = 0x7FF0;
+
+// Clock cycles each macro-benchmark iteration runs for
+const uint64_t MacroCycles = 1 << 20;
+
+const std::vector<gb::Byte> Loads = {
+    0x78,               // LD A,B
+    0x41,               // LD B,C
+    0x7E,               // LD A,(HL)
+    0x77,               // LD (HL),A
+    0x3E, 0x12,         // LD A,0x12
+    0x0A,               // LD A,(BC)
+    0x12,               // LD (DE),A
+    0xF0, 0x80,         // LDH A,(0x80)
+    0xE0, 0x81,         // LDH (0x81),A
+    0x01, 0x00, 0xC1,   // LD BC,0xC100
+};
+
+const std::vector<gb::Byte> Alu8 = {
+    0x80,               // ADD A,B
+    0x91,               // SUB C
+    0xA2,               // AND D
+    0xAB,               // XOR E
+    0xB4,               // OR H
+    0xBD,               // CP L
+    0x3C,               // INC A
+    0x0D,               // DEC C
+    0x8F,               // ADC A,A
+    0x9A,               // SBC A,D
+    0xC6, 0x05,         // ADD A,0x05
+    0xFE, 0x10,         // CP 0x10
+    0x86,               // ADD A,(HL)
+    0x27,               // DAA
+    0x2F,               // CPL
+};
+
+const std::vector<gb::Byte> Alu16 = {
+    0x09,               // ADD HL,BC
+    0x13,               // INC DE
+    0x1B,               // DEC DE
+    0x29,               // ADD HL,HL
+    0x03,               // INC BC
+    0x0B,               // DEC BC
+    0x39,               // ADD HL,SP
+    0xE8, 0x02,         // ADD SP,2
+    0xE8, 0xFE,         // ADD SP,-2
+    0xF8, 0x04,         // LD HL,SP+4
+};
+
+const std::vector<gb::Byte> CbRotates = {
+    0xCB, 0x00,         // RLC B
+    0xCB, 0x09,         // RRC C
+    0xCB, 0x12,         // RL D
+    0xCB, 0x1B,         // RR E
+    0xCB, 0x20,         // SLA B
+    0xCB, 0x29,         // SRA C
+    0xCB, 0x37,         // SWAP A
+    0xCB, 0x3F,         // SRL A
+    0xCB, 0x47,         // BIT 0,A
+    0xCB, 0xC7,         // SET 0,A
+    0xCB, 0x87,         // RES 0,A
+    0xCB, 0x06,         // RLC (HL)
+};
+
+const std::vector<gb::Byte> Branches = {
+    0x18, 0x00,         // JR +0
+    0x20, 0x00,         // JR NZ,+0
+    0x28, 0x00,         // JR Z,+0
+    0x30, 0x00,         // JR NC,+0
+    0x38, 0x00,         // JR C,+0
+    0xCD, 0xF0, 0x7F,   // CALL Subroutine
+    0xC4, 0xF0, 0x7F,   // CALL NZ,Subroutine
+    0xCC, 0xF0, 0x7F,   // CALL Z,Subroutine
+};
+
+// Guest loops, each starting at 0x150 and running forever
+
+// Copies 256 bytes from 0xC000 to 0xC100
+const std::vector<gb::Byte> Memcpy = {
+    0x21, 0x00, 0xC0,   // start: LD HL,0xC000
+    0x11, 0x00, 0xC1,   //        LD DE,0xC100
+    0x06, 0x00,         //        LD B,0
+    0x2A,               // loop:  LD A,(HL+)
+    0x12,               //        LD (DE),A
+    0x13,               //        INC DE
+    0x05,               //        DEC B
+    0x20, 0xFA,         //        JR NZ,loop
+    0x18, 0xF0,         //        JR start
+};
+
+// 16-bit sum of ROM bank 0 into HL
+const std::vector<gb::Byte> Checksum = {
+    0x01, 0x00, 0x00,   // start: LD BC,0x0000
+    0x21, 0x00, 0x00,   //        LD HL,0x0000
+    0x0A,               // loop:  LD A,(BC)
+    0x85,               //        ADD A,L
+    0x6F,               //        LD L,A
+    0x7C,               //        LD A,H
+    0xCE, 0x00,         //        ADC A,0
+    0x67,               //        LD H,A
+    0x03,               //        INC BC
+    0x78,               //        LD A,B
+    0xFE, 0x40,         //        CP 0x40
+    0x20, 0xF3,         //        JR NZ,loop
+    0x18, 0xEB,         //        JR start
+};
+
+// Fills 0xC000-0xC01F in descending order and bubble sorts it ascending
+const std::vector<gb::Byte> BubbleSort = {
+    0x21, 0x00, 0xC0,   // start:  LD HL,0xC000
+    0x06, 0x20,         //         LD B,32
+    0x78,               // fill:   LD A,B
+    0x22,               //         LD (HL+),A
+    0x05,               //         DEC B
+    0x20, 0xFB,         //         JR NZ,fill
+    0x0E, 0x1F,         //         LD C,31
+    0x21, 0x00, 0xC0,   // outer:  LD HL,0xC000
+    0x41,               //         LD B,C
+    0x2A,               // inner:  LD A,(HL+)
+    0xBE,               //         CP (HL)
+    0x38, 0x05,         //         JR C,noswap
+    0x56,               //         LD D,(HL)
+    0x77,               //         LD (HL),A
+    0x2B,               //         DEC HL
+    0x72,               //         LD (HL),D
+    0x23,               //         INC HL
+    0x05,               // noswap: DEC B
+    0x20, 0xF4,         //         JR NZ,inner
+    0x0D,               //         DEC C
+    0x20, 0xED,         //         JR NZ,outer
+    0x18, 0xDF,         //         JR start
+};
+
+/**
+ * Runs a block of instructions over and over from plain memory, with no
+ * scheduler, so only decode and execute are measured.
+ */
+void runInstructions(benchmark::State& state, const std::vector<gb::Byte>& block)
+{
+    gb::Memory mem(0x10000);
+    std::fill(mem.data(), mem.data() + mem.size(), 0x00);
+
+    size_t pos = 0;
+    while (pos + block.size() <= ProgramEnd) {
+        std::copy(block.begin(), block.end(), mem.data() + pos);
+        pos += block.size();
+    }
+    mem[pos] = 0xC3;    // JP 0x0000
+    mem[Subroutine] = 0xC9;
+
+    gb::Cpu cpu;
+    cpu.setMemory(&mem);
+    cpu.setInterruptsEnabled(false);
+    cpu.registers().BC = 0xC100;
+    cpu.registers().DE = 0xC200;
+    cpu.registers().HL = 0xC000;
+    cpu.registers().SP = 0xFFFE;
+
+    gb::PerfCounters perf;
+    perf.start();
+    for (auto _ : state) {
+        cpu.processNextInstruction();
+    }
+    perf.stop();
+
+    perf.report(state, state.iterations());
+    state.SetItemsProcessed(state.iterations());
+    state.counters["MHz"] = benchmark::Counter(cpu.cycles()/1e6, benchmark::Counter::kIsRate);
+}
+
+/**
+ * Runs a guest loop on a whole GameBoy, MMU, scheduler and peripherals
+ * included, for MacroCycles per iteration.
+ */
+void runProgram(benchmark::State& state, const std::vector<gb::Byte>& program)
+{
+    std::vector<gb::Byte> rom(0x8000, 0x00);
+    rom[0x100] = 0xC3;  // JP 0x0150
+    rom[0x101] = 0x50;
+    rom[0x102] = 0x01;
+    std::copy(program.begin(), program.end(), rom.begin() + 0x150);
+
+    gb::Cartridge cartridge(rom);
+    gb::GameBoy gameBoy;
+    gameBoy.insertCartridge(&cartridge);
+    gameBoy.skipBoot();
+
+    gb::Cpu& cpu = gameBoy.cpu();
+    uint64_t start = cpu.cycles();
+    uint64_t instructions = 0;
+    gb::PerfCounters perf;
+    perf.start();
+    for (auto _ : state) {
+        uint64_t end = cpu.cycles() + MacroCycles;
+        while (cpu.cycles() < end) {
+            cpu.processNextInstruction();
+            ++instructions;
+        }
+    }
+    perf.stop();
+
+    perf.report(state, instructions);
+    state.SetItemsProcessed(instructions);
+    state.counters["MHz"] = benchmark::Counter((cpu.cycles() - start)/1e6, benchmark::Counter::kIsRate);
+}
+
+}
+
+BENCHMARK_CAPTURE(runInstructions, Loads, Loads);
+BENCHMARK_CAPTURE(runInstructions, Alu8, Alu8);
+BENCHMARK_CAPTURE(runInstructions, Alu16, Alu16);
+BENCHMARK_CAPTURE(runInstructions, CbRotates, CbRotates);
+BENCHMARK_CAPTURE(runInstructions, Branches, Branches);
+
+BENCHMARK_CAPTURE(runProgram, Memcpy, Memcpy)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(runProgram, Checksum, Checksum)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(runProgram, BubbleSort, BubbleSort)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,167 @@
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <vector>
+
+#include "cpu/memory.h"
+#include "cpu/mmu.h"
+#include "util/units.h"
+#include "util/util.h"
+
+namespace {
+
+enum Pattern
+{
+    PatternSequential = 0,
+    PatternRandom = 1,
+    PatternStack = 2,
+};
+
+// Accesses run per benchmark iteration, bit 16 of each set for a write
+const size_t BatchSize = 4096;
+const uint32_t WriteBit = 1 << 16;
+
+/**
+ * The same pseudo random accesses every run, so results stay comparable.
+ */
+std::vector<uint32_t> makeAccesses(Pattern pattern, int writePercent)
+{
+    std::vector<uint32_t> accesses(BatchSize);
+    uint32_t seed = 12345;
+    uint32_t address = 0;
+    uint32_t sp = 0xFFFE;
+    for (size_t i = 0; i < BatchSize; ++i) {
+        seed = seed*1103515245 + 12345;
+        uint32_t random = seed >> 8;
+
+        switch (pattern) {
+            case PatternSequential:
+                // Spread over the whole space, so every region is touched
+                address = i*(0x10000/BatchSize) & 0xFFFF;
+                break;
+            case PatternRandom:
+                address = random & 0xFFFF;
+                break;
+            case PatternStack:
+                // Pushes and pops of two bytes, within 256 bytes of the top
+                if ((random & 0x100) && sp > 0xFF00) {
+                    sp -= 2;
+                } else if (sp < 0xFFFE) {
+                    sp += 2;
+                }
+                address = sp - (i & 1);
+                break;
+        }
+
+        bool isWrite = static_cast<int>(random % 100) < writePercent;
+        accesses[i] = address | (isWrite ? WriteBit : 0);
+    }
+    return accesses;
+}
+
+/**
+ * Splits the address space evenly between regions Memory blocks.
+ */
+void mapRegions(gb::MMU& mmu, std::vector<std::unique_ptr<gb::Memory>>& blocks, size_t regions)
+{
+    size_t size = 0x10000/regions;
+    for (size_t i = 0; i < regions; ++i) {
+        blocks.emplace_back(new gb::Memory(size));
+        mmu.map(blocks.back().get(), gb::Range(0, size - 1), gb::Range(i*size, (i + 1)*size - 1));
+    }
+}
+
+/**
+ * Emulated accesses through MMU::read() and MMU::write(), as the Cpu makes
+ * them. Args are region count, Pattern and write percentage.
+ */
+void mmuReadWrite(benchmark::State& state)
+{
+    gb::MMU mmu;
+    std::vector<std::unique_ptr<gb::Memory>> blocks;
+    mapRegions(mmu, blocks, state.range(0));
+    std::vector<uint32_t> accesses = makeAccesses(static_cast<Pattern>(state.range(1)), state.range(2));
+
+    gb::Byte sum = 0;
+    for (auto _ : state) {
+        for (uint32_t access : accesses) {
+            if (access & WriteBit) {
+                mmu.write(access & 0xFFFF, sum);
+            } else {
+                sum += mmu.read(access);
+            }
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations()*BatchSize);
+}
+
+/**
+ * Raw accesses through MMU::operator[], as debuggers and DMA make them.
+ */
+void mmuIndex(benchmark::State& state)
+{
+    gb::MMU mmu;
+    std::vector<std::unique_ptr<gb::Memory>> blocks;
+    mapRegions(mmu, blocks, state.range(0));
+    std::vector<uint32_t> accesses = makeAccesses(static_cast<Pattern>(state.range(1)), state.range(2));
+
+    gb::Byte sum = 0;
+    for (auto _ : state) {
+        for (uint32_t access : accesses) {
+            if (access & WriteBit) {
+                mmu[access & 0xFFFF] = sum;
+            } else {
+                sum += mmu[access];
+            }
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations()*BatchSize);
+}
+
+/**
+ * Memory::operator[] on its own, the floor for the MMU numbers. The region
+ * count is ignored.
+ */
+void memoryIndex(benchmark::State& state)
+{
+    gb::Memory mem(0x10000);
+    std::vector<uint32_t> accesses = makeAccesses(static_cast<Pattern>(state.range(1)), state.range(2));
+
+    gb::Byte sum = 0;
+    for (auto _ : state) {
+        for (uint32_t access : accesses) {
+            if (access & WriteBit) {
+                mem[access & 0xFFFF] = sum;
+            } else {
+                sum += mem[access];
+            }
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations()*BatchSize);
+}
+
+// Region counts, patterns and write percentages
+void mmuArgs(benchmark::internal::Benchmark* b)
+{
+    b->ArgNames({"regions", "pattern", "writes"});
+    b->ArgsProduct({{1, 4, 16, 64},
+                    {PatternSequential, PatternRandom, PatternStack},
+                    {0, 50, 100}});
+}
+
+void memoryArgs(benchmark::internal::Benchmark* b)
+{
+    b->ArgNames({"regions", "pattern", "writes"});
+    b->ArgsProduct({{1},
+                    {PatternSequential, PatternRandom, PatternStack},
+                    {0, 50, 100}});
+}
+
+}
+
+BENCHMARK(mmuReadWrite)->Apply(mmuArgs);
+BENCHMARK(mmuIndex)->Apply(mmuArgs);
+BENCHMARK(memoryIndex)->Apply(memoryArgs);
@@ -0,0 +1,115 @@
+#include "perfcounters.h"
+using gb::PerfCounters;
+
+#include <cstdio>
+#include <cstring>
+
+#ifdef GB_PERF_COUNTERS
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const char* const CounterNames[PerfCounters::NumCounters] = {
+    "cycles/insn",
+    "instructions/insn",
+    "branch-misses/insn",
+    "L1d-misses/insn",
+};
+
+#ifdef GB_PERF_COUNTERS
+int openCounter(uint32_t type, uint64_t config)
+{
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+}
+#endif
+
+}
+
+PerfCounters::PerfCounters() :
+    _isOpen(false)
+{
+    for (size_t i = 0; i < NumCounters; ++i) {
+        _fds[i] = -1;
+        _values[i] = 0;
+    }
+
+#ifdef GB_PERF_COUNTERS
+    _fds[CounterCycles] = openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+    _fds[CounterInstructions] = openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+    _fds[CounterBranchMisses] = openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+    _fds[CounterL1dMisses] = openCounter(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D |
+                                         (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                         (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+
+    // Counters the host lacks are left out, the rest still report
+    for (size_t i = 0; i < NumCounters; ++i) {
+        _isOpen = _isOpen || _fds[i] >= 0;
+    }
+
+    static bool isWarned = false;
+    if (!_isOpen && !isWarned) {
+        std::fprintf(stderr, "Warning: perf_event_open failed, hardware counters are not reported\n");
+        isWarned = true;
+    }
+#endif
+}
+
+PerfCounters::~PerfCounters()
+{
+#ifdef GB_PERF_COUNTERS
+    for (size_t i = 0; i < NumCounters; ++i) {
+        if (_fds[i] >= 0) {
+            close(_fds[i]);
+        }
+    }
+#endif
+}
+
+void PerfCounters::start()
+{
+#ifdef GB_PERF_COUNTERS
+    for (size_t i = 0; i < NumCounters; ++i) {
+        if (_fds[i] >= 0) {
+            ioctl(_fds[i], PERF_EVENT_IOC_RESET, 0);
+            ioctl(_fds[i], PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+#endif
+}
+
+void PerfCounters::stop()
+{
+#ifdef GB_PERF_COUNTERS
+    for (size_t i = 0; i < NumCounters; ++i) {
+        if (_fds[i] >= 0) {
+            ioctl(_fds[i], PERF_EVENT_IOC_DISABLE, 0);
+            uint64_t val = 0;
+            _values[i] = read(_fds[i], &val, sizeof(val)) == sizeof(val) ? val : 0;
+        }
+    }
+#endif
+}
+
+void PerfCounters::report(benchmark::State& state, uint64_t instructions) const
+{
+    if (!_isOpen || instructions == 0) {
+        return;
+    }
+    for (size_t i = 0; i < NumCounters; ++i) {
+        if (_fds[i] >= 0) {
+            state.counters[CounterNames[i]] = static_cast<double>(_values[i])/instructions;
+        }
+    }
+}
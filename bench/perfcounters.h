@@ -0,0 +1,63 @@
+#ifndef GB_PERFCOUNTERS_H
+#define GB_PERFCOUNTERS_H
+
+#include <cstdint>
+
+#include <benchmark/benchmark.h>
+
+namespace gb {
+
+/**
+ * Whether benchmarks read hardware counters. They're compiled in with
+ * GB_PERF_COUNTERS, "scons bench perf=1", and only work on Linux.
+ */
+#ifdef GB_PERF_COUNTERS
+const bool IsPerfEnabled = true;
+#else
+const bool IsPerfEnabled = false;
+#endif
+
+/**
+ * Host CPU cycles, instructions, branch misses and L1d read misses of this
+ * thread, counted with perf_event_open between start() and stop().
+ *
+ * When the counters are compiled out or the kernel refuses them (see
+ * /proc/sys/kernel/perf_event_paranoid) nothing is counted or reported.
+ */
+class PerfCounters
+{
+public:
+    enum Counter
+    {
+        CounterCycles = 0,
+        CounterInstructions = 1,
+        CounterBranchMisses = 2,
+        CounterL1dMisses = 3,
+        NumCounters = 4,
+    };
+
+    PerfCounters();
+    ~PerfCounters();
+
+    bool isOpen() const { return _isOpen; }
+
+    void start();
+    void stop();
+
+    uint64_t value(Counter counter) const { return _values[counter]; }
+
+    /**
+     * Adds each counter to state divided by the guest instructions run, as
+     * "branch-misses/insn" and so on.
+     */
+    void report(benchmark::State& state, uint64_t instructions) const;
+
+private:
+    int _fds[NumCounters];
+    uint64_t _values[NumCounters];
+    bool _isOpen;
+};
+
+}
+
+#endif
@@ -0,0 +1,305 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <dirent.h>
+
+#include <boost/program_options.hpp>
+namespace po = boost::program_options;
+
+#include <cpu/cartridge.h>
+#include <cpu/gameboy.h>
+
+const std::string ProgramName = "conformance";
+
+// Clock cycles in one emulated second
+const uint64_t CyclesPerSecond = 4194304;
+
+// Mooneye ROMs finish with LD B,B and these registers, B C D E H L, which
+// newer builds also send over serial
+const gb::Byte PassSignature[] = {3, 5, 8, 13, 21, 34};
+const gb::Byte FailSignature[] = {0x42, 0x42, 0x42, 0x42, 0x42, 0x42};
+const size_t SignatureSize = sizeof(PassSignature);
+const gb::Byte OpcodeLdBB = 0x40;
+
+enum Outcome
+{
+    OutcomePass,
+    OutcomeFail,
+    OutcomeTimeout,
+    OutcomeError,
+};
+
+struct Result
+{
+    Result() : outcome(OutcomeError), emulatedSeconds(0), wallMs(0) { }
+
+    Outcome outcome;
+    double emulatedSeconds;
+    double wallMs;
+    std::string detail;
+};
+
+void parseOptions(int argc, char** argv, po::variables_map& vm)
+{
+    po::positional_options_description p;
+    p.add("rom-dir", -1);
+
+    po::options_description desc("Allowed options");
+    desc.add_options()
+        ("help,h", "Prints this help message.")
+        ("rom-dir", "Directory searched recursively for .gb and .gbc test ROMs.")
+        ("seconds", po::value<double>()->default_value(120), "Emulated seconds a ROM has to report a result.")
+        ("jobs,j", po::value<unsigned>()->default_value(0), "ROMs run at once, 0 for one per core.")
+        ;
+
+    po::store(po::command_line_parser(argc, argv).
+        options(desc).
+        positional(p).
+        run(), vm);
+    po::notify(vm);
+
+    if (vm.count("help")) {
+        std::cout << ProgramName << ": runs Blargg and Mooneye test ROMs and reports which pass" << std::endl << std::endl;
+        std::cout << "Usage: " << ProgramName << " [options] rom-dir" << std::endl << std::endl;
+        std::cout << desc << std::endl;
+        exit(1);
+    }
+}
+
+void errorAndExit(const std::string& err)
+{
+    // Non-zero so that a bad roms= path fails "scons conformance"
+    std::cerr << "Error: " << err << std::endl;
+    exit(1);
+}
+
+/**
+ * Appends the ROMs under dir to roms, as paths relative to the top
+ * directory, prefix.
+ */
+void listRoms(const std::string& dir, const std::string& prefix, std::vector<std::string>& roms)
+{
+    DIR* d = opendir(dir.c_str());
+    if (!d) {
+        errorAndExit("could not open " + dir + ".");
+    }
+
+    while (dirent* entry = readdir(d)) {
+        std::string name = entry->d_name;
+        if (name == "." || name == "..") {
+            continue;
+        }
+        if (entry->d_type == DT_DIR) {
+            listRoms(dir + "/" + name, prefix + name + "/", roms);
+            continue;
+        }
+        size_t dot = name.find_last_of('.');
+        if (dot != std::string::npos && (name.substr(dot) == ".gb" || name.substr(dot) == ".gbc")) {
+            roms.push_back(prefix + name);
+        }
+    }
+    closedir(d);
+}
+
+/**
+ * Serial output on one line, for the table. Blargg ROMs print the failing
+ * tests and their error codes before "Failed".
+ */
+std::string oneLine(const std::string& output)
+{
+    std::string line;
+    for (char c : output) {
+        bool isSpace = c == '\n' || c == '\r' || c == ' ';
+        if (isSpace && !line.empty() && line.back() != ' ') {
+            line += ' ';
+        } else if (!isSpace && c >= ' ' && c <= '~') {
+            line += c;
+        }
+    }
+    while (!line.empty() && line.back() == ' ') {
+        line.pop_back();
+    }
+    return line;
+}
+
+/**
+ * Checks serial output for a verdict. Blargg ROMs print "Passed" or
+ * "Failed", which is only taken once its line is complete so the failure
+ * count is kept. Mooneye ROMs send their register signature.
+ */
+bool checkSerial(const std::string& output, Result& result)
+{
+    if (output.back() == '\n' && output.find("Passed") != std::string::npos) {
+        result.outcome = OutcomePass;
+        return true;
+    }
+    if (output.back() == '\n' && output.find("Failed") != std::string::npos) {
+        result.outcome = OutcomeFail;
+        result.detail = oneLine(output);
+        return true;
+    }
+
+    if (output.size() >= SignatureSize) {
+        const gb::Byte* tail = reinterpret_cast<const gb::Byte*>(output.data() + output.size() - SignatureSize);
+        if (std::equal(tail, tail + SignatureSize, PassSignature)) {
+            result.outcome = OutcomePass;
+            return true;
+        }
+        if (std::equal(tail, tail + SignatureSize, FailSignature)) {
+            result.outcome = OutcomeFail;
+            result.detail = "fail signature";
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Checks the registers at an LD B,B for the Mooneye signature.
+ */
+bool checkRegisters(const gb::Cpu::Registers& regs, Result& result)
+{
+    const gb::Byte values[] = {regs.B, regs.C, regs.D, regs.E, regs.H, regs.L};
+    if (std::equal(values, values + SignatureSize, PassSignature)) {
+        result.outcome = OutcomePass;
+        return true;
+    }
+    if (std::equal(values, values + SignatureSize, FailSignature)) {
+        result.outcome = OutcomeFail;
+        result.detail = "fail signature";
+        return true;
+    }
+    return false;
+}
+
+/**
+ * Runs romFile headless until it reports a verdict, stops, or has run for
+ * cycles.
+ */
+Result runRom(const std::string& romFile, uint64_t cycles)
+{
+    Result result;
+    std::ifstream fin(romFile, std::ios_base::binary);
+    std::vector<gb::Byte> rom((std::istreambuf_iterator<char>(fin)), std::istreambuf_iterator<char>());
+    if (!fin || rom.empty()) {
+        result.detail = "could not read ROM";
+        return result;
+    }
+
+    gb::Cartridge cartridge(rom);
+    if (!cartridge.isSupported()) {
+        result.detail = "unsupported cartridge";
+        return result;
+    }
+    gb::GameBoy gameBoy;
+    gameBoy.insertCartridge(&cartridge);
+    gameBoy.skipBoot();
+
+    gb::Cpu& cpu = gameBoy.cpu();
+    gb::MMU& mmu = gameBoy.mmu();
+    const std::string& output = gameBoy.serial().output();
+    size_t outputSize = 0;
+    bool isDone = false;
+    uint64_t start = cpu.cycles();
+    auto begin = std::chrono::steady_clock::now();
+    while (!isDone && cpu.cycles() - start < cycles && !cpu.isStopped()) {
+        // Peeking with operator[] keeps the check free of side effects
+        if (mmu[cpu.registers().PC] == OpcodeLdBB) {
+            isDone = checkRegisters(cpu.registers(), result);
+        }
+        cpu.processNextInstruction();
+
+        if (output.size() != outputSize) {
+            outputSize = output.size();
+            isDone = isDone || checkSerial(output, result);
+        }
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+
+    if (!isDone) {
+        result.outcome = OutcomeTimeout;
+        result.detail = cpu.isStopped() ? "stopped" : oneLine(output);
+    }
+    result.emulatedSeconds = static_cast<double>(cpu.cycles() - start)/CyclesPerSecond;
+    result.wallMs = 1000*elapsed.count();
+    return result;
+}
+
+const char* outcomeName(Outcome outcome)
+{
+    switch (outcome) {
+        case OutcomePass:    return "pass";
+        case OutcomeFail:    return "FAIL";
+        case OutcomeTimeout: return "TIMEOUT";
+        default:             return "ERROR";
+    }
+}
+
+int main(int argc, char** argv)
+{
+    po::variables_map vm;
+    parseOptions(argc, argv, vm);
+
+    if (!vm.count("rom-dir")) {
+        errorAndExit("must specify a rom-dir.");
+    }
+    std::string romDir = vm["rom-dir"].as<std::string>();
+    uint64_t cycles = static_cast<uint64_t>(vm["seconds"].as<double>()*CyclesPerSecond);
+
+    std::vector<std::string> roms;
+    listRoms(romDir, "", roms);
+    if (roms.empty()) {
+        errorAndExit("no ROMs in rom-dir.");
+    }
+    std::sort(roms.begin(), roms.end());
+
+    // Each ROM gets its own GameBoy, so workers share nothing but the index
+    // of the next ROM to run
+    unsigned jobs = vm["jobs"].as<unsigned>();
+    if (jobs == 0) {
+        jobs = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+    jobs = std::min<size_t>(jobs, roms.size());
+
+    std::vector<Result> results(roms.size());
+    std::atomic<size_t> next(0);
+    std::vector<std::thread> workers;
+    auto begin = std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < jobs; ++i) {
+        workers.emplace_back([&]() {
+            for (size_t rom = next++; rom < roms.size(); rom = next++) {
+                results[rom] = runRom(romDir + "/" + roms[rom], cycles);
+            }
+        });
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+
+    size_t counts[OutcomeError + 1] = {0};
+    size_t width = 3;
+    for (const std::string& rom : roms) {
+        width = std::max(width, rom.size());
+    }
+    std::printf("%-*s  %-7s %10s %10s  %s\n", static_cast<int>(width), "rom", "result", "emulated s",
+                "wall ms", "detail");
+    for (size_t i = 0; i < roms.size(); ++i) {
+        const Result& r = results[i];
+        ++counts[r.outcome];
+        std::printf("%-*s  %-7s %10.2f %10.1f  %s\n", static_cast<int>(width), roms[i].c_str(),
+                    outcomeName(r.outcome), r.emulatedSeconds, r.wallMs, r.detail.c_str());
+    }
+    std::printf("\n%zu passed, %zu failed, %zu timed out, %zu errors of %zu ROMs in %.1fs with %u jobs\n",
+                counts[OutcomePass], counts[OutcomeFail], counts[OutcomeTimeout], counts[OutcomeError],
+                roms.size(), elapsed.count(), jobs);
+
+    return counts[OutcomePass] == roms.size() ? 0 : 1;
+}
@@ -0,0 +1,142 @@
+#include <cstdio>
+#include <cstdlib>
+#include <utility>
+#include <vector>
+
+#include "cpu/addressable.h"
+#include "cpu/cpu.h"
+#include "util/units.h"
+
+#include "referencecpu.h"
+
+namespace {
+
+// Input layout: A, F, B, C, D, E, H, L, SP low, SP high, IME, then the
+// instruction stream loaded at 0x0000
+const size_t HeaderSize = 11;
+
+// Instructions compared per input, keeps each run short
+const size_t MaxSteps = 256;
+
+/**
+ * Flat 64K memory which logs emulated writes, to compare with the
+ * reference's.
+ */
+class RecordingMemory : public gb::Addressable
+{
+public:
+    RecordingMemory() : _mem(0x10000) { }
+
+    virtual gb::Byte& operator[](size_t address) override { return _mem[address]; }
+    virtual bool isValidAddress(size_t address) const override { return address < _mem.size(); }
+
+    virtual void write(size_t address, gb::Byte val) override
+    {
+        _mem[address] = val;
+        writes.push_back(std::make_pair(static_cast<gb::Word>(address), val));
+    }
+
+    std::vector<std::pair<gb::Word, gb::Byte>> writes;
+
+private:
+    std::vector<gb::Byte> _mem;
+};
+
+void printState(const char* name, gb::Word af, gb::Word bc, gb::Word de, gb::Word hl, gb::Word sp,
+                gb::Word pc, bool ime, uint64_t cycles)
+{
+    std::fprintf(stderr, "%-9s AF %04x BC %04x DE %04x HL %04x SP %04x PC %04x IME %d cycles %llu\n",
+                 name, af, bc, de, hl, sp, pc, ime ? 1 : 0, static_cast<unsigned long long>(cycles));
+}
+
+/**
+ * Aborts, so the fuzzer keeps the input, if cpu and ref disagree after the
+ * instruction at pc.
+ */
+void compare(gb::Cpu& cpu, RecordingMemory& mem, gb::ReferenceCpu& ref, gb::Word pc, gb::Byte opcode)
+{
+    gb::Cpu::Registers& regs = cpu.registers();
+    gb::ReferenceCpu::State& s = ref.state();
+    gb::Word af = static_cast<gb::Word>((s.a << 8) | s.f);
+    gb::Word bc = static_cast<gb::Word>((s.b << 8) | s.c);
+    gb::Word de = static_cast<gb::Word>((s.d << 8) | s.e);
+    gb::Word hl = static_cast<gb::Word>((s.h << 8) | s.l);
+
+    if (regs.AF == af && regs.BC == bc && regs.DE == de && regs.HL == hl && regs.SP == s.sp &&
+            regs.PC == s.pc && cpu.interruptsEnabled() == s.ime && cpu.cycles() == ref.cycles() &&
+            mem.writes == ref.writes()) {
+        return;
+    }
+
+    std::fprintf(stderr, "Mismatch after opcode %02x at %04x\n", opcode, pc);
+    printState("cpu", regs.AF, regs.BC, regs.DE, regs.HL, regs.SP, regs.PC, cpu.interruptsEnabled(),
+               cpu.cycles());
+    printState("reference", af, bc, de, hl, s.sp, s.pc, s.ime, ref.cycles());
+    if (mem.writes != ref.writes()) {
+        std::fprintf(stderr, "Writes differ, %zu from cpu and %zu from reference\n", mem.writes.size(),
+                     ref.writes().size());
+    }
+    std::abort();
+}
+
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+    if (size < HeaderSize) {
+        return 0;
+    }
+
+    // Memory past the instruction stream holds a fixed pattern, so loads
+    // and stray jumps see varied data
+    RecordingMemory mem;
+    gb::ReferenceCpu ref;
+    for (size_t i = 0; i < 0x10000; ++i) {
+        gb::Byte val = static_cast<gb::Byte>(i*0x9E + (i >> 8));
+        if (i < size - HeaderSize) {
+            val = data[HeaderSize + i];
+        }
+        mem[i] = val;
+        ref.memory()[i] = val;
+    }
+
+    // The low nibble of F doesn't exist on hardware
+    gb::ReferenceCpu::State& s = ref.state();
+    s.a = data[0];
+    s.f = data[1] & 0xF0;
+    s.b = data[2];
+    s.c = data[3];
+    s.d = data[4];
+    s.e = data[5];
+    s.h = data[6];
+    s.l = data[7];
+    s.sp = static_cast<gb::Word>(data[8] | (data[9] << 8));
+    s.pc = 0x0000;
+    s.ime = data[10] & 0x01;
+
+    gb::Cpu cpu;
+    cpu.setMemory(&mem);
+    gb::Cpu::Registers& regs = cpu.registers();
+    regs.A = s.a;
+    regs.F = s.f;
+    regs.B = s.b;
+    regs.C = s.c;
+    regs.D = s.d;
+    regs.E = s.e;
+    regs.H = s.h;
+    regs.L = s.l;
+    regs.SP = s.sp;
+    regs.PC = s.pc;
+    cpu.setInterruptsEnabled(s.ime);
+
+    for (size_t i = 0; i < MaxSteps && ref.isSupported(); ++i) {
+        gb::Word pc = s.pc;
+        gb::Byte opcode = mem[pc];
+
+        mem.writes.clear();
+        cpu.processNextInstruction();
+        ref.step();
+        compare(cpu, mem, ref, pc, opcode);
+    }
+    return 0;
+}
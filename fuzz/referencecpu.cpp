@@ -0,0 +1,475 @@
+#include "referencecpu.h"
+using gb::ReferenceCpu;
+
+#include <cassert>
+
+ReferenceCpu::ReferenceCpu() :
+    _mem(0x10000, 0x00),
+    _cycles(0)
+{
+    _state = State{0, 0, 0, 0, 0, 0, 0, 0, 0, 0, false};
+}
+
+bool ReferenceCpu::isSupported() const
+{
+    switch (_mem[_state.pc]) {
+        case 0x10: // STOP
+        case 0x76: // HALT
+        case 0xD3: case 0xDB: case 0xDD:
+        case 0xE3: case 0xE4: case 0xEB: case 0xEC: case 0xED:
+        case 0xF4: case 0xFC: case 0xFD:
+            return false;
+        default:
+            return true;
+    }
+}
+
+gb::Byte ReferenceCpu::_read(Word address)
+{
+    _cycles += 4;
+    return _mem[address];
+}
+
+void ReferenceCpu::_write(Word address, Byte val)
+{
+    _cycles += 4;
+    _mem[address] = val;
+    _writes.push_back(std::make_pair(address, val));
+}
+
+gb::Byte ReferenceCpu::_fetch()
+{
+    return _read(_state.pc++);
+}
+
+gb::Word ReferenceCpu::_fetch16()
+{
+    Byte low = _fetch();
+    return static_cast<Word>(low | (_fetch() << 8));
+}
+
+void ReferenceCpu::_idle()
+{
+    _cycles += 4;
+}
+
+void ReferenceCpu::_push(Word val)
+{
+    _write(--_state.sp, val >> 8);
+    _write(--_state.sp, val & 0xFF);
+}
+
+gb::Word ReferenceCpu::_pop()
+{
+    Byte low = _read(_state.sp++);
+    return static_cast<Word>(low | (_read(_state.sp++) << 8));
+}
+
+// Registers in opcode order: B, C, D, E, H, L, (HL), A
+gb::Byte ReferenceCpu::_reg(int index)
+{
+    switch (index) {
+        case 0: return _state.b;
+        case 1: return _state.c;
+        case 2: return _state.d;
+        case 3: return _state.e;
+        case 4: return _state.h;
+        case 5: return _state.l;
+        case 6: return _read(_pair(2));
+        default: return _state.a;
+    }
+}
+
+void ReferenceCpu::_setReg(int index, Byte val)
+{
+    switch (index) {
+        case 0: _state.b = val; break;
+        case 1: _state.c = val; break;
+        case 2: _state.d = val; break;
+        case 3: _state.e = val; break;
+        case 4: _state.h = val; break;
+        case 5: _state.l = val; break;
+        case 6: _write(_pair(2), val); break;
+        default: _state.a = val; break;
+    }
+}
+
+// BC, DE, HL, SP
+gb::Word ReferenceCpu::_pair(int index) const
+{
+    switch (index) {
+        case 0: return static_cast<Word>((_state.b << 8) | _state.c);
+        case 1: return static_cast<Word>((_state.d << 8) | _state.e);
+        case 2: return static_cast<Word>((_state.h << 8) | _state.l);
+        default: return _state.sp;
+    }
+}
+
+void ReferenceCpu::_setPair(int index, Word val)
+{
+    switch (index) {
+        case 0: _state.b = val >> 8; _state.c = val & 0xFF; break;
+        case 1: _state.d = val >> 8; _state.e = val & 0xFF; break;
+        case 2: _state.h = val >> 8; _state.l = val & 0xFF; break;
+        default: _state.sp = val; break;
+    }
+}
+
+// BC, DE, HL, AF for PUSH and POP
+gb::Word ReferenceCpu::_pair2(int index) const
+{
+    return index == 3 ? static_cast<Word>((_state.a << 8) | _state.f) : _pair(index);
+}
+
+void ReferenceCpu::_setPair2(int index, Word val)
+{
+    if (index == 3) {
+        _state.a = val >> 8;
+        _state.f = val & 0xF0;
+    } else {
+        _setPair(index, val);
+    }
+}
+
+// NZ, Z, NC, C
+bool ReferenceCpu::_condition(int index) const
+{
+    bool flag = (_state.f & (index < 2 ? 0x80 : 0x10)) != 0;
+    return (index & 1) ? flag : !flag;
+}
+
+void ReferenceCpu::_setFlags(bool z, bool n, bool h, bool c)
+{
+    _state.f = static_cast<Byte>((z ? 0x80 : 0) | (n ? 0x40 : 0) | (h ? 0x20 : 0) | (c ? 0x10 : 0));
+}
+
+// ADD, ADC, SUB, SBC, AND, XOR, OR, CP
+void ReferenceCpu::_alu(int op, Byte val)
+{
+    int a = _state.a;
+    int carry = (op == 1 || op == 3) && _carry() ? 1 : 0;
+    int result = 0;
+    switch (op) {
+        case 0:
+        case 1:
+            result = a + val + carry;
+            _setFlags((result & 0xFF) == 0, false, (a & 0xF) + (val & 0xF) + carry > 0xF, result > 0xFF);
+            break;
+        case 2:
+        case 3:
+        case 7:
+            result = a - val - carry;
+            _setFlags((result & 0xFF) == 0, true, (a & 0xF) < (val & 0xF) + carry, a < val + carry);
+            break;
+        case 4:
+            result = a & val;
+            _setFlags(result == 0, false, true, false);
+            break;
+        case 5:
+            result = a ^ val;
+            _setFlags(result == 0, false, false, false);
+            break;
+        default:
+            result = a | val;
+            _setFlags(result == 0, false, false, false);
+            break;
+    }
+    if (op != 7) {
+        _state.a = static_cast<Byte>(result);
+    }
+}
+
+// RLC, RRC, RL, RR, SLA, SRA, SWAP, SRL, setting all four flags
+gb::Byte ReferenceCpu::_rotate(int op, Byte val)
+{
+    int result = 0;
+    bool carry = false;
+    switch (op) {
+        case 0: carry = val & 0x80; result = (val << 1) | (val >> 7); break;
+        case 1: carry = val & 0x01; result = (val >> 1) | (val << 7); break;
+        case 2: carry = val & 0x80; result = (val << 1) | (_carry() ? 1 : 0); break;
+        case 3: carry = val & 0x01; result = (val >> 1) | (_carry() ? 0x80 : 0); break;
+        case 4: carry = val & 0x80; result = val << 1; break;
+        case 5: carry = val & 0x01; result = (val >> 1) | (val & 0x80); break;
+        case 6: result = (val >> 4) | (val << 4); break;
+        default: carry = val & 0x01; result = val >> 1; break;
+    }
+    result &= 0xFF;
+    _setFlags(result == 0, false, false, carry);
+    return static_cast<Byte>(result);
+}
+
+// SP plus a signed immediate, flags from the low byte as unsigned
+gb::Word ReferenceCpu::_addSp()
+{
+    Byte offset = _fetch();
+    int sp = _state.sp;
+    _setFlags(false, false, (sp & 0xF) + (offset & 0xF) > 0xF, (sp & 0xFF) + offset > 0xFF);
+    return static_cast<Word>(sp + static_cast<int8_t>(offset));
+}
+
+void ReferenceCpu::_daa()
+{
+    int a = _state.a;
+    bool n = _state.f & 0x40;
+    bool h = _state.f & 0x20;
+    bool c = _carry();
+    if (!n) {
+        if (c || a > 0x99) {
+            a += 0x60;
+            c = true;
+        }
+        if (h || (a & 0x0F) > 0x09) {
+            a += 0x06;
+        }
+    } else {
+        if (c) {
+            a -= 0x60;
+        }
+        if (h) {
+            a -= 0x06;
+        }
+    }
+    _state.a = static_cast<Byte>(a);
+    _setFlags(_state.a == 0, n, false, c);
+}
+
+void ReferenceCpu::_stepCb()
+{
+    Byte opcode = _fetch();
+    int x = opcode >> 6;
+    int y = (opcode >> 3) & 7;
+    int z = opcode & 7;
+
+    Byte val = _reg(z);
+    switch (x) {
+        case 0:
+            _setReg(z, _rotate(y, val));
+            break;
+        case 1:
+            _state.f = static_cast<Byte>((_state.f & 0x10) | 0x20 | ((val & (1 << y)) ? 0 : 0x80));
+            break;
+        case 2:
+            _setReg(z, val & ~(1 << y));
+            break;
+        default:
+            _setReg(z, val | (1 << y));
+            break;
+    }
+}
+
+void ReferenceCpu::step()
+{
+    assert(isSupported());
+    _writes.clear();
+
+    Byte opcode = _fetch();
+    int x = opcode >> 6;
+    int y = (opcode >> 3) & 7;
+    int z = opcode & 7;
+    int p = y >> 1;
+    int q = y & 1;
+
+    if (x == 1) {
+        // LD r,r'
+        _setReg(y, _reg(z));
+        return;
+    }
+    if (x == 2) {
+        _alu(y, _reg(z));
+        return;
+    }
+
+    if (x == 0) {
+        switch (z) {
+            case 0:
+                if (y == 0) {
+                    // NOP
+                } else if (y == 1) {
+                    Word address = _fetch16();
+                    _write(address, _state.sp & 0xFF);
+                    _write(static_cast<Word>(address + 1), _state.sp >> 8);
+                } else {
+                    // JR d, JR cc,d
+                    int8_t offset = static_cast<int8_t>(_fetch());
+                    if (y == 3 || _condition(y - 4)) {
+                        _idle();
+                        _state.pc = static_cast<Word>(_state.pc + offset);
+                    }
+                }
+                break;
+            case 1:
+                if (q == 0) {
+                    _setPair(p, _fetch16());
+                } else {
+                    int hl = _pair(2);
+                    int val = _pair(p);
+                    _idle();
+                    _state.f = static_cast<Byte>((_state.f & 0x80) | ((hl & 0xFFF) + (val & 0xFFF) > 0xFFF ? 0x20 : 0) |
+                                                 (hl + val > 0xFFFF ? 0x10 : 0));
+                    _setPair(2, static_cast<Word>(hl + val));
+                }
+                break;
+            case 2:
+            {
+                // (BC), (DE), (HL+), (HL-)
+                Word address = _pair(p < 2 ? p : 2);
+                if (q == 0) {
+                    _write(address, _state.a);
+                } else {
+                    _state.a = _read(address);
+                }
+                if (p == 2) {
+                    _setPair(2, static_cast<Word>(address + 1));
+                } else if (p == 3) {
+                    _setPair(2, static_cast<Word>(address - 1));
+                }
+                break;
+            }
+            case 3:
+                _idle();
+                _setPair(p, static_cast<Word>(_pair(p) + (q == 0 ? 1 : -1)));
+                break;
+            case 4:
+            {
+                Byte val = _reg(y);
+                Byte result = static_cast<Byte>(val + 1);
+                _state.f = static_cast<Byte>((_state.f & 0x10) | (result == 0 ? 0x80 : 0) | ((val & 0xF) == 0xF ? 0x20 : 0));
+                _setReg(y, result);
+                break;
+            }
+            case 5:
+            {
+                Byte val = _reg(y);
+                Byte result = static_cast<Byte>(val - 1);
+                _state.f = static_cast<Byte>((_state.f & 0x10) | 0x40 | (result == 0 ? 0x80 : 0) | ((val & 0xF) == 0 ? 0x20 : 0));
+                _setReg(y, result);
+                break;
+            }
+            case 6:
+                _setReg(y, _fetch());
+                break;
+            default:
+                switch (y) {
+                    case 0: case 1: case 2: case 3:
+                        // RLCA, RRCA, RLA, RRA always clear Z
+                        _state.a = _rotate(y, _state.a);
+                        _state.f &= 0x10;
+                        break;
+                    case 4:
+                        _daa();
+                        break;
+                    case 5:
+                        _state.a = ~_state.a;
+                        _state.f |= 0x60;
+                        break;
+                    case 6:
+                        _state.f = static_cast<Byte>((_state.f & 0x80) | 0x10);
+                        break;
+                    default:
+                        _state.f = static_cast<Byte>((_state.f & 0x80) | (_carry() ? 0 : 0x10));
+                        break;
+                }
+                break;
+        }
+        return;
+    }
+
+    switch (z) {
+        case 0:
+            if (y < 4) {
+                // RET cc
+                _idle();
+                if (_condition(y)) {
+                    _state.pc = _pop();
+                    _idle();
+                }
+            } else if (y == 4) {
+                _write(static_cast<Word>(0xFF00 + _fetch()), _state.a);
+            } else if (y == 5) {
+                _state.sp = _addSp();
+                _idle();
+                _idle();
+            } else if (y == 6) {
+                _state.a = _read(static_cast<Word>(0xFF00 + _fetch()));
+            } else {
+                _setPair(2, _addSp());
+                _idle();
+            }
+            break;
+        case 1:
+            if (q == 0) {
+                _setPair2(p, _pop());
+            } else if (p < 2) {
+                // RET, RETI
+                _state.pc = _pop();
+                _idle();
+                if (p == 1) {
+                    _state.ime = true;
+                }
+            } else if (p == 2) {
+                _state.pc = _pair(2);
+            } else {
+                _idle();
+                _state.sp = _pair(2);
+            }
+            break;
+        case 2:
+            if (y < 4) {
+                Word address = _fetch16();
+                if (_condition(y)) {
+                    _idle();
+                    _state.pc = address;
+                }
+            } else if (y == 4) {
+                _write(static_cast<Word>(0xFF00 + _state.c), _state.a);
+            } else if (y == 5) {
+                _write(_fetch16(), _state.a);
+            } else if (y == 6) {
+                _state.a = _read(static_cast<Word>(0xFF00 + _state.c));
+            } else {
+                _state.a = _read(_fetch16());
+            }
+            break;
+        case 3:
+            if (y == 0) {
+                _state.pc = _fetch16();
+                _idle();
+            } else if (y == 1) {
+                _stepCb();
+            } else {
+                // DI, EI
+                _state.ime = y == 7;
+            }
+            break;
+        case 4:
+        {
+            Word address = _fetch16();
+            if (_condition(y)) {
+                _idle();
+                _push(_state.pc);
+                _state.pc = address;
+            }
+            break;
+        }
+        case 5:
+            if (q == 0) {
+                _idle();
+                _push(_pair2(p));
+            } else {
+                Word address = _fetch16();
+                _idle();
+                _push(_state.pc);
+                _state.pc = address;
+            }
+            break;
+        case 6:
+            _alu(y, _fetch());
+            break;
+        default:
+            _idle();
+            _push(_state.pc);
+            _state.pc = static_cast<Word>(y*8);
+            break;
+    }
+}
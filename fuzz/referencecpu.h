@@ -0,0 +1,81 @@
+#ifndef GB_REFERENCECPU_H
+#define GB_REFERENCECPU_H
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "util/units.h"
+
+namespace gb {
+
+/**
+ * A deliberately simple SM83 model for differential testing of Cpu.
+ *
+ * Opcodes are decoded from their bit fields rather than looked up, flags are
+ * computed eagerly and timing is counted from memory accesses plus the
+ * documented internal delays. There's no interrupt controller, HALT or STOP,
+ * step() refuses those along with the unused opcodes.
+ */
+class ReferenceCpu
+{
+public:
+    struct State
+    {
+        Byte a, f, b, c, d, e, h, l;
+        Word sp, pc;
+        bool ime;
+    };
+
+    ReferenceCpu();
+
+    State& state()                  { return _state; }
+    std::vector<Byte>& memory()     { return _mem; }
+    uint64_t cycles() const         { return _cycles; }
+
+    /**
+     * Writes made by the last step(), in order.
+     */
+    const std::vector<std::pair<Word, Byte>>& writes() const { return _writes; }
+
+    /**
+     * Whether step() models the instruction at pc.
+     */
+    bool isSupported() const;
+
+    void step();
+
+private:
+    Byte _read(Word address);
+    void _write(Word address, Byte val);
+    Byte _fetch();
+    Word _fetch16();
+    void _idle();
+    void _push(Word val);
+    Word _pop();
+
+    Byte _reg(int index);
+    void _setReg(int index, Byte val);
+    Word _pair(int index) const;
+    void _setPair(int index, Word val);
+    Word _pair2(int index) const;
+    void _setPair2(int index, Word val);
+    bool _condition(int index) const;
+    void _setFlags(bool z, bool n, bool h, bool c);
+    bool _carry() const { return (_state.f & 0x10) != 0; }
+
+    void _alu(int op, Byte val);
+    Byte _rotate(int op, Byte val);
+    Word _addSp();
+    void _daa();
+    void _stepCb();
+
+    State _state;
+    std::vector<Byte> _mem;
+    std::vector<std::pair<Word, Byte>> _writes;
+    uint64_t _cycles;
+};
+
+}
+
+#endif
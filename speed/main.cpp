@@ -0,0 +1,286 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <dirent.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <boost/program_options.hpp>
+namespace po = boost::program_options;
+
+#include <cpu/cartridge.h>
+#include <cpu/gameboy.h>
+
+const std::string ProgramName = "speed";
+
+// Clock cycles in one LCD frame
+const uint64_t CyclesPerFrame = 70224;
+
+struct Result
+{
+    Result() : wallMs(0), mhz(0), peakRssKb(0) { }
+
+    double wallMs;
+    double mhz;
+    double peakRssKb;
+};
+
+void parseOptions(int argc, char** argv, po::variables_map& vm)
+{
+    po::positional_options_description p;
+    p.add("rom-dir", -1);
+
+    po::options_description desc("Allowed options");
+    desc.add_options()
+        ("help,h", "Prints this help message.")
+        ("rom-dir", "Directory of .gb and .gbc ROMs to run.")
+        ("frames", po::value<uint64_t>()->default_value(600), "Emulated frames each ROM runs for.")
+        ("cycles", po::value<uint64_t>(), "Emulated clock cycles each ROM runs for, instead of --frames.")
+        ("baseline", po::value<std::string>(), "Baseline JSON to compare against, fails on a regression.")
+        ("threshold", po::value<double>()->default_value(10.0), "Percent a ROM may get slower or larger than its baseline.")
+        ("write-baseline", po::value<std::string>(), "Writes the results as a new baseline JSON.")
+        ;
+
+    po::store(po::command_line_parser(argc, argv).
+        options(desc).
+        positional(p).
+        run(), vm);
+    po::notify(vm);
+
+    if (vm.count("help")) {
+        std::cout << ProgramName << ": measures emulation speed over a directory of ROMs" << std::endl << std::endl;
+        std::cout << "Usage: " << ProgramName << " [options] rom-dir" << std::endl << std::endl;
+        std::cout << desc << std::endl;
+        exit(1);
+    }
+}
+
+void errorAndExit(const std::string& err)
+{
+    // Non-zero so that "scons speed" fails rather than passing unmeasured
+    std::cerr << "Error: " << err << std::endl;
+    exit(1);
+}
+
+std::vector<std::string> listRoms(const std::string& dir)
+{
+    std::vector<std::string> roms;
+    DIR* d = opendir(dir.c_str());
+    if (!d) {
+        errorAndExit("could not open rom-dir.");
+    }
+
+    while (dirent* entry = readdir(d)) {
+        std::string name = entry->d_name;
+        size_t dot = name.find_last_of('.');
+        if (dot != std::string::npos && (name.substr(dot) == ".gb" || name.substr(dot) == ".gbc")) {
+            roms.push_back(name);
+        }
+    }
+    closedir(d);
+
+    std::sort(roms.begin(), roms.end());
+    return roms;
+}
+
+/**
+ * Runs romFile headless for cycles, returning the wall time in
+ * milliseconds and the emulated speed, or false if the ROM can't run.
+ */
+bool runRom(const std::string& romFile, uint64_t cycles, double& wallMs, double& mhz)
+{
+    std::ifstream fin(romFile, std::ios_base::binary);
+    std::vector<gb::Byte> rom((std::istreambuf_iterator<char>(fin)), std::istreambuf_iterator<char>());
+    if (!fin || rom.empty()) {
+        return false;
+    }
+
+    gb::Cartridge cartridge(rom);
+    if (!cartridge.isSupported()) {
+        return false;
+    }
+    gb::GameBoy gameBoy;
+    gameBoy.insertCartridge(&cartridge);
+    gameBoy.skipBoot();
+
+    gb::Cpu& cpu = gameBoy.cpu();
+    uint64_t start = cpu.cycles();
+    auto begin = std::chrono::steady_clock::now();
+    while (cpu.cycles() - start < cycles && !cpu.isStopped()) {
+        cpu.processNextInstruction();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+
+    wallMs = 1000*elapsed.count();
+    mhz = (cpu.cycles() - start)/std::max(elapsed.count(), 1e-9)/1e6;
+    return true;
+}
+
+/**
+ * Runs each ROM in a child process so that its peak RSS is its own.
+ */
+bool measureRom(const std::string& romFile, uint64_t cycles, Result& result)
+{
+    int fds[2];
+    if (pipe(fds) != 0) {
+        return false;
+    }
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        return false;
+    }
+    if (pid == 0) {
+        close(fds[0]);
+        double times[2];
+        bool ok = runRom(romFile, cycles, times[0], times[1]);
+        if (ok && write(fds[1], times, sizeof(times)) != sizeof(times)) {
+            ok = false;
+        }
+        _exit(ok ? 0 : 1);
+    }
+
+    close(fds[1]);
+    double times[2];
+    ssize_t length = read(fds[0], times, sizeof(times));
+    close(fds[0]);
+
+    int status = 0;
+    rusage usage;
+    if (wait4(pid, &status, 0, &usage) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0 ||
+            length != sizeof(times)) {
+        return false;
+    }
+
+    result.wallMs = times[0];
+    result.mhz = times[1];
+    result.peakRssKb = usage.ru_maxrss;
+    return true;
+}
+
+void writeBaseline(const std::string& path, const std::map<std::string, Result>& results)
+{
+    std::ofstream out(path);
+    out << "{\n";
+    size_t i = 0;
+    for (const auto& entry : results) {
+        const Result& r = entry.second;
+        out << "  \"" << entry.first << "\": {\"wall_ms\": " << r.wallMs << ", \"mhz\": " << r.mhz
+            << ", \"peak_rss_kb\": " << r.peakRssKb << "}" << (++i < results.size() ? "," : "") << "\n";
+    }
+    out << "}\n";
+    if (!out) {
+        errorAndExit("could not write baseline file.");
+    }
+}
+
+/**
+ * Reads a baseline in the format writeBaseline() writes, one object of
+ * numbers per ROM.
+ */
+std::map<std::string, Result> readBaseline(const std::string& path)
+{
+    std::ifstream in(path);
+    if (!in) {
+        errorAndExit("could not read baseline file.");
+    }
+    std::stringstream ss;
+    ss << in.rdbuf();
+    std::string text = ss.str();
+
+    std::map<std::string, Result> results;
+    std::regex romPattern("\"([^\"]+)\"\\s*:\\s*\\{([^}]*)\\}");
+    std::regex fieldPattern("\"(\\w+)\"\\s*:\\s*([-+0-9.eE]+)");
+    for (std::sregex_iterator rom(text.begin(), text.end(), romPattern), end; rom != end; ++rom) {
+        Result& r = results[(*rom)[1]];
+        std::string fields = (*rom)[2];
+        for (std::sregex_iterator field(fields.begin(), fields.end(), fieldPattern); field != end; ++field) {
+            double val = std::stod((*field)[2]);
+            if ((*field)[1] == "wall_ms") {
+                r.wallMs = val;
+            } else if ((*field)[1] == "mhz") {
+                r.mhz = val;
+            } else if ((*field)[1] == "peak_rss_kb") {
+                r.peakRssKb = val;
+            }
+        }
+    }
+    return results;
+}
+
+int main(int argc, char** argv)
+{
+    po::variables_map vm;
+    parseOptions(argc, argv, vm);
+
+    if (!vm.count("rom-dir")) {
+        errorAndExit("must specify a rom-dir.");
+    }
+    std::string romDir = vm["rom-dir"].as<std::string>();
+    uint64_t cycles = vm.count("cycles") ? vm["cycles"].as<uint64_t>() : vm["frames"].as<uint64_t>()*CyclesPerFrame;
+    double threshold = vm["threshold"].as<double>()/100;
+
+    std::map<std::string, Result> baseline;
+    if (vm.count("baseline")) {
+        baseline = readBaseline(vm["baseline"].as<std::string>());
+    }
+
+    std::vector<std::string> roms = listRoms(romDir);
+    if (roms.empty()) {
+        errorAndExit("no ROMs in rom-dir.");
+    }
+
+    std::map<std::string, Result> results;
+    size_t failures = 0;
+    std::printf("%-32s %10s %10s %12s  %s\n", "rom", "wall ms", "MHz", "peak RSS KB", "status");
+    for (const std::string& rom : roms) {
+        Result result;
+        if (!measureRom(romDir + "/" + rom, cycles, result)) {
+            std::printf("%-32s %10s %10s %12s  %s\n", rom.c_str(), "-", "-", "-", "FAILED to run");
+            ++failures;
+            continue;
+        }
+        results[rom] = result;
+
+        std::string status = "ok";
+        auto base = baseline.find(rom);
+        if (!vm.count("baseline")) {
+            status = "";
+        } else if (base == baseline.end()) {
+            status = "new";
+        } else {
+            char text[64];
+            double speed = 100*(result.mhz/base->second.mhz - 1);
+            double rss = 100*(result.peakRssKb/base->second.peakRssKb - 1);
+            bool isRegressed = result.mhz < base->second.mhz*(1 - threshold) ||
+                               result.peakRssKb > base->second.peakRssKb*(1 + threshold);
+            std::snprintf(text, sizeof(text), "%s, speed %+.1f%%, RSS %+.1f%%",
+                          isRegressed ? "REGRESSED" : "ok", speed, rss);
+            status = text;
+            failures += isRegressed ? 1 : 0;
+        }
+        std::printf("%-32s %10.1f %10.2f %12.0f  %s\n", rom.c_str(), result.wallMs, result.mhz,
+                    result.peakRssKb, status.c_str());
+    }
+
+    if (vm.count("write-baseline")) {
+        writeBaseline(vm["write-baseline"].as<std::string>(), results);
+    }
+
+    if (failures > 0) {
+        std::printf("%zu of %zu ROMs failed\n", failures, roms.size());
+        return 1;
+    }
+    return 0;
+}
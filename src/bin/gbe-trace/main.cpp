@@ -0,0 +1,76 @@
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <boost/program_options.hpp>
+namespace po = boost::program_options;
+
+#include <cpu/tracer.h>
+
+const std::string ProgramName = "gbe-trace";
+
+void parseOptions(int argc, char** argv, po::variables_map& vm)
+{
+    po::positional_options_description p;
+    p.add("trace-file", -1);
+
+    po::options_description desc("Allowed options");     
+    desc.add_options()
+        ("help,h", "Prints this help message.")
+        ("trace-file", "Trace written by gbe --trace.")
+        ("last", po::value<size_t>(), "Prints only the last N instructions.")
+        ("from-cycle", po::value<uint64_t>(), "Skips instructions before the given cycle.")
+        ;
+
+    po::store(po::command_line_parser(argc, argv).
+        options(desc).
+        positional(p).
+        run(), vm);
+    po::notify(vm);
+
+    if (vm.count("help")) {
+        std::cout << ProgramName << ": formats GameBoy instruction traces" << std::endl << std::endl;
+        std::cout << "Usage: " << ProgramName << " [options] file" << std::endl << std::endl;
+        std::cout << desc << std::endl;
+        exit(1);
+    }
+}
+
+void errorAndExit(const std::string& err)
+{
+    std::cerr << "Error: " << err << std::endl;
+    exit(0);
+}
+
+int main(int argc, char** argv)
+{
+    po::variables_map vm;
+    parseOptions(argc, argv, vm);
+
+    if (!vm.count("trace-file")) {
+        errorAndExit("must specify a trace file.");
+    }
+
+    std::vector<gb::TraceRecord> records;
+    if (!gb::loadTrace(vm["trace-file"].as<std::string>(), records)) {
+        errorAndExit("could not read trace file.");
+    }
+
+    size_t first = 0;
+    if (vm.count("last") && vm["last"].as<size_t>() < records.size()) {
+        first = records.size() - vm["last"].as<size_t>();
+    }
+    uint64_t fromCycle = vm.count("from-cycle") ? vm["from-cycle"].as<uint64_t>() : 0;
+
+    // Traces run to millions of lines, so no iostream formatting here
+    for (size_t i = first; i < records.size(); ++i) {
+        const gb::TraceRecord& r = records[i];
+        if (r.cycles < fromCycle) {
+            continue;
+        }
+        std::printf("%12llu  %04x  %02x  AF=%04x BC=%04x DE=%04x HL=%04x SP=%04x\n",
+                    static_cast<unsigned long long>(r.cycles), r.pc, r.opcode,
+                    r.af, r.bc, r.de, r.hl, r.sp);
+    }
+}
@@ -1,15 +1,75 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <iterator>
+#include <memory>
+#include <thread>
+#include <vector>
 
 #include <boost/program_options.hpp>
 namespace po = boost::program_options;
 
+#include <cpu/cartridge.h>
 #include <cpu/cpu.h>
-#include <cpu/memory.h>
+#include <cpu/debugger.h>
+#include <cpu/gameboy.h>
+#include <cpu/gdbstub.h>
+#include <cpu/linkcable.h>
+#include <cpu/profiler.h>
+#include <cpu/sampler.h>
+#include <cpu/tracer.h>
+#include <util/audio.h>
+#include <util/framedump.h>
+#include <util/metrics.h>
+#include <util/symbols.h>
 
 const std::string ProgramName = "gbe";
 
+// Clock cycles in one LCD frame
+const uint64_t CyclesPerFrame = 70224;
+
+// Opcodes and PCs listed in the --profile report
+const size_t ProfileReportSize = 20;
+
+// Size of the register snapshot appended to a dumped frame
+const size_t RegisterDumpSize = 12;
+
+// Interleaved samples queued for the audio thread, and frames pulled per
+// period
+const size_t AudioRingSize = 8192;
+const size_t AudioPeriodFrames = 512;
+
+struct FrameDump
+{
+    gb::FrameDumpWriter* writer;
+    int interval;
+    bool withRegisters;
+};
+
+// Published over --metrics-socket, refreshed once per frame
+struct RunMetrics
+{
+    gb::Metrics::Metric* instructions;
+    gb::Metrics::Metric* cycles;
+    gb::Metrics::Metric* frames;
+    gb::Metrics::Metric* speedRatio;
+    gb::Metrics::Metric* dumpedFrames;
+    gb::Metrics::Metric* droppedFrames;
+    gb::Metrics::Metric* emulationSeconds;
+    gb::Metrics::Metric* frameDumpSeconds;
+    gb::Metrics::Metric* audioSeconds;
+};
+
+struct AudioStream
+{
+    gb::AudioRing* ring;
+    gb::RateController* rateController;
+    std::vector<int16_t> buffer;
+};
+
 void parseOptions(int argc, char** argv, po::variables_map& vm)
 {
     po::positional_options_description p;
@@ -22,6 +82,28 @@ void parseOptions(int argc, char** argv, po::variables_map& vm)
         ("input-rom", "Input ROM to execute in emulator.")
         ("dump-registers", "Dumps the contents of CPU registers.")
         ("dump-memory", "Dumps the contents of memory.")
+        ("dump-frames", po::value<std::string>(), "Streams delta-coded VRAM snapshots to the given file. Frames are dropped if the disk can't keep up for long.")
+        ("dump-interval", po::value<int>()->default_value(1), "Dumps every Nth frame.")
+        ("dump-frame-registers", "Includes CPU registers with each dumped frame.")
+        ("boot-rom", po::value<std::string>(), "Runs the given DMG boot ROM instead of skipping to the post-boot state.")
+        ("break", po::value<std::vector<std::string>>()->composing(), "Stops when execution reaches the given hex address. May be repeated.")
+        ("watch", po::value<std::vector<std::string>>()->composing(), "Stops when the given hex address is written. May be repeated.")
+        ("gdb-port", po::value<int>(), "Waits for a GDB remote protocol client on the given localhost port before running.")
+        ("trace", po::value<std::string>(), "Records the last instructions executed to the given file, for gbe-trace. Needs a trace=1 build.")
+        ("trace-size", po::value<size_t>()->default_value(1 << 20), "Number of instructions kept by --trace.")
+        ("profile", po::value<std::string>(), "Counts executions and cycles per opcode and PC, printing the top ones and writing all of them to the given JSON file. Needs a profile=1 build.")
+        ("sample", po::value<std::string>(), "Samples the PC and call stack, writing folded stacks for flamegraph tools to the given file. Needs a profile=1 build.")
+        ("sample-interval", po::value<uint64_t>()->default_value(4096), "Clock cycles between --sample samples.")
+        ("symbols", po::value<std::string>(), "RGBDS .sym file naming the addresses in --sample stacks.")
+        ("metrics-socket", po::value<std::string>(), "Serves run metrics in the Prometheus text format on the given UNIX socket.")
+        ("input", po::value<std::string>(), "Replays joypad input, lines of: cycle button press|release.")
+        ("print-serial", "Prints the bytes sent over the serial port.")
+        ("link-rom", po::value<std::string>(), "Runs a second emulator on another thread, linked by cable.")
+        ("dump-audio", po::value<std::string>(), "Streams audio to the given WAV file.")
+        ("audio-realtime", "Pulls audio at real time speed, throttling emulation to it.")
+        ("save-file", po::value<std::string>(), "Battery-backed RAM file, defaults to the ROM path with a .sav extension.")
+        ("no-save", "Doesn't persist battery-backed RAM.")
+        ("real-time-clock", "Runs the cartridge clock from host time instead of emulated time.")
         ;
 
     po::store(po::command_line_parser(argc, argv).
@@ -44,14 +126,13 @@ void errorAndExit(const std::string& err)
     exit(0);
 }
 
-void loadRom(const std::string& romFile, gb::Memory* memory, bool verbose)
+gb::Cartridge* loadRom(const std::string& romFile, bool verbose)
 {
     std::ifstream fin(romFile, std::ios_base::binary);
     if (!fin) {
         errorAndExit("rom-file does not exist.");
     }
 
-    // ROM file can be copied directly into the emulator's memory
     fin.seekg(0, fin.end);
     int length = fin.tellg();
     fin.seekg(0, fin.beg);
@@ -61,30 +142,143 @@ void loadRom(const std::string& romFile, gb::Memory* memory, bool verbose)
                   << std::endl;
     }
 
-    char* buffer = new char[length];
-    fin.read(buffer, length);
+    std::vector<gb::Byte> rom(length);
+    fin.read(reinterpret_cast<char*>(rom.data()), length);
 
-    // Might not be fully correct, the real device will have randomized memory on
-    // start but it sure helps with debugging to have it zero'd. 
-    for (size_t i = 0; i < memory->size(); ++i) {
-        (*memory)[i] = 0x00;
+    gb::Cartridge* cartridge = new gb::Cartridge(rom);
+    if (!cartridge->isSupported()) {
+        errorAndExit("unsupported cartridge type " + gb::toStr(cartridge->type()) + ".");
     }
 
-    for (size_t i = 0; i < length; ++i) {
-        (*memory)[i] = buffer[i];
+    if (verbose) {
+        std::cout << "Cartridge \"" << cartridge->title() << "\" type " << gb::toStr(cartridge->type())
+                  << ", " << cartridge->romBanks() << " ROM banks, " << cartridge->ramBanks()
+                  << " RAM banks" << std::endl;
     }
+    return cartridge;
+}
 
-    delete[] buffer;
+std::string defaultSavePath(const std::string& romFile)
+{
+    size_t dot = romFile.find_last_of('.');
+    size_t slash = romFile.find_last_of('/');
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+        return romFile + ".sav";
+    }
+    return romFile.substr(0, dot) + ".sav";
 }
 
-void execLoop(gb::Cpu& cpu, gb::Memory& memory, bool verbose)
+void loadSave(gb::Cartridge& cartridge, const std::string& savePath, bool verbose)
 {
-    while (!cpu.isStopped()) {
-        cpu.processNextInstruction(); 
+    if (!cartridge.loadSave(savePath)) {
+        errorAndExit("could not open save-file.");
     }
 
     if (verbose) {
-        std::cout << "STOP instruction encountered" << std::endl;
+        std::cout << "Mapped save RAM from " << savePath << std::endl;
+    }
+}
+
+void loadBootRom(gb::GameBoy& gameBoy, const std::string& bootRomFile)
+{
+    std::ifstream fin(bootRomFile, std::ios_base::binary);
+    if (!fin) {
+        errorAndExit("boot-rom does not exist.");
+    }
+
+    std::vector<gb::Byte> image((std::istreambuf_iterator<char>(fin)), std::istreambuf_iterator<char>());
+    if (!gameBoy.loadBootRom(image)) {
+        errorAndExit("boot-rom must be " + std::to_string(gb::BootRom::Size) + " bytes.");
+    }
+}
+
+void dumpFrame(gb::GameBoy& gameBoy, FrameDump& dump, uint32_t frame)
+{
+    // No PPU yet, so VRAM is the closest thing to a framebuffer
+    gb::Memory& vram = gameBoy.vram();
+    gb::Byte* buffer = dump.writer->frameBuffer();
+    std::copy(vram.data(), vram.data() + vram.size(), buffer);
+
+    if (dump.withRegisters) {
+        gb::Cpu::Registers& regs = gameBoy.cpu().registers();
+        gb::Byte* out = buffer + vram.size();
+        for (gb::Word reg : {regs.AF, regs.BC, regs.DE, regs.HL, regs.SP, regs.PC}) {
+            *out++ = reg & 0x00FF;
+            *out++ = reg >> 8;
+        }
+    }
+
+    dump.writer->submit(frame);
+}
+
+bool parseButton(const std::string& name, gb::Joypad::Button& button)
+{
+    const char* names[] = {"right", "left", "up", "down", "a", "b", "select", "start"};
+    for (int i = 0; i < 8; ++i) {
+        if (name == names[i]) {
+            button = static_cast<gb::Joypad::Button>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+void loadInput(const std::string& inputFile, std::vector<gb::Joypad::Event>& events)
+{
+    std::ifstream fin(inputFile);
+    if (!fin) {
+        errorAndExit("input file does not exist.");
+    }
+
+    uint64_t time = 0;
+    std::string name, action;
+    while (fin >> time >> name >> action) {
+        gb::Joypad::Event event = {time, gb::Joypad::ButtonA, action == "press"};
+        if (!parseButton(name, event.button) || (action != "press" && action != "release")) {
+            errorAndExit("invalid input line \"" + std::to_string(time) + " " + name + " " + action + "\".");
+        }
+        events.push_back(event);
+    }
+}
+
+/**
+ * Gives up on the rest of events once isStopping is set, as nothing drains
+ * the joypad queue after the run ends.
+ */
+void postInput(gb::Joypad* joypad, const std::vector<gb::Joypad::Event>& events,
+               const std::atomic<bool>* isStopping)
+{
+    for (const gb::Joypad::Event& event : events) {
+        while (!joypad->post(event)) {
+            if (*isStopping) {
+                return;
+            }
+            // The emulator picks events up about once a frame
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+}
+
+void pushAudio(gb::Apu& apu, AudioStream& audio)
+{
+    size_t frames = 0;
+    while ((frames = apu.readFrames(audio.buffer.data(), audio.buffer.size()/2)) > 0) {
+        const int16_t* samples = audio.buffer.data();
+        size_t remaining = 2*frames;
+        while (remaining > 0) {
+            size_t written = audio.ring->write(samples, remaining);
+            samples += written;
+            remaining -= written;
+            if (remaining > 0) {
+                // The audio thread is behind, let it catch up
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+    }
+
+    if (audio.rateController) {
+        double fill = static_cast<double>(audio.ring->size())/audio.ring->capacity();
+        apu.setSampleRate(audio.rateController->update(fill));
     }
 }
 
@@ -95,6 +289,113 @@ std::string registerToString(gb::Word word)
     return ss.str();
 }
 
+gb::Word parseAddress(const std::string& str)
+{
+    size_t end = 0;
+    unsigned long address = 0;
+    try {
+        address = std::stoul(str, &end, 16);
+    } catch (const std::exception&) {
+        end = 0;
+    }
+    if (end == 0 || end != str.size() || address > 0xFFFF) {
+        errorAndExit("invalid address \"" + str + "\".");
+    }
+    return static_cast<gb::Word>(address);
+}
+
+void addBreakpoints(gb::Debugger& debugger, po::variables_map& vm)
+{
+    if (vm.count("break")) {
+        for (const std::string& address : vm["break"].as<std::vector<std::string>>()) {
+            debugger.addBreakpoint(parseAddress(address));
+        }
+    }
+    if (vm.count("watch")) {
+        for (const std::string& address : vm["watch"].as<std::vector<std::string>>()) {
+            debugger.addWatchpoint(parseAddress(address), gb::MMU::AccessWrite);
+        }
+    }
+}
+
+void publishMetrics(RunMetrics& metrics, gb::GameBoy& gameBoy, FrameDump* dump, uint32_t frames,
+                    double wallSeconds)
+{
+    gb::Cpu& cpu = gameBoy.cpu();
+    metrics.instructions->set(cpu.instructions());
+    metrics.cycles->set(cpu.cycles());
+    metrics.frames->set(frames);
+    metrics.speedRatio->set(static_cast<double>(cpu.clock())/gb::Apu::ClockRate/wallSeconds);
+    if (dump) {
+        metrics.dumpedFrames->set(dump->writer->framesWritten());
+        metrics.droppedFrames->set(dump->writer->framesDropped());
+    }
+}
+
+/**
+ * Runs until STOP, a breakpoint or watchpoint, or isStopping is set, which
+ * is checked once a frame. isStopping is optional.
+ */
+void execLoop(gb::GameBoy& gameBoy, gb::Debugger& debugger, FrameDump* dump, AudioStream* audio,
+              RunMetrics* metrics, const std::atomic<bool>* isStopping, bool verbose)
+{
+    typedef std::chrono::steady_clock Clock;
+    typedef std::chrono::duration<double> Seconds;
+    Clock::time_point start = Clock::now();
+    Seconds emulation(0);
+    Seconds frameDump(0);
+    Seconds audioOut(0);
+
+    // A GDB session may already have run the machine, so carry on from the
+    // frame it reached rather than catching up in a burst
+    uint32_t frame = static_cast<uint32_t>(gameBoy.cpu().clock()/CyclesPerFrame);
+    gb::Debugger::StopReason reason = gb::Debugger::StopNone;
+    while (reason == gb::Debugger::StopNone && !(isStopping && *isStopping)) {
+        Clock::time_point emulationStart = Clock::now();
+        // Frames are on the machine clock, which doesn't speed up in CGB
+        // double speed
+        reason = debugger.run((frame + 1)*CyclesPerFrame);
+        Clock::time_point dumpStart = Clock::now();
+
+        if (dump && frame % dump->interval == 0) {
+            dumpFrame(gameBoy, *dump, frame);
+        }
+        Clock::time_point audioStart = Clock::now();
+        if (audio) {
+            pushAudio(gameBoy.apu(), *audio);
+        }
+        ++frame;
+
+        if (metrics) {
+            Clock::time_point end = Clock::now();
+            emulation += dumpStart - emulationStart;
+            frameDump += audioStart - dumpStart;
+            audioOut += end - audioStart;
+            metrics->emulationSeconds->set(emulation.count());
+            metrics->frameDumpSeconds->set(frameDump.count());
+            metrics->audioSeconds->set(audioOut.count());
+            publishMetrics(*metrics, gameBoy, dump, frame, Seconds(end - start).count());
+        }
+    }
+
+    gb::Cpu::Registers& regs = gameBoy.cpu().registers();
+    switch (reason) {
+        case gb::Debugger::StopBreakpoint:
+            std::cout << "Breakpoint at " << registerToString(regs.PC) << std::endl;
+            break;
+        case gb::Debugger::StopWatchpoint:
+            std::cout << "Watchpoint at " << registerToString(debugger.watchAddress()) << " written with "
+                      << gb::toStr(debugger.watchValue()) << ", PC " << registerToString(regs.PC)
+                      << std::endl;
+            break;
+        default:
+            if (verbose) {
+                std::cout << "STOP instruction encountered" << std::endl;
+            }
+            break;
+    }
+}
+
 std::string flagsToString(gb::Cpu& cpu)
 {
     std::stringstream ss;
@@ -122,12 +423,12 @@ void dumpRegisters(gb::Cpu& cpu)
               << "F: " << flagsToString(cpu) << std::endl;
 }
 
-void dumpMemory(gb::Memory& memory)
+void dumpMemory(gb::Addressable& memory, size_t size)
 {
     const int ChunkSize = 8;
 
-    int i = 0;
-    while (i < memory.size()) {
+    size_t i = 0;
+    while (i < size) {
         std::cout << "0x" << std::hex << std::setfill('0') << std::setw(4) << i << "    ";
 
         for (int j = 0; j < ChunkSize; ++j) {
@@ -150,18 +451,257 @@ int main(int argc, char** argv)
 
     bool verbose = vm.count("verbose");
 
-    gb::Memory memory(32);
-    gb::Cpu cpu;
-    cpu.setMemory(&memory);
+    std::string romFile = vm["input-rom"].as<std::string>();
+    std::unique_ptr<gb::Cartridge> cartridge(loadRom(romFile, verbose));
+    cartridge->rtc().setRealTime(vm.count("real-time-clock") > 0);
+
+    bool hasSaveData = cartridge->ramBanks() > 0 || cartridge->hasRtc();
+    if (cartridge->hasBattery() && hasSaveData && !vm.count("no-save")) {
+        std::string savePath = vm.count("save-file") ? vm["save-file"].as<std::string>() : defaultSavePath(romFile);
+        loadSave(*cartridge, savePath, verbose);
+    }
+
+    gb::GameBoy gameBoy;
+    if (vm.count("boot-rom")) {
+        loadBootRom(gameBoy, vm["boot-rom"].as<std::string>());
+    }
+    gameBoy.insertCartridge(cartridge.get());
+    if (!vm.count("boot-rom")) {
+        gameBoy.skipBoot();
+    }
+
+    gb::Debugger debugger(&gameBoy.cpu(), &gameBoy.mmu());
+    addBreakpoints(debugger, vm);
+
+    std::unique_ptr<gb::Tracer> tracer;
+    if (vm.count("trace")) {
+        if (!gb::IsTraceEnabled) {
+            errorAndExit("tracing is compiled out, rebuild with trace=1.");
+        }
+        tracer.reset(new gb::Tracer(vm["trace-size"].as<size_t>()));
+        gameBoy.cpu().setTracer(tracer.get());
+    }
+
+    std::unique_ptr<gb::Profiler> profiler;
+    if (vm.count("profile")) {
+        if (!gb::IsProfileEnabled) {
+            errorAndExit("profiling is compiled out, rebuild with profile=1.");
+        }
+        profiler.reset(new gb::Profiler());
+        gameBoy.cpu().setProfiler(profiler.get());
+    }
 
-    loadRom(vm["input-rom"].as<std::string>(), &memory, verbose);
-    execLoop(cpu, memory, verbose);
+    std::unique_ptr<gb::Sampler> sampler;
+    gb::SymbolTable symbols;
+    if (vm.count("sample")) {
+        if (!gb::IsProfileEnabled) {
+            errorAndExit("profiling is compiled out, rebuild with profile=1.");
+        }
+        if (vm["sample-interval"].as<uint64_t>() == 0) {
+            errorAndExit("sample interval must be positive.");
+        }
+        sampler.reset(new gb::Sampler(&gameBoy.cpu(), &gameBoy.scheduler(), vm["sample-interval"].as<uint64_t>()));
+        sampler->setCartridge(cartridge.get());
+        gameBoy.cpu().setSampler(sampler.get());
+
+        if (vm.count("symbols") && !symbols.load(vm["symbols"].as<std::string>())) {
+            errorAndExit("could not read symbol file.");
+        }
+    }
+
+    std::unique_ptr<gb::FrameDumpWriter> frameWriter;
+    FrameDump frameDump = {nullptr, vm["dump-interval"].as<int>(), vm.count("dump-frame-registers") > 0};
+    if (vm.count("dump-frames")) {
+        if (frameDump.interval < 1) {
+            errorAndExit("dump-interval must be at least 1.");
+        }
+
+        size_t frameSize = gameBoy.vram().size() + (frameDump.withRegisters ? RegisterDumpSize : 0);
+        frameWriter.reset(new gb::FrameDumpWriter(vm["dump-frames"].as<std::string>(), frameSize));
+        if (!frameWriter->isOpen()) {
+            errorAndExit("could not open dump-frames file.");
+        }
+        frameDump.writer = frameWriter.get();
+    }
+
+    std::unique_ptr<gb::WavWriter> wavWriter;
+    std::unique_ptr<gb::AudioRing> audioRing;
+    std::unique_ptr<gb::AudioOutput> audioOutput;
+    std::unique_ptr<gb::RateController> rateController;
+    AudioStream audioStream = {nullptr, nullptr, std::vector<int16_t>(2*AudioPeriodFrames)};
+    if (vm.count("dump-audio")) {
+        unsigned sampleRate = gameBoy.apu().sampleRate();
+        wavWriter.reset(new gb::WavWriter(vm["dump-audio"].as<std::string>(), sampleRate));
+        if (!wavWriter->isOpen()) {
+            errorAndExit("could not open dump-audio file.");
+        }
+
+        bool isRealTime = vm.count("audio-realtime") > 0;
+        audioRing.reset(new gb::AudioRing(AudioRingSize));
+        audioOutput.reset(new gb::AudioOutput(audioRing.get(), wavWriter.get(), sampleRate,
+                                              AudioPeriodFrames, isRealTime));
+        if (isRealTime) {
+            rateController.reset(new gb::RateController(sampleRate));
+        }
+        audioStream.ring = audioRing.get();
+        audioStream.rateController = rateController.get();
+    }
+
+    // Input is fed from its own thread, as a frontend would. The input and
+    // linked emulator threads run until this one is done, which sets
+    // isRunOver.
+    std::atomic<bool> isRunOver(false);
+    std::vector<gb::Joypad::Event> inputEvents;
+    std::thread inputThread;
+    if (vm.count("input")) {
+        loadInput(vm["input"].as<std::string>(), inputEvents);
+        inputThread = std::thread(postInput, &gameBoy.joypad(), std::cref(inputEvents), &isRunOver);
+    }
 
+    // The linked emulator runs on its own thread, the serial ports keep the
+    // two in step
+    std::unique_ptr<gb::Cartridge> linkedCartridge;
+    std::unique_ptr<gb::GameBoy> linkedGameBoy;
+    gb::LinkCable linkCable;
+    std::thread linkThread;
+    if (vm.count("link-rom")) {
+        linkedCartridge.reset(loadRom(vm["link-rom"].as<std::string>(), verbose));
+        linkedGameBoy.reset(new gb::GameBoy());
+        linkedGameBoy->insertCartridge(linkedCartridge.get());
+        linkedGameBoy->skipBoot();
+
+        gameBoy.serial().connect(&linkCable, 0);
+        linkedGameBoy->serial().connect(&linkCable, 1);
+        gb::GameBoy* linked = linkedGameBoy.get();
+        linkThread = std::thread([linked, &isRunOver] {
+            gb::Debugger linkedDebugger(&linked->cpu(), &linked->mmu());
+            execLoop(*linked, linkedDebugger, nullptr, nullptr, nullptr, &isRunOver, false);
+            linked->serial().disconnect();
+        });
+    }
+
+    std::unique_ptr<gb::Metrics> metrics;
+    RunMetrics runMetrics;
+    if (vm.count("metrics-socket")) {
+        metrics.reset(new gb::Metrics());
+        runMetrics.instructions = metrics->add("gbe_instructions_total", "", gb::Metrics::TypeCounter,
+                                               "Instructions executed.");
+        runMetrics.cycles = metrics->add("gbe_cycles_total", "", gb::Metrics::TypeCounter,
+                                         "CPU clock cycles executed.");
+        runMetrics.frames = metrics->add("gbe_frames_total", "", gb::Metrics::TypeCounter,
+                                         "LCD frames emulated.");
+        runMetrics.speedRatio = metrics->add("gbe_speed_ratio", "", gb::Metrics::TypeGauge,
+                                             "Emulated time over wall time since the run started.");
+        runMetrics.dumpedFrames = metrics->add("gbe_dumped_frames_total", "", gb::Metrics::TypeCounter,
+                                               "Frames written by --dump-frames.");
+        runMetrics.droppedFrames = metrics->add("gbe_dropped_frames_total", "", gb::Metrics::TypeCounter,
+                                                "Frames --dump-frames dropped while the writer was busy.");
+
+        const std::string help = "Wall time spent in each part of the run loop.";
+        runMetrics.emulationSeconds = metrics->add("gbe_subsystem_seconds_total", "subsystem=\"emulation\"",
+                                                   gb::Metrics::TypeCounter, help);
+        runMetrics.frameDumpSeconds = metrics->add("gbe_subsystem_seconds_total", "subsystem=\"frame_dump\"",
+                                                   gb::Metrics::TypeCounter, help);
+        runMetrics.audioSeconds = metrics->add("gbe_subsystem_seconds_total", "subsystem=\"audio\"",
+                                               gb::Metrics::TypeCounter, help);
+
+        if (!metrics->listen(vm["metrics-socket"].as<std::string>())) {
+            errorAndExit("could not listen on metrics-socket.");
+        }
+    }
+
+    // A debugger client drives the emulator until it detaches, then the run
+    // carries on as normal
+    bool isKilled = false;
+    if (vm.count("gdb-port")) {
+        int port = vm["gdb-port"].as<int>();
+        gb::GdbStub gdbStub(&gameBoy.cpu(), &gameBoy.mmu(), &debugger);
+        if (!gdbStub.listen(port)) {
+            errorAndExit("could not listen on gdb-port.");
+        }
+
+        std::cout << "Waiting for GDB on port " << port << std::endl;
+        if (!gdbStub.serve()) {
+            errorAndExit("could not accept a GDB connection.");
+        }
+        isKilled = gdbStub.isKilled();
+    }
+
+    if (!isKilled) {
+        execLoop(gameBoy, debugger, frameDump.writer ? &frameDump : nullptr,
+                 audioStream.ring ? &audioStream : nullptr, metrics.get() ? &runMetrics : nullptr, nullptr,
+                 verbose);
+    }
+
+    isRunOver = true;
+    if (linkThread.joinable()) {
+        gameBoy.serial().disconnect();
+        linkThread.join();
+    }
+    if (inputThread.joinable()) {
+        inputThread.join();
+    }
+
+    if (audioOutput) {
+        audioOutput->close();
+        if (verbose) {
+            std::cout << "Wrote " << wavWriter->framesWritten() << " audio frames, "
+                      << audioOutput->underruns() << " underruns" << std::endl;
+        }
+    }
+
+    // The rest of the run's output is still written, but a truncated dump
+    // has to fail the run
+    int status = 0;
+    if (frameWriter) {
+        if (!frameWriter->close()) {
+            std::cerr << "Error: could not write dump-frames file." << std::endl;
+            status = 1;
+        }
+        if (verbose) {
+            std::cout << "Dumped " << frameWriter->framesWritten() << " frames, dropped "
+                      << frameWriter->framesDropped() << std::endl;
+        }
+    }
+
+    if (tracer) {
+        if (!tracer->save(vm["trace"].as<std::string>())) {
+            errorAndExit("could not write trace file.");
+        }
+        if (verbose) {
+            std::cout << "Traced " << tracer->count() << " instructions" << std::endl;
+        }
+    }
+
+    if (profiler) {
+        std::ofstream json(vm["profile"].as<std::string>());
+        profiler->writeJson(json);
+        if (!json) {
+            errorAndExit("could not write profile file.");
+        }
+        profiler->writeReport(std::cout, ProfileReportSize);
+    }
+
+    if (sampler) {
+        std::ofstream folded(vm["sample"].as<std::string>());
+        sampler->writeFolded(folded, symbols);
+        if (!folded) {
+            errorAndExit("could not write sample file.");
+        }
+        if (verbose) {
+            std::cout << "Sampled " << sampler->samples() << " stacks" << std::endl;
+        }
+    }
+
+    if (vm.count("print-serial")) {
+        std::cout << gameBoy.serial().output() << std::endl;
+    }
     if (vm.count("dump-registers")) {
-        dumpRegisters(cpu);
+        dumpRegisters(gameBoy.cpu());
     }
     if (vm.count("dump-memory")) {
-        dumpMemory(memory);
+        dumpMemory(gameBoy.mmu(), 0x10000);
     }
+    return status;
 }
 
@@ -9,12 +9,35 @@ namespace gb {
  * An interface defining an addressable model on an object.
  *
  * A gb::Word is defined as the smallest addressable value.
+ *
+ * operator[] gives raw access to the stored value. Emulated accesses go
+ * through read() and write(), which devices with side effects on access
+ * (I/O registers) override.
  */
 class Addressable
 {
 public:
     virtual gb::Byte& operator[](size_t address) = 0;
     virtual bool isValidAddress(size_t address) const = 0;
+
+    virtual gb::Byte read(size_t address)
+    {
+        return (*this)[address];
+    }
+
+    virtual void write(size_t address, gb::Byte val)
+    {
+        (*this)[address] = val;
+    }
+
+    /**
+     * Contiguous storage backing every address, or nullptr if accesses have
+     * side effects and must go through read() and write().
+     */
+    virtual gb::Byte* data()
+    {
+        return nullptr;
+    }
 };
 
 }
@@ -0,0 +1,604 @@
+#include "apu.h"
+using gb::Apu;
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+#include "util/blep.h"
+
+namespace {
+
+// The frame sequencer clocks lengths, sweep and envelopes at 512Hz
+const uint64_t FrameSequencerPeriod = 8192;
+
+// Square wave duty cycles, the first step in the high bit
+const gb::Byte DutyPatterns[4] = {0x01, 0x81, 0x87, 0x7E};
+
+const uint64_t NoiseDivisors[8] = {8, 16, 32, 48, 64, 80, 96, 112};
+
+// Bits which read back as 1 in each register
+const gb::Byte ReadMasks[Apu::NumRegisters] = {
+    0x80, 0x3F, 0x00, 0xFF, 0xBF,
+    0xFF, 0x3F, 0x00, 0xFF, 0xBF,
+    0x7F, 0xFF, 0x9F, 0xFF, 0xBF,
+    0xFF, 0xFF, 0x00, 0x00, 0xBF,
+    0x00, 0x00, 0x70, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+};
+
+// Four channels at full volume through the loudest master volume use the
+// full sample range
+const float OutputScale = 32767.0f/(Apu::NumChannels*15*8);
+
+int16_t clampSample(float sample)
+{
+    return static_cast<int16_t>(std::max(-32768.0f, std::min(32767.0f, sample)));
+}
+
+}
+
+Apu::Apu(Scheduler* scheduler, unsigned sampleRate) :
+    _scheduler(scheduler),
+    _sampleRate(sampleRate),
+    _capacity(sampleRate/4 + gb::BlepWidth + 1)
+{
+    assert(_scheduler && _sampleRate > 0);
+
+    for (ChannelState& ch : _channels) {
+        ch.deltas.resize(_capacity, 0.0f);
+    }
+    _left.resize(_capacity, 0.0f);
+    _right.resize(_capacity, 0.0f);
+
+    _updateHighPass();
+    reset();
+}
+
+Apu::~Apu()
+{
+}
+
+void Apu::reset()
+{
+    std::fill(_regs, _regs + NumRegisters, 0x00);
+    _regs[RegNR52] = 0x80;
+
+    for (ChannelState& ch : _channels) {
+        ch.isOn = false;
+        ch.isDacOn = false;
+        ch.isLengthEnabled = false;
+        ch.length = 0;
+        ch.volume = 0;
+        ch.envelopeTimer = 0;
+        ch.position = 0;
+        ch.nextStep = 0;
+        ch.level = 0;
+        std::fill(ch.deltas.begin(), ch.deltas.end(), 0.0f);
+    }
+
+    _isPowered = true;
+    _time = _scheduler->now();
+    _nextFrameSequencer = _time + FrameSequencerPeriod;
+    _frameSequencerStep = 0;
+
+    _sweepTimer = 0;
+    _sweepShadow = 0;
+    _isSweepEnabled = false;
+    _lfsr = 0x7FFF;
+
+    _startTick = _time*_sampleRate;
+    _dirtyBegin = _capacity;
+    _dirtyEnd = 0;
+    std::fill(_left.begin(), _left.end(), 0.0f);
+    std::fill(_right.begin(), _right.end(), 0.0f);
+    _sum[0] = _sum[1] = 0.0f;
+    _highPass[0] = _highPass[1] = 0.0f;
+}
+
+void Apu::setSampleRate(unsigned sampleRate)
+{
+    assert(sampleRate > 0);
+    sync();
+
+    // Keep the current time at the same output position so steps already
+    // in the buffers stay where they are
+    _startTick = _time*sampleRate - _tick(_time);
+    _sampleRate = sampleRate;
+    _updateHighPass();
+}
+
+void Apu::sync()
+{
+    _run(_scheduler->now());
+    _mix();
+}
+
+size_t Apu::framesAvailable() const
+{
+    return _samplePosition(_time);
+}
+
+size_t Apu::readFrames(int16_t* out, size_t frames)
+{
+    sync();
+    frames = std::min(frames, framesAvailable());
+    _consume(out, frames);
+    return frames;
+}
+
+gb::Byte& Apu::operator[](size_t address)
+{
+    assert(isValidAddress(address));
+    return _regs[address];
+}
+
+bool Apu::isValidAddress(size_t address) const
+{
+    return address < NumRegisters;
+}
+
+gb::Byte Apu::read(size_t address)
+{
+    assert(isValidAddress(address));
+
+    if (address == RegNR52) {
+        // Lengths may have run out since the last block
+        sync();
+
+        gb::Byte status = _isPowered ? 0x80 : 0x00;
+        for (int c = 0; c < NumChannels; ++c) {
+            status |= _channels[c].isOn ? (1 << c) : 0;
+        }
+        return status | ReadMasks[RegNR52];
+    }
+    return _regs[address] | ReadMasks[address];
+}
+
+void Apu::write(size_t address, gb::Byte val)
+{
+    assert(isValidAddress(address));
+
+    // Everything up to now was generated with the old register values
+    sync();
+    _writeRegister(address, val);
+}
+
+size_t Apu::_frequency(Channel channel) const
+{
+    size_t base = _base(channel);
+    return _regs[base + 3] | ((_regs[base + 4] & 0x07) << 8);
+}
+
+uint64_t Apu::_period(Channel channel) const
+{
+    switch (channel) {
+        case ChannelSquare1:
+        case ChannelSquare2:
+            return (2048 - _frequency(channel))*4;
+        case ChannelWave:
+            return (2048 - _frequency(channel))*2;
+        case ChannelNoise:
+            return NoiseDivisors[_regs[RegNR43] & 0x07] << (_regs[RegNR43] >> 4);
+        default:
+            assert(false && "Apu: invalid channel");
+            return 0;
+    }
+}
+
+int Apu::_output(Channel channel) const
+{
+    const ChannelState& ch = _channels[channel];
+    if (!ch.isOn) {
+        return 0;
+    }
+
+    switch (channel) {
+        case ChannelSquare1:
+        case ChannelSquare2:
+        {
+            gb::Byte duty = DutyPatterns[_regs[_base(channel) + 1] >> 6];
+            return ((duty >> (7 - ch.position)) & 0x01) ? ch.volume : 0;
+        }
+        case ChannelWave:
+        {
+            gb::Byte sample = _regs[RegWave + ch.position/2];
+            sample = (ch.position & 0x01) ? (sample & 0x0F) : (sample >> 4);
+            int volumeCode = (_regs[RegNR32] >> 5) & 0x03;
+            return volumeCode ? sample >> (volumeCode - 1) : 0;
+        }
+        case ChannelNoise:
+            return (_lfsr & 0x01) ? 0 : ch.volume;
+        default:
+            assert(false && "Apu: invalid channel");
+            return 0;
+    }
+}
+
+void Apu::_gains(float* left, float* right) const
+{
+    float leftVolume = _isPowered ? (((_regs[RegNR50] >> 4) & 0x07) + 1)*OutputScale : 0.0f;
+    float rightVolume = _isPowered ? ((_regs[RegNR50] & 0x07) + 1)*OutputScale : 0.0f;
+
+    for (int c = 0; c < NumChannels; ++c) {
+        left[c] = (_regs[RegNR51] & (0x10 << c)) ? leftVolume : 0.0f;
+        right[c] = (_regs[RegNR51] & (0x01 << c)) ? rightVolume : 0.0f;
+    }
+}
+
+void Apu::_run(uint64_t until)
+{
+    while (_time < until) {
+        uint64_t end = std::min(until, _nextFrameSequencer);
+
+        // Make room for the block, dropping sound nobody read
+        size_t needed = _samplePosition(end) + gb::BlepWidth + 1;
+        if (needed > _capacity) {
+            _mix();
+            _consume(nullptr, needed - _capacity);
+        }
+
+        for (int c = 0; c < NumChannels; ++c) {
+            _renderChannel(static_cast<Channel>(c), end);
+        }
+        _time = end;
+
+        if (_time == _nextFrameSequencer) {
+            _stepFrameSequencer();
+            _nextFrameSequencer += FrameSequencerPeriod;
+        }
+    }
+}
+
+void Apu::_renderChannel(Channel channel, uint64_t until)
+{
+    ChannelState& ch = _channels[channel];
+    if (!ch.isOn || ch.nextStep > until) {
+        return;
+    }
+    if (channel == ChannelNoise && (_regs[RegNR43] >> 4) >= 14) {
+        // The noise generator isn't clocked at all
+        return;
+    }
+
+    uint64_t period = _period(channel);
+    int positions = channel == ChannelWave ? 32 : 8;
+
+    // A channel which can't be heard only needs its position kept
+    bool isMuted = channel == ChannelWave ? ((_regs[RegNR32] >> 5) & 0x03) == 0 : ch.volume == 0;
+    if (isMuted) {
+        uint64_t steps = (until - ch.nextStep)/period + 1;
+        ch.position = (ch.position + steps) % positions;
+        ch.nextStep += steps*period;
+        return;
+    }
+
+    while (ch.nextStep <= until) {
+        if (channel == ChannelNoise) {
+            uint16_t bit = (_lfsr ^ (_lfsr >> 1)) & 0x01;
+            _lfsr = (_lfsr >> 1) | (bit << 14);
+            if (_regs[RegNR43] & 0x08) {
+                _lfsr = (_lfsr & ~0x40) | (bit << 6);
+            }
+        } else {
+            ch.position = (ch.position + 1) % positions;
+        }
+
+        _setLevel(channel, ch.nextStep, _output(channel));
+        ch.nextStep += period;
+    }
+}
+
+void Apu::_stepFrameSequencer()
+{
+    if (_isPowered) {
+        if ((_frameSequencerStep & 0x01) == 0) {
+            for (int c = 0; c < NumChannels; ++c) {
+                _clockLength(static_cast<Channel>(c));
+            }
+        }
+        if (_frameSequencerStep == 2 || _frameSequencerStep == 6) {
+            _clockSweep();
+        }
+        if (_frameSequencerStep == 7) {
+            _clockEnvelope(ChannelSquare1);
+            _clockEnvelope(ChannelSquare2);
+            _clockEnvelope(ChannelNoise);
+        }
+    }
+    _frameSequencerStep = (_frameSequencerStep + 1) & 0x07;
+}
+
+void Apu::_clockLength(Channel channel)
+{
+    ChannelState& ch = _channels[channel];
+    if (ch.isLengthEnabled && ch.length > 0 && --ch.length == 0) {
+        _disable(channel);
+    }
+}
+
+void Apu::_clockEnvelope(Channel channel)
+{
+    ChannelState& ch = _channels[channel];
+    gb::Byte envelope = _regs[_base(channel) + 2];
+    int period = envelope & 0x07;
+    if (!ch.isOn || period == 0 || --ch.envelopeTimer > 0) {
+        return;
+    }
+
+    ch.envelopeTimer = period;
+    int volume = ch.volume + ((envelope & 0x08) ? 1 : -1);
+    if (volume >= 0 && volume <= 15) {
+        ch.volume = volume;
+        _setLevel(channel, _time, _output(channel));
+    }
+}
+
+void Apu::_clockSweep()
+{
+    if (--_sweepTimer > 0) {
+        return;
+    }
+
+    int period = (_regs[RegNR10] >> 4) & 0x07;
+    _sweepTimer = period ? period : 8;
+    if (!_isSweepEnabled || period == 0) {
+        return;
+    }
+
+    size_t target = _sweepTarget();
+    if (target > 2047) {
+        _disable(ChannelSquare1);
+        return;
+    }
+    if (_regs[RegNR10] & 0x07) {
+        _sweepShadow = target;
+        _regs[RegNR13] = target & 0xFF;
+        _regs[RegNR14] = (_regs[RegNR14] & ~0x07) | (target >> 8);
+
+        // The next step is checked straight away too
+        if (_sweepTarget() > 2047) {
+            _disable(ChannelSquare1);
+        }
+    }
+}
+
+size_t Apu::_sweepTarget() const
+{
+    size_t delta = _sweepShadow >> (_regs[RegNR10] & 0x07);
+    return (_regs[RegNR10] & 0x08) ? _sweepShadow - delta : _sweepShadow + delta;
+}
+
+void Apu::_trigger(Channel channel)
+{
+    ChannelState& ch = _channels[channel];
+    size_t base = _base(channel);
+
+    ch.isOn = ch.isDacOn;
+    if (ch.length == 0) {
+        ch.length = channel == ChannelWave ? 256 : 64;
+    }
+    ch.nextStep = _time + _period(channel);
+
+    switch (channel) {
+        case ChannelSquare1:
+        {
+            int period = (_regs[RegNR10] >> 4) & 0x07;
+            int shift = _regs[RegNR10] & 0x07;
+            _sweepShadow = _frequency(channel);
+            _sweepTimer = period ? period : 8;
+            _isSweepEnabled = period || shift;
+            if (shift && _sweepTarget() > 2047) {
+                ch.isOn = false;
+            }
+        }
+        // Fall through
+        case ChannelSquare2:
+        case ChannelNoise:
+            ch.volume = _regs[base + 2] >> 4;
+            ch.envelopeTimer = _regs[base + 2] & 0x07;
+            break;
+        case ChannelWave:
+            ch.position = 0;
+            break;
+        default:
+            break;
+    }
+    if (channel == ChannelNoise) {
+        _lfsr = 0x7FFF;
+    }
+
+    _setLevel(channel, _time, _output(channel));
+}
+
+void Apu::_disable(Channel channel)
+{
+    _channels[channel].isOn = false;
+    _setLevel(channel, _time, 0);
+}
+
+void Apu::_setLevel(Channel channel, uint64_t time, int level)
+{
+    ChannelState& ch = _channels[channel];
+    if (level == ch.level) {
+        return;
+    }
+
+    _addStep(ch.deltas.data(), time, static_cast<float>(level - ch.level));
+    ch.level = level;
+
+    size_t position = _samplePosition(time);
+    _dirtyBegin = std::min(_dirtyBegin, position);
+    _dirtyEnd = std::max(_dirtyEnd, position + gb::BlepWidth);
+}
+
+void Apu::_writeRegister(size_t address, gb::Byte val)
+{
+    if (address >= RegWave) {
+        _regs[address] = val;
+        return;
+    }
+
+    if (address == RegNR52) {
+        bool isPowered = (val & 0x80) != 0;
+        if (!isPowered && _isPowered) {
+            _powerOff();
+        } else if (isPowered && !_isPowered) {
+            _isPowered = true;
+            _frameSequencerStep = 0;
+        }
+        return;
+    }
+
+    // Registers can't be written while the APU is off
+    if (!_isPowered) {
+        return;
+    }
+
+    if (address == RegNR50 || address == RegNR51) {
+        // Steps already mixed keep their old gain, so channels which are
+        // sounding need a step to their new gain
+        float oldLeft[NumChannels], oldRight[NumChannels];
+        float newLeft[NumChannels], newRight[NumChannels];
+        _gains(oldLeft, oldRight);
+        _regs[address] = val;
+        _gains(newLeft, newRight);
+
+        for (int c = 0; c < NumChannels; ++c) {
+            float level = static_cast<float>(_channels[c].level);
+            if (level != 0.0f) {
+                _addStep(_left.data(), _time, level*(newLeft[c] - oldLeft[c]));
+                _addStep(_right.data(), _time, level*(newRight[c] - oldRight[c]));
+            }
+        }
+        return;
+    }
+
+    _regs[address] = val;
+
+    Channel channel = address < RegNR21 - 1 ? ChannelSquare1 :
+                      address < RegNR30 ? ChannelSquare2 :
+                      address < RegNR41 - 1 ? ChannelWave : ChannelNoise;
+    ChannelState& ch = _channels[channel];
+
+    switch (address - _base(channel)) {
+        case 0:
+            if (channel == ChannelWave) {
+                ch.isDacOn = (val & 0x80) != 0;
+                if (!ch.isDacOn) {
+                    _disable(channel);
+                }
+            }
+            break;
+        case 1:
+            ch.length = channel == ChannelWave ? 256 - val : 64 - (val & 0x3F);
+            _setLevel(channel, _time, _output(channel));
+            break;
+        case 2:
+            if (channel == ChannelWave) {
+                _setLevel(channel, _time, _output(channel));
+            } else {
+                ch.isDacOn = (val & 0xF8) != 0;
+                if (!ch.isDacOn) {
+                    _disable(channel);
+                }
+            }
+            break;
+        case 3:
+            if (channel == ChannelNoise) {
+                ch.nextStep = _time + _period(channel);
+            }
+            break;
+        case 4:
+            ch.isLengthEnabled = (val & 0x40) != 0;
+            if (val & 0x80) {
+                _trigger(channel);
+            }
+            break;
+    }
+}
+
+void Apu::_powerOff()
+{
+    for (int c = 0; c < NumChannels; ++c) {
+        Channel channel = static_cast<Channel>(c);
+        _disable(channel);
+        _channels[c].isDacOn = false;
+        _channels[c].isLengthEnabled = false;
+        _channels[c].length = 0;
+    }
+
+    // Silence is mixed at the current gains before they're cleared
+    _mix();
+    std::fill(_regs, _regs + RegNR52, 0x00);
+    _isPowered = false;
+}
+
+void Apu::_updateHighPass()
+{
+    // The output capacitor which removes DC
+    _highPassCharge = static_cast<float>(std::pow(0.999958, static_cast<double>(ClockRate)/_sampleRate));
+}
+
+void Apu::_addStep(float* deltas, uint64_t time, float delta)
+{
+    uint64_t tick = _tick(time);
+    size_t position = tick/ClockRate;
+    int phase = static_cast<int>((tick % ClockRate)*gb::BlepPhases/ClockRate);
+
+    assert(position + gb::BlepWidth <= _capacity);
+    gb::addBlepStep(deltas + position, phase, delta);
+}
+
+void Apu::_mix()
+{
+    if (_dirtyBegin >= _dirtyEnd) {
+        return;
+    }
+
+    float left[NumChannels], right[NumChannels];
+    _gains(left, right);
+
+    const float* inputs[NumChannels];
+    for (int c = 0; c < NumChannels; ++c) {
+        inputs[c] = _channels[c].deltas.data() + _dirtyBegin;
+    }
+
+    size_t count = _dirtyEnd - _dirtyBegin;
+    gb::mixChannels(inputs, left, NumChannels, _left.data() + _dirtyBegin, count);
+    gb::mixChannels(inputs, right, NumChannels, _right.data() + _dirtyBegin, count);
+
+    for (ChannelState& ch : _channels) {
+        std::fill(ch.deltas.begin() + _dirtyBegin, ch.deltas.begin() + _dirtyEnd, 0.0f);
+    }
+    _dirtyBegin = _capacity;
+    _dirtyEnd = 0;
+}
+
+void Apu::_consume(int16_t* out, size_t frames)
+{
+    assert(_dirtyBegin >= _dirtyEnd && frames <= _capacity);
+
+    float* buffers[2] = {_left.data(), _right.data()};
+    for (size_t i = 0; i < frames; ++i) {
+        for (int side = 0; side < 2; ++side) {
+            _sum[side] += buffers[side][i];
+            float sample = _sum[side] - _highPass[side];
+            _highPass[side] = _sum[side] - sample*_highPassCharge;
+            if (out) {
+                out[2*i + side] = clampSample(sample);
+            }
+        }
+    }
+
+    // Only the part which can hold steps so far needs to move
+    size_t used = std::min(_capacity, _samplePosition(_time) + gb::BlepWidth + 1);
+    size_t remaining = used > frames ? used - frames : 0;
+    for (float* buffer : buffers) {
+        std::memmove(buffer, buffer + frames, remaining*sizeof(float));
+        std::fill(buffer + remaining, buffer + used, 0.0f);
+    }
+    _startTick += frames*ClockRate;
+}
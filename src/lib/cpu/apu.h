@@ -0,0 +1,184 @@
+#ifndef GB_APU_H
+#define GB_APU_H
+
+#include <cstdint>
+#include <vector>
+
+#include "cpu/addressable.h"
+#include "cpu/scheduler.h"
+#include "util/units.h"
+
+namespace gb {
+
+/**
+ * The audio processing unit, registers NR10-NR52 and wave RAM
+ * (0xFF10-0xFF3F).
+ *
+ * Nothing runs per cycle. Sound is generated in blocks when a register write
+ * changes it, or when samples are read: each channel emits band-limited
+ * amplitude steps into its own buffer for the time since the last block,
+ * the channel buffers are mixed with the panning and master volume in force
+ * for that block, and the result is resampled to sampleRate() stereo.
+ */
+class Apu : public Addressable
+{
+public:
+    enum Register
+    {
+        RegNR10 = 0x00,
+        RegNR11 = 0x01,
+        RegNR12 = 0x02,
+        RegNR13 = 0x03,
+        RegNR14 = 0x04,
+        RegNR21 = 0x06,
+        RegNR22 = 0x07,
+        RegNR23 = 0x08,
+        RegNR24 = 0x09,
+        RegNR30 = 0x0A,
+        RegNR31 = 0x0B,
+        RegNR32 = 0x0C,
+        RegNR33 = 0x0D,
+        RegNR34 = 0x0E,
+        RegNR41 = 0x10,
+        RegNR42 = 0x11,
+        RegNR43 = 0x12,
+        RegNR44 = 0x13,
+        RegNR50 = 0x14,
+        RegNR51 = 0x15,
+        RegNR52 = 0x16,
+        RegWave = 0x20,
+    };
+
+    enum Channel
+    {
+        ChannelSquare1 = 0,
+        ChannelSquare2 = 1,
+        ChannelWave    = 2,
+        ChannelNoise   = 3,
+        NumChannels,
+    };
+
+    static const size_t NumRegisters = 0x30;
+    static const uint64_t ClockRate = 4194304;
+    static const unsigned DefaultSampleRate = 48000;
+
+    /**
+     * Caller retains ownership of scheduler.
+     */
+    Apu(Scheduler* scheduler, unsigned sampleRate = DefaultSampleRate);
+    ~Apu();
+
+    void reset();
+
+    unsigned sampleRate() const { return _sampleRate; }
+
+    /**
+     * Changes the output rate from now on, for small adjustments which keep
+     * an audio queue's fill level steady.
+     */
+    void setSampleRate(unsigned sampleRate);
+    bool isChannelOn(Channel channel) const { return _channels[channel].isOn; }
+
+    /**
+     * Generates sound up to the current clock.
+     */
+    void sync();
+
+    /**
+     * Stereo frames which can be read without calling sync() first.
+     */
+    size_t framesAvailable() const;
+
+    /**
+     * Syncs, then reads up to frames interleaved left/right frames into out.
+     * Returns the number read. Sound which isn't read within about a quarter
+     * of a second is dropped.
+     */
+    size_t readFrames(int16_t* out, size_t frames);
+
+    /**
+     * Raw access to the registers as last written.
+     */
+    virtual gb::Byte& operator[](size_t address) override;
+    virtual bool isValidAddress(size_t address) const override;
+    virtual gb::Byte read(size_t address) override;
+    virtual void write(size_t address, gb::Byte val) override;
+
+private:
+    struct ChannelState
+    {
+        bool isOn;
+        bool isDacOn;
+        bool isLengthEnabled;
+        int length;
+        int volume;
+        int envelopeTimer;
+        int position;
+        uint64_t nextStep;
+        int level;
+        std::vector<float> deltas;
+    };
+
+    size_t _base(Channel channel) const { return channel*5; }
+    size_t _frequency(Channel channel) const;
+    uint64_t _period(Channel channel) const;
+    int _output(Channel channel) const;
+    void _gains(float* left, float* right) const;
+
+    void _run(uint64_t until);
+    void _renderChannel(Channel channel, uint64_t until);
+    void _stepFrameSequencer();
+    void _clockLength(Channel channel);
+    void _clockEnvelope(Channel channel);
+    void _clockSweep();
+    size_t _sweepTarget() const;
+
+    void _trigger(Channel channel);
+    void _disable(Channel channel);
+    void _setLevel(Channel channel, uint64_t time, int level);
+    void _writeRegister(size_t address, gb::Byte val);
+    void _powerOff();
+
+    uint64_t _tick(uint64_t time) const { return time*_sampleRate - _startTick; }
+    size_t _samplePosition(uint64_t time) const { return _tick(time)/ClockRate; }
+    void _addStep(float* deltas, uint64_t time, float delta);
+    void _updateHighPass();
+    void _mix();
+    void _consume(int16_t* out, size_t frames);
+
+    Scheduler* _scheduler;
+    unsigned _sampleRate;
+    gb::Byte _regs[NumRegisters];
+
+    ChannelState _channels[NumChannels];
+    bool _isPowered;
+    uint64_t _time;
+    uint64_t _nextFrameSequencer;
+    int _frameSequencerStep;
+
+    // Channel 1 frequency sweep
+    int _sweepTimer;
+    size_t _sweepShadow;
+    bool _isSweepEnabled;
+
+    // Channel 4 noise generator
+    uint16_t _lfsr;
+
+    // Output buffers hold amplitude changes starting at _startTick, in units
+    // of clock cycles multiplied by the sample rate
+    uint64_t _startTick;
+    size_t _capacity;
+    size_t _dirtyBegin;
+    size_t _dirtyEnd;
+    std::vector<float> _left;
+    std::vector<float> _right;
+
+    // Running sums and high pass filter state of the output
+    float _sum[2];
+    float _highPass[2];
+    float _highPassCharge;
+};
+
+}
+
+#endif
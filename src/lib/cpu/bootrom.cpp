@@ -0,0 +1,65 @@
+#include "bootrom.h"
+using gb::BootRom;
+
+#include <algorithm>
+#include <cassert>
+
+BootRom::BootRom() :
+    _image(Size),
+    _isLoaded(false),
+    _cartridge(nullptr),
+    _register(0xFF)
+{
+    std::fill(_image.data(), _image.data() + Size, 0xFF);
+}
+
+BootRom::~BootRom()
+{
+}
+
+bool BootRom::load(const std::vector<gb::Byte>& image)
+{
+    if (image.size() != Size) {
+        return false;
+    }
+
+    std::copy(image.begin(), image.end(), _image.data());
+    _isLoaded = true;
+    return true;
+}
+
+void BootRom::attach(Cartridge* cartridge)
+{
+    assert(cartridge && _isLoaded);
+    _cartridge = cartridge;
+    _cartridge->setBootRom(&_image);
+}
+
+gb::Byte& BootRom::operator[](size_t address)
+{
+    assert(isValidAddress(address));
+    _register = 0xFF;
+    return _register;
+}
+
+bool BootRom::isValidAddress(size_t address) const
+{
+    return address == 0;
+}
+
+gb::Byte BootRom::read(size_t address)
+{
+    assert(isValidAddress(address));
+    return 0xFF;
+}
+
+void BootRom::write(size_t address, gb::Byte val)
+{
+    assert(isValidAddress(address));
+    if (val == 0 || !_cartridge) {
+        return;
+    }
+
+    _cartridge->setBootRom(nullptr);
+    _cartridge = nullptr;
+}
@@ -0,0 +1,59 @@
+#ifndef GB_BOOTROM_H
+#define GB_BOOTROM_H
+
+#include <vector>
+
+#include "cpu/addressable.h"
+#include "cpu/cartridge.h"
+#include "cpu/memory.h"
+#include "util/units.h"
+
+namespace gb {
+
+/**
+ * The DMG boot ROM and the register which unmaps it (0xFF50).
+ *
+ * While mapped the image is laid over the cartridge at 0x0000-0x00FF. The
+ * boot ROM's last instruction writes to the register, which maps the
+ * cartridge back for good.
+ */
+class BootRom : public Addressable
+{
+public:
+    static const size_t Size = 0x100;
+
+    BootRom();
+    ~BootRom();
+
+    /**
+     * Copies image in. Returns false if it isn't Size bytes.
+     */
+    bool load(const std::vector<gb::Byte>& image);
+    bool isLoaded() const { return _isLoaded; }
+
+    /**
+     * Lays the image over cartridge. Caller retains ownership of cartridge.
+     */
+    void attach(Cartridge* cartridge);
+    bool isMapped() const { return _cartridge != nullptr; }
+
+    gb::Memory& image() { return _image; }
+
+    /**
+     * The unmap register, reads as 0xFF.
+     */
+    virtual gb::Byte& operator[](size_t address) override;
+    virtual bool isValidAddress(size_t address) const override;
+    virtual gb::Byte read(size_t address) override;
+    virtual void write(size_t address, gb::Byte val) override;
+
+private:
+    gb::Memory _image;
+    bool _isLoaded;
+    Cartridge* _cartridge;
+    gb::Byte _register;
+};
+
+}
+
+#endif
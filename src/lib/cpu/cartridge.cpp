@@ -0,0 +1,379 @@
+#include "cartridge.h"
+using gb::Cartridge;
+
+#include <algorithm>
+#include <cassert>
+
+namespace {
+
+const size_t TitleAddress   = 0x0134;
+const size_t TitleLength    = 16;
+const size_t CgbFlagAddress = 0x0143;
+const size_t TypeAddress    = 0x0147;
+const size_t RamSizeAddress = 0x0149;
+
+// External RAM size for each header RAM size code
+const size_t RamSizes[6] = {0, 0x800, 0x2000, 0x8000, 0x20000, 0x10000};
+
+size_t romSize(size_t fileSize)
+{
+    // At least the two banks which are always mapped, and a power of two so
+    // bank numbers can be masked
+    size_t size = 2*Cartridge::RomBankSize;
+    while (size < fileSize) {
+        size *= 2;
+    }
+    return size;
+}
+
+size_t ramSize(const std::vector<gb::Byte>& rom)
+{
+    size_t code = rom.size() > RamSizeAddress ? rom[RamSizeAddress] : 0;
+    size_t size = code < 6 ? RamSizes[code] : 0;
+
+    // Smaller RAM is mirrored over a full bank
+    if (size > 0 && size < Cartridge::RamBankSize) {
+        size = Cartridge::RamBankSize;
+    }
+    return size;
+}
+
+}
+
+Cartridge::Cartridge(const std::vector<gb::Byte>& rom) :
+    _rom(romSize(rom.size())),
+    _ram(new gb::Memory(ramSize(rom))),
+    _save(nullptr),
+    _mmu(nullptr),
+    _bootRom(nullptr),
+    _type(0x00),
+    _mbc(MbcNone),
+    _hasBattery(false),
+    _hasRtc(false),
+    _isCgb(false),
+    _isSaveDirty(false),
+    _isRamEnabled(false),
+    _romBankLow(1),
+    _romBankHigh(0),
+    _ramSelect(0),
+    _latchWrite(0xFF),
+    _isAdvancedMode(false),
+    _romBank0(0),
+    _romBank(1),
+    _ramBank(0)
+{
+    std::copy(rom.begin(), rom.end(), _rom.data());
+    std::fill(_rom.data() + rom.size(), _rom.data() + _rom.size(), 0xFF);
+    std::fill(_ram->data(), _ram->data() + _ram->size(), 0x00);
+
+    // Bare images without a header are treated as plain 32K ROMs
+    if (rom.size() > TypeAddress) {
+        _parseHeader();
+    }
+}
+
+Cartridge::~Cartridge()
+{
+    if (_save && _hasRtc) {
+        _rtc.save(_rtcSaveData());
+    }
+}
+
+bool Cartridge::loadSave(const std::string& path)
+{
+    assert(!_mmu);
+    size_t size = _ram->size() + (_hasRtc ? Rtc::SaveSize : 0);
+    if (size == 0) {
+        return false;
+    }
+
+    MappedMemory* save = new MappedMemory(path, size);
+    if (!save->isOpen()) {
+        delete save;
+        return false;
+    }
+
+    _ram.reset(save);
+    _save = save;
+    if (_hasRtc) {
+        _rtc.load(_rtcSaveData());
+    }
+    return true;
+}
+
+void Cartridge::flushSave()
+{
+    if (!_save || !_isSaveDirty) {
+        return;
+    }
+
+    if (_hasRtc) {
+        _rtc.save(_rtcSaveData());
+    }
+    _save->flush();
+
+    // RAM which is still enabled can keep changing
+    _isSaveDirty = _isRamEnabled;
+}
+
+void Cartridge::attach(MMU* mmu)
+{
+    assert(mmu && !_mmu);
+    _mmu = mmu;
+
+    // The first page is its own mapping so a boot ROM can be laid over it
+    _mmu->mapReadOnly(&_rom, gb::Range(0x0000, 0x00FF), gb::Range(0x0000, 0x00FF), this);
+    _mmu->mapReadOnly(&_rom, gb::Range(0x0100, RomBankSize - 1), gb::Range(0x0100, 0x3FFF), this);
+    _mmu->mapReadOnly(&_rom, gb::Range(RomBankSize, 2*RomBankSize - 1), gb::Range(0x4000, 0x7FFF), this);
+    _mmu->map(&_disabledRam, gb::Range(0x0000, RamBankSize - 1), gb::Range(0xA000, 0xBFFF));
+
+    _romBank0 = 0;
+    _romBank = 1;
+    _updateBootMapping();
+    _updateRamMapping();
+}
+
+void Cartridge::setBootRom(Addressable* bootRom)
+{
+    _bootRom = bootRom;
+    if (_mmu) {
+        _updateBootMapping();
+    }
+}
+
+gb::Byte& Cartridge::operator[](size_t address)
+{
+    assert(isValidAddress(address));
+    size_t bank = address < RomBankSize ? _romBank0 : _romBank;
+    return _rom[bank*RomBankSize + (address & (RomBankSize - 1))];
+}
+
+bool Cartridge::isValidAddress(size_t address) const
+{
+    return address < 2*RomBankSize;
+}
+
+void Cartridge::write(size_t address, gb::Byte val)
+{
+    assert(isValidAddress(address));
+
+    switch (_mbc) {
+        case Mbc1:  _writeMbc1(address, val); break;
+        case Mbc3:  _writeMbc3(address, val); break;
+        case Mbc5:  _writeMbc5(address, val); break;
+        default:    break;
+    }
+}
+
+void Cartridge::_parseHeader()
+{
+    for (size_t i = 0; i < TitleLength; ++i) {
+        gb::Byte c = _rom[TitleAddress + i];
+        if (c == 0x00 || c == 0xFF) {
+            break;
+        }
+        _title.push_back(static_cast<char>(c));
+    }
+
+    // 0x80 for games which also run on a DMG, 0xC0 for CGB only
+    _isCgb = (_rom[CgbFlagAddress] & 0x80) != 0;
+
+    _type = _rom[TypeAddress];
+    switch (_type) {
+        case 0x00:
+        case 0x08:
+        case 0x09:
+            _mbc = MbcNone;
+            break;
+        case 0x01:
+        case 0x02:
+        case 0x03:
+            _mbc = Mbc1;
+            break;
+        case 0x0F:
+        case 0x10:
+        case 0x11:
+        case 0x12:
+        case 0x13:
+            _mbc = Mbc3;
+            break;
+        case 0x19:
+        case 0x1A:
+        case 0x1B:
+        case 0x1C:
+        case 0x1D:
+        case 0x1E:
+            _mbc = Mbc5;
+            break;
+        default:
+            _mbc = MbcUnsupported;
+            break;
+    }
+
+    switch (_type) {
+        case 0x03:
+        case 0x06:
+        case 0x09:
+        case 0x0D:
+        case 0x0F:
+        case 0x10:
+        case 0x13:
+        case 0x1B:
+        case 0x1E:
+            _hasBattery = true;
+            break;
+        default:
+            _hasBattery = false;
+            break;
+    }
+
+    _hasRtc = _type == 0x0F || _type == 0x10;
+}
+
+void Cartridge::_writeMbc1(size_t address, gb::Byte val)
+{
+    switch (address & 0x6000) {
+        case 0x0000:
+            _setRamEnabled((val & 0x0F) == 0x0A);
+            return;
+        case 0x2000:
+            // Bank 0 can't be selected in the switchable window
+            _romBankLow = (val & 0x1F) ? (val & 0x1F) : 1;
+            break;
+        case 0x4000:
+            _romBankHigh = val & 0x03;
+            break;
+        case 0x6000:
+            _isAdvancedMode = (val & 0x01) != 0;
+            break;
+    }
+
+    // In advanced mode the upper bits also select the bank at 0x0000 and the
+    // RAM bank
+    size_t high = _romBankHigh << 5;
+    _updateRomMapping(_isAdvancedMode ? high : 0, high | _romBankLow);
+
+    size_t ramSelect = _isAdvancedMode ? _romBankHigh : 0;
+    if (ramSelect != _ramSelect) {
+        _ramSelect = ramSelect;
+        _updateRamMapping();
+    }
+}
+
+void Cartridge::_writeMbc3(size_t address, gb::Byte val)
+{
+    switch (address & 0x6000) {
+        case 0x0000:
+            _setRamEnabled((val & 0x0F) == 0x0A);
+            break;
+        case 0x2000:
+            _romBankLow = (val & 0x7F) ? (val & 0x7F) : 1;
+            _updateRomMapping(0, _romBankLow);
+            break;
+        case 0x4000:
+            _ramSelect = val;
+            _updateRamMapping();
+            break;
+        case 0x6000:
+            // Writing 0x00 then 0x01 latches the clock
+            if (_latchWrite == 0x00 && val == 0x01) {
+                _rtc.latch();
+            }
+            _latchWrite = val;
+            break;
+    }
+}
+
+void Cartridge::_writeMbc5(size_t address, gb::Byte val)
+{
+    switch (address & 0x7000) {
+        case 0x0000:
+        case 0x1000:
+            _setRamEnabled((val & 0x0F) == 0x0A);
+            break;
+        case 0x2000:
+            _romBankLow = val;
+            _updateRomMapping(0, (_romBankHigh << 8) | _romBankLow);
+            break;
+        case 0x3000:
+            _romBankHigh = val & 0x01;
+            _updateRomMapping(0, (_romBankHigh << 8) | _romBankLow);
+            break;
+        case 0x4000:
+        case 0x5000:
+            _ramSelect = val & 0x0F;
+            _updateRamMapping();
+            break;
+    }
+}
+
+void Cartridge::_updateRomMapping(size_t bank0, size_t bank)
+{
+    assert(_mmu);
+
+    bank0 &= romBanks() - 1;
+    bank &= romBanks() - 1;
+
+    if (bank0 != _romBank0) {
+        _romBank0 = bank0;
+        size_t base = bank0*RomBankSize;
+        _mmu->remap(&_rom, gb::Range(base + 0x0100, base + RomBankSize - 1), gb::Range(0x0100, 0x3FFF));
+        _updateBootMapping();
+    }
+    if (bank != _romBank) {
+        _romBank = bank;
+        _mmu->remap(&_rom, gb::Range(bank*RomBankSize, (bank + 1)*RomBankSize - 1),
+                    gb::Range(0x4000, 0x7FFF));
+    }
+}
+
+gb::Byte* Cartridge::_rtcSaveData()
+{
+    return _ram->data() + ramBanks()*RamBankSize;
+}
+
+void Cartridge::_setRamEnabled(bool isEnabled)
+{
+    bool wasEnabled = _isRamEnabled;
+    _isRamEnabled = isEnabled;
+    _updateRamMapping();
+
+    // Games disable RAM once they're done saving, a good time to write back
+    if (isEnabled) {
+        _isSaveDirty = true;
+    } else if (wasEnabled) {
+        flushSave();
+    }
+}
+
+void Cartridge::_updateBootMapping()
+{
+    if (_bootRom) {
+        _mmu->remap(_bootRom, gb::Range(0x0000, 0x00FF), gb::Range(0x0000, 0x00FF));
+        return;
+    }
+
+    size_t base = _romBank0*RomBankSize;
+    _mmu->remap(&_rom, gb::Range(base, base + 0x00FF), gb::Range(0x0000, 0x00FF));
+}
+
+void Cartridge::_updateRamMapping()
+{
+    assert(_mmu);
+
+    // MBC3 selects its clock registers with 0x08-0x0C, those aren't RAM
+    bool isClockSelected = _mbc == Mbc3 && _ramSelect >= 0x08;
+    if (_isRamEnabled && isClockSelected && _hasRtc && _ramSelect <= 0x0C) {
+        _rtc.select(static_cast<Rtc::Register>(_ramSelect - 0x08));
+        _mmu->remap(&_rtc, gb::Range(0x0000, RamBankSize - 1), gb::Range(0xA000, 0xBFFF));
+        return;
+    }
+    if (!_isRamEnabled || ramBanks() == 0 || isClockSelected) {
+        _mmu->remap(&_disabledRam, gb::Range(0x0000, RamBankSize - 1), gb::Range(0xA000, 0xBFFF));
+        return;
+    }
+
+    _ramBank = _ramSelect & (ramBanks() - 1);
+    _mmu->remap(_ram.get(), gb::Range(_ramBank*RamBankSize, (_ramBank + 1)*RamBankSize - 1),
+                gb::Range(0xA000, 0xBFFF));
+}
@@ -0,0 +1,148 @@
+#ifndef GB_CARTRIDGE_H
+#define GB_CARTRIDGE_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "cpu/addressable.h"
+#include "cpu/mappedmemory.h"
+#include "cpu/memory.h"
+#include "cpu/mmu.h"
+#include "cpu/openbus.h"
+#include "cpu/rtc.h"
+#include "util/units.h"
+
+namespace gb {
+
+/**
+ * A cartridge's ROM, external RAM and memory bank controller (MBC).
+ *
+ * ROM is mapped at 0x0000-0x7FFF and RAM at 0xA000-0xBFFF as plain memory.
+ * Writes to the ROM area come back here as MBC register writes, and a bank
+ * switch only re-points the MMU pages of the switched window.
+ *
+ * External RAM can be backed by a save file mapped into memory, which is
+ * flushed when the game disables RAM and periodically through flushSave().
+ * The MBC3 clock is stored after the RAM in the same file.
+ */
+class Cartridge : public Addressable
+{
+public:
+    enum Mbc
+    {
+        MbcNone,
+        Mbc1,
+        Mbc3,
+        Mbc5,
+        MbcUnsupported,
+    };
+
+    static const size_t RomBankSize = 0x4000;
+    static const size_t RamBankSize = 0x2000;
+
+    Cartridge(const std::vector<gb::Byte>& rom);
+    ~Cartridge();
+
+    bool isSupported() const       { return _mbc != MbcUnsupported; }
+    const std::string& title() const { return _title; }
+    gb::Byte type() const          { return _type; }
+    Mbc mbc() const                { return _mbc; }
+    bool hasBattery() const        { return _hasBattery; }
+    bool hasRtc() const            { return _hasRtc; }
+    bool isCgb() const             { return _isCgb; }
+
+    size_t romBanks() const        { return _rom.size()/RomBankSize; }
+    size_t ramBanks() const        { return _ram->size()/RamBankSize; }
+
+    /**
+     * ROM banks currently mapped at 0x0000 and 0x4000, and the RAM bank.
+     */
+    size_t romBank0() const        { return _romBank0; }
+    size_t romBank() const         { return _romBank; }
+    size_t ramBank() const         { return _ramBank; }
+    bool isRamEnabled() const      { return _isRamEnabled; }
+
+    gb::Memory& rom()              { return _rom; }
+    gb::Memory& ram()              { return *_ram; }
+    Rtc& rtc()                     { return _rtc; }
+
+    /**
+     * Backs external RAM with the file at path, loading any previous contents.
+     * Must be called before attach(). Returns false if the cartridge has no
+     * RAM or clock, or the file can't be mapped.
+     */
+    bool loadSave(const std::string& path);
+    bool hasSave() const           { return _save != nullptr; }
+
+    /**
+     * Starts writing back RAM modified since the last flush.
+     */
+    void flushSave();
+
+    /**
+     * Maps the cartridge into mmu. Caller retains ownership of mmu.
+     */
+    void attach(MMU* mmu);
+
+    /**
+     * Overlays 0x0000-0x00FF with the first 256 bytes of bootRom, or maps
+     * the ROM back when bootRom is nullptr. Writes still program the MBC.
+     * Caller retains ownership of bootRom.
+     */
+    void setBootRom(Addressable* bootRom);
+
+    /**
+     * Raw access to the ROM as currently mapped at 0x0000-0x7FFF.
+     */
+    virtual gb::Byte& operator[](size_t address) override;
+    virtual bool isValidAddress(size_t address) const override;
+
+    /**
+     * Receives writes to 0x0000-0x7FFF, which program the MBC.
+     */
+    virtual void write(size_t address, gb::Byte val) override;
+
+private:
+    void _parseHeader();
+    void _writeMbc1(size_t address, gb::Byte val);
+    void _writeMbc3(size_t address, gb::Byte val);
+    void _writeMbc5(size_t address, gb::Byte val);
+    void _updateRomMapping(size_t bank0, size_t bank);
+    void _updateBootMapping();
+    gb::Byte* _rtcSaveData();
+    void _setRamEnabled(bool isEnabled);
+    void _updateRamMapping();
+
+    gb::Memory _rom;
+    std::unique_ptr<gb::Memory> _ram;
+    MappedMemory* _save;
+    OpenBus _disabledRam;
+    Rtc _rtc;
+    MMU* _mmu;
+    Addressable* _bootRom;
+
+    std::string _title;
+    gb::Byte _type;
+    Mbc _mbc;
+    bool _hasBattery;
+    bool _hasRtc;
+    bool _isCgb;
+    bool _isSaveDirty;
+
+    // MBC registers
+    bool _isRamEnabled;
+    size_t _romBankLow;
+    size_t _romBankHigh;
+    size_t _ramSelect;
+    gb::Byte _latchWrite;
+    bool _isAdvancedMode;
+
+    size_t _romBank0;
+    size_t _romBank;
+    size_t _ramBank;
+};
+
+}
+
+#endif
@@ -0,0 +1,121 @@
+#include "cgb.h"
+using gb::Cgb;
+
+#include <cassert>
+
+Cgb::Cgb(MMU* mmu, Addressable* vram, Addressable* wram, Timer* timer, Serial* serial) :
+    _mmu(mmu),
+    _vram(vram),
+    _wram(wram),
+    _timer(timer),
+    _serial(serial),
+    _isEnabled(false),
+    _isDoubleSpeed(false),
+    _key1(0x00),
+    _svbk(0x00),
+    _vramBank(0),
+    _wramBank(1)
+{
+    assert(_mmu && _vram && _wram && _timer && _serial);
+}
+
+Cgb::~Cgb()
+{
+}
+
+void Cgb::reset()
+{
+    if (_isDoubleSpeed) {
+        switchSpeed();
+    }
+    _key1 = 0x00;
+    _svbk = 0x00;
+    _setVramBank(0);
+    _setWramBank(1);
+}
+
+void Cgb::switchSpeed()
+{
+    _isDoubleSpeed = !_isDoubleSpeed;
+    _key1 &= ~0x01;
+    _timer->setDoubleSpeed(_isDoubleSpeed);
+    _serial->setDoubleSpeed(_isDoubleSpeed);
+}
+
+gb::Byte& Cgb::operator[](size_t address)
+{
+    assert(isValidAddress(address));
+    _snapshot[address] = read(address);
+    return _snapshot[address];
+}
+
+bool Cgb::isValidAddress(size_t address) const
+{
+    return address <= RegSVBK;
+}
+
+gb::Byte Cgb::read(size_t address)
+{
+    if (!_isEnabled) {
+        return 0xFF;
+    }
+
+    switch (address) {
+        case RegKEY1:
+            return (_isDoubleSpeed ? 0x80 : 0x00) | 0x7E | (_key1 & 0x01);
+        case RegVBK:
+            return 0xFE | static_cast<gb::Byte>(_vramBank);
+        case RegSVBK:
+            return 0xF8 | _svbk;
+        default:
+            assert(false && "Cgb: invalid register");
+            return 0xFF;
+    }
+}
+
+void Cgb::write(size_t address, gb::Byte val)
+{
+    if (!_isEnabled) {
+        return;
+    }
+
+    switch (address) {
+        case RegKEY1:
+            _key1 = val & 0x01;
+            break;
+        case RegVBK:
+            _setVramBank(val & 0x01);
+            break;
+        case RegSVBK:
+            // Bank 0 is always at 0xC000, selecting it gives bank 1
+            _svbk = val & 0x07;
+            _setWramBank(_svbk ? _svbk : 1);
+            break;
+        default:
+            assert(false && "Cgb: invalid register");
+            break;
+    }
+}
+
+void Cgb::_setVramBank(size_t bank)
+{
+    if (bank == _vramBank) {
+        return;
+    }
+
+    _vramBank = bank;
+    size_t base = bank*VramBankSize;
+    _mmu->remap(_vram, gb::Range(base, base + VramBankSize - 1), gb::Range(0x8000, 0x9FFF));
+}
+
+void Cgb::_setWramBank(size_t bank)
+{
+    if (bank == _wramBank) {
+        return;
+    }
+
+    _wramBank = bank;
+    size_t base = bank*WramBankSize;
+    _mmu->remap(_wram, gb::Range(base, base + WramBankSize - 1), gb::Range(0xD000, 0xDFFF));
+    _mmu->remap(_wram, gb::Range(base, base + 0xDFF), gb::Range(0xF000, 0xFDFF));
+}
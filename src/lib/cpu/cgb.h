@@ -0,0 +1,91 @@
+#ifndef GB_CGB_H
+#define GB_CGB_H
+
+#include <cstdint>
+
+#include "cpu/addressable.h"
+#include "cpu/mmu.h"
+#include "cpu/serial.h"
+#include "cpu/timer.h"
+#include "util/units.h"
+
+namespace gb {
+
+/**
+ * The GameBoy Color speed and bank registers KEY1 (0xFF4D), VBK (0xFF4F)
+ * and SVBK (0xFF70).
+ *
+ * A bank switch only re-points the MMU pages of the switched window, VRAM
+ * at 0x8000-0x9FFF and WRAM at 0xD000-0xDFFF and its echo at 0xF000-0xFDFF,
+ * which must already be mapped to bank 0 and 1 respectively. A speed switch
+ * is armed through KEY1 and carried out by the Cpu on STOP.
+ *
+ * On a DMG cartridge the registers are disabled, they read 0xFF and ignore
+ * writes.
+ */
+class Cgb : public Addressable
+{
+public:
+    enum Register
+    {
+        RegKEY1 = 0,
+        RegVBK  = 1,
+        RegSVBK = 2,
+    };
+
+    static const size_t VramBankSize = 0x2000;
+    static const size_t VramBanks = 2;
+    static const size_t WramBankSize = 0x1000;
+    static const size_t WramBanks = 8;
+
+    /**
+     * vram and wram must hold all of their banks. Caller retains ownership of
+     * mmu, vram, wram, timer and serial.
+     */
+    Cgb(MMU* mmu, Addressable* vram, Addressable* wram, Timer* timer, Serial* serial);
+    ~Cgb();
+
+    void reset();
+
+    bool isEnabled() const          { return _isEnabled; }
+    void setEnabled(bool isEnabled) { _isEnabled = isEnabled; }
+
+    size_t vramBank() const         { return _vramBank; }
+    size_t wramBank() const         { return _wramBank; }
+
+    bool isDoubleSpeed() const      { return _isDoubleSpeed; }
+    bool isSpeedSwitchArmed() const { return _isEnabled && (_key1 & 0x01) != 0; }
+
+    /**
+     * Toggles double speed for the peripherals clocked by the CPU and
+     * disarms KEY1. Called by the Cpu on STOP.
+     */
+    void switchSpeed();
+
+    virtual gb::Byte& operator[](size_t address) override;
+    virtual bool isValidAddress(size_t address) const override;
+    virtual gb::Byte read(size_t address) override;
+    virtual void write(size_t address, gb::Byte val) override;
+
+private:
+    void _setVramBank(size_t bank);
+    void _setWramBank(size_t bank);
+
+    MMU* _mmu;
+    Addressable* _vram;
+    Addressable* _wram;
+    Timer* _timer;
+    Serial* _serial;
+
+    bool _isEnabled;
+    bool _isDoubleSpeed;
+    gb::Byte _key1;
+    gb::Byte _svbk;
+    size_t _vramBank;
+    size_t _wramBank;
+    gb::Byte _snapshot[3];
+};
+
+}
+
+#endif
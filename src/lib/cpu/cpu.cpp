@@ -1,10 +1,51 @@
 #include "cpu.h"
 using gb::Cpu;
 
+#include "cpu/profiler.h"
+#include "cpu/sampler.h"
+#include "cpu/tracer.h"
 #include "util/util.h"
 
+#include <algorithm>
 #include <cassert>
 
+namespace {
+
+// Clock cycles taken by each opcode. Conditional branches list the not-taken
+// cost, the extra cycles of a taken branch are added where it is executed.
+// The 0xCB prefix is accounted for by the CB table.
+const gb::Byte OpcodeCycles[256] = {
+//   0   1   2   3   4   5   6   7   8   9   A   B   C   D   E   F
+     4, 12,  8,  8,  4,  4,  8,  4, 20,  8,  8,  8,  4,  4,  8,  4, // 0x00
+     4, 12,  8,  8,  4,  4,  8,  4, 12,  8,  8,  8,  4,  4,  8,  4, // 0x10
+     8, 12,  8,  8,  4,  4,  8,  4,  8,  8,  8,  8,  4,  4,  8,  4, // 0x20
+     8, 12,  8,  8, 12, 12, 12,  4,  8,  8,  8,  8,  4,  4,  8,  4, // 0x30
+     4,  4,  4,  4,  4,  4,  8,  4,  4,  4,  4,  4,  4,  4,  8,  4, // 0x40
+     4,  4,  4,  4,  4,  4,  8,  4,  4,  4,  4,  4,  4,  4,  8,  4, // 0x50
+     4,  4,  4,  4,  4,  4,  8,  4,  4,  4,  4,  4,  4,  4,  8,  4, // 0x60
+     8,  8,  8,  8,  8,  8,  4,  8,  4,  4,  4,  4,  4,  4,  8,  4, // 0x70
+     4,  4,  4,  4,  4,  4,  8,  4,  4,  4,  4,  4,  4,  4,  8,  4, // 0x80
+     4,  4,  4,  4,  4,  4,  8,  4,  4,  4,  4,  4,  4,  4,  8,  4, // 0x90
+     4,  4,  4,  4,  4,  4,  8,  4,  4,  4,  4,  4,  4,  4,  8,  4, // 0xA0
+     4,  4,  4,  4,  4,  4,  8,  4,  4,  4,  4,  4,  4,  4,  8,  4, // 0xB0
+     8, 12, 12, 16, 12, 16,  8, 16,  8, 16, 12,  0, 12, 24,  8, 16, // 0xC0
+     8, 12, 12,  0, 12, 16,  8, 16,  8, 16, 12,  0, 12,  0,  8, 16, // 0xD0
+    12, 12,  8,  0,  0, 16,  8, 16, 16,  4, 16,  0,  0,  0,  8, 16, // 0xE0
+    12, 12,  8,  4,  0, 16,  8, 16, 12,  8, 16,  4,  0,  0,  8, 16, // 0xF0
+};
+
+// CB opcodes are 8 cycles on registers and 16 on (HL), except BIT b,(HL)
+// which only reads memory.
+gb::Byte cbOpcodeCycles(gb::Byte opcode)
+{
+    if ((opcode & 0x07) != 0x06) {
+        return 8;
+    }
+    return (opcode >= 0x40 && opcode < 0x80) ? 12 : 16;
+}
+
+}
+
 void Cpu::reset()
 {
     _registers.AF = 0x0000;
@@ -13,15 +54,57 @@ void Cpu::reset()
     _registers.HL = 0x0000;
     _registers.SP = 0x0000;
     _registers.PC = 0x0000;
+    _cycles = 0;
+    _instructions = 0;
+    _clockBase = 0;
+    _cycleBase = 0;
+    _speedShift = 0;
 
     // Are interrupts enabled by default?
     _interruptsEnabled = true;
     _isHalted = false;
+    _isStopped = false;
+}
+
+void Cpu::setDoubleSpeed(bool isDoubleSpeed)
+{
+    _clockBase = clock();
+    _cycleBase = _cycles;
+    _speedShift = isDoubleSpeed ? 1 : 0;
 }
 
 void Cpu::processNextInstruction()
 {
+    if (_interrupts) {
+        gb::Byte pending = _interrupts->pending();
+        if (pending) {
+            _isHalted = false;
+            if (_interruptsEnabled) {
+                _serviceInterrupt(pending);
+                return;
+            }
+        } else if (_isHalted) {
+            _wait();
+            return;
+        }
+    }
+
+#ifdef GB_PROFILE
+    gb::Word profilePc = _registers.PC;
+    uint64_t profileCycles = _cycles;
+#endif
+
     gb::Byte opcode = _getArg8();
+#ifdef GB_PROFILE
+    gb::Byte firstOpcode = opcode;
+#endif
+#ifdef GB_TRACE
+    if (_tracer) {
+        _tracer->record(_cycles, _registers.PC - 1, _registers, opcode);
+    }
+#endif
+    _cycles += OpcodeCycles[opcode];
+    ++_instructions;
 
     switch (opcode) {
 
@@ -109,7 +192,9 @@ void Cpu::processNextInstruction()
         // RLCA
         case 0x07:
         {
+            // Unlike the CB prefixed rotate, z is always cleared
             _rlc(gb::Cpu::RegA);
+            _assignFlag(gb::Cpu::FlagZ, 0);
             break;
         }
 
@@ -153,13 +238,21 @@ void Cpu::processNextInstruction()
         // RRCA
         case 0x0F:
         {
+            // Unlike the CB prefixed rotate, z is always cleared
             _rrc(gb::Cpu::RegA);
+            _assignFlag(gb::Cpu::FlagZ, 0);
             break;
         }
 
         // STOP
         case 0x10:
         {
+            if (_cgb && _cgb->isSpeedSwitchArmed()) {
+                _cgb->switchSpeed();
+                setDoubleSpeed(_cgb->isDoubleSpeed());
+                _cycles += SpeedSwitchCycles;
+                break;
+            }
             _isStopped = true;
             break;
         }
@@ -167,7 +260,9 @@ void Cpu::processNextInstruction()
         // RLA
         case 0x17:
         {
+            // Unlike the CB prefixed rotate, z is always cleared
             _rl(gb::Cpu::RegA);
+            _assignFlag(gb::Cpu::FlagZ, 0);
             break;
         }
 
@@ -192,7 +287,9 @@ void Cpu::processNextInstruction()
         // RRA
         case 0x1F:
         {
+            // Unlike the CB prefixed rotate, z is always cleared
             _rr(gb::Cpu::RegA);
+            _assignFlag(gb::Cpu::FlagZ, 0);
             break;
         }
 
@@ -202,6 +299,7 @@ void Cpu::processNextInstruction()
             int offset = gb::toInt8(_getArg8());
             if (!flag(gb::Cpu::FlagZ)) {
                 _registers.PC += offset;
+                _cycles += 4;
             }
             break;
         }
@@ -209,60 +307,40 @@ void Cpu::processNextInstruction()
         // LDI (HL),A
         case 0x22:
         {
-            (*_memory)[_registers.HL++] = _registers.A;
+            _memory->write(_registers.HL++, _registers.A);
             break;
         }
 
         // DAA
         case 0x27:
         {
+            // Adjusts by the flags from the last add or subtract, rather than
+            // a table of valid BCD inputs, so every input behaves as hardware
             int n = flag(gb::Cpu::FlagN);
             int h = flag(gb::Cpu::FlagH);
             int c = flag(gb::Cpu::FlagC);
 
-            gb::Byte high = (_registers.A & 0xF0) >> 4;
-            gb::Byte low = (_registers.A & 0x0F);
-
-            int newC = 0;
-            gb::Byte toAdd = 0;
-
+            int newC = c;
+            int a = _registers.A;
             if (n == 0) {
-                if (c == 0 && h == 0 && high >= 0 && high <= 9 && low >= 0 && low <= 9) {
-                    newC = 0;
-                    toAdd = 0x00;
-                } else if (c == 0 && ((h == 0 && high >= 0x0 && high <= 0x8 && low >= 0xA && low <= 0xF) ||
-                                      (h == 1 && high >= 0x0 && high <= 0x9 && low >= 0x0 && low <= 0x3))) {
-                    newC = 0;
-                    toAdd = 0x06;
-                } else if (h == 0 && ((c == 0 && high >= 0xA && high <= 0xF && low >= 0x0 && low <= 0x9) ||
-                                      (c == 1 && high >= 0x0 && high <= 0x2 && low >= 0x0 && low <= 0x9))) {
-                    newC = 1;
-                    toAdd = 0x60;
-                } else if ((c == 0 && ((h == 0 && high >= 0x9 && high <= 0xF && low >= 0xA && low <= 0xF) ||
-                                       (h == 1 && high >= 0xA && high <= 0xF && low >= 0x0 && low <= 0x3))) ||
-                           (c == 1 && ((h == 0 && high >= 0x0 && high <= 0x2 && low >= 0xA && low <= 0xF) ||
-                                       (h == 1 && high >= 0x0 && high <= 0x3 && low >= 0x0 && low <= 0x3)))) {
+                if (c == 1 || a > 0x99) {
+                    a += 0x60;
                     newC = 1;
-                    toAdd = 0x66;
+                }
+                if (h == 1 || (a & 0x0F) > 0x09) {
+                    a += 0x06;
                 }
             } else {
-                if (c == 0 && h == 0 && high >= 0x0 && high <= 0x9 && low >= 0x0 && low <= 0x9) {
-                    newC = 0;
-                    toAdd = 0x00;
-                } else if (c == 0 && h == 1 && high >= 0x0 && high <= 0x8 && low >= 0x6 && low <= 0xF) {
-                    newC = 0;
-                    toAdd = 0xFA;
-                } else if (c == 1 && h == 0 && high >= 0x7 && high <= 0xF && low >= 0x0 && low <= 0x9) {
-                    newC = 1;
-                    toAdd = 0xA0;
-                } else if (c == 1 && h == 1 && high >= 0x6 && high <= 0xF && low >= 0x6 && low <= 0xF) {
-                    newC = 1;
-                    toAdd = 0x9A;
+                if (c == 1) {
+                    a -= 0x60;
+                }
+                if (h == 1) {
+                    a -= 0x06;
                 }
             }
 
-            _registers.A += toAdd;
-            _assignFlags(_registers.A == 0x00, flag(gb::Cpu::FlagN), 0, newC);
+            _registers.A = static_cast<gb::Byte>(a);
+            _assignFlags(_registers.A == 0x00, n, 0, newC);
             break;
         }
 
@@ -272,6 +350,7 @@ void Cpu::processNextInstruction()
             int offset = gb::toInt8(_getArg8());
             if (flag(gb::Cpu::FlagZ)) {
                 _registers.PC += offset;
+                _cycles += 4;
             }
             break;
         }
@@ -289,7 +368,7 @@ void Cpu::processNextInstruction()
         // LDI A,(HL)
         case 0x2A:
         {
-            _registers.A = (*_memory)[_registers.HL++];
+            _registers.A = _memory->read(_registers.HL++);
             break;
         }
 
@@ -306,6 +385,7 @@ void Cpu::processNextInstruction()
             int offset = gb::toInt8(_getArg8());
             if (!flag(gb::Cpu::FlagC)) {
                 _registers.PC += offset;
+                _cycles += 4;
             }
             break;
         }
@@ -313,7 +393,7 @@ void Cpu::processNextInstruction()
         // LDD (HL),A
         case 0x32:
         {
-            (*_memory)[_registers.HL--] = _registers.A;
+            _memory->write(_registers.HL--, _registers.A);
             break;
         }
 
@@ -332,6 +412,7 @@ void Cpu::processNextInstruction()
             int offset = gb::toInt8(_getArg8());
             if (flag(gb::Cpu::FlagC)) {
                 _registers.PC += offset;
+                _cycles += 4;
             }
             break;
         }
@@ -349,7 +430,7 @@ void Cpu::processNextInstruction()
         // LDD A,(HL)
         case 0x3A:
         {
-            _registers.A = (*_memory)[_registers.HL--];
+            _registers.A = _memory->read(_registers.HL--);
             break;
         }
 
@@ -509,7 +590,7 @@ void Cpu::processNextInstruction()
         case 0x8E: // (HL)
         case 0x8F: // A
         {
-            _add8(gb::Cpu::RegA, _getTargetValue8(_getOffsetTarget8(opcode, 0x88)) + flag(gb::Cpu::FlagC));
+            _add8(gb::Cpu::RegA, _getTargetValue8(_getOffsetTarget8(opcode, 0x88)), flag(gb::Cpu::FlagC));
             break;
         }
 
@@ -537,7 +618,7 @@ void Cpu::processNextInstruction()
         case 0x9E: // (HL)
         case 0x9F: // A
         {
-            _sub8(gb::Cpu::RegA, _getTargetValue8(_getOffsetTarget8(opcode, 0x98)) + flag(gb::Cpu::FlagC));
+            _sub8(gb::Cpu::RegA, _getTargetValue8(_getOffsetTarget8(opcode, 0x98)), flag(gb::Cpu::FlagC));
             break;
         }
 
@@ -603,6 +684,7 @@ void Cpu::processNextInstruction()
         {
             if (!flag(gb::Cpu::FlagZ)) {
                 _return();
+                _cycles += 12;
             }
             break;
         }
@@ -622,9 +704,14 @@ void Cpu::processNextInstruction()
                 default: assert("Unhandled switch case"); break;
             }
 
-            gb::Byte low = (*_memory)[_registers.SP++];
-            gb::Byte high = (*_memory)[_registers.SP++];
+            gb::Byte low = _memory->read(_registers.SP++);
+            gb::Byte high = _memory->read(_registers.SP++);
             *data = (high << 8) | low;
+
+            // The low nibble of F always reads 0
+            if (opcode == 0xF1) {
+                _registers.F &= 0xF0;
+            }
             break;
         }
 
@@ -634,6 +721,7 @@ void Cpu::processNextInstruction()
             gb::Word nn = _getArg16();
             if (!flag(gb::Cpu::FlagZ)) {
                 _registers.PC = nn;
+                _cycles += 4;
             }
             break;
         }
@@ -653,6 +741,7 @@ void Cpu::processNextInstruction()
             gb::Word nn = _getArg16();
             if (!flag(gb::Cpu::FlagZ)) {
                 _call(nn);
+                _cycles += 12;
             }
             break;
         }
@@ -672,8 +761,8 @@ void Cpu::processNextInstruction()
                 default: assert("Unhandled switch case"); break;
             }
 
-            (*_memory)[--_registers.SP] = ((*data) >> 8);
-            (*_memory)[--_registers.SP] = ((*data) & 0x00FF);
+            _memory->write(--_registers.SP, (*data) >> 8);
+            _memory->write(--_registers.SP, (*data) & 0x00FF);
             break;
         }
 
@@ -696,6 +785,7 @@ void Cpu::processNextInstruction()
         {
             if (flag(gb::Cpu::FlagZ)) {
                 _return();
+                _cycles += 12;
             }
             break;
         }
@@ -713,6 +803,7 @@ void Cpu::processNextInstruction()
             gb::Word nn = _getArg16();
             if (flag(gb::Cpu::FlagZ)) {
                 _registers.PC = nn;
+                _cycles += 4;
             }
             break;
         }
@@ -721,6 +812,7 @@ void Cpu::processNextInstruction()
         case 0xCB:
         {
             opcode = _getArg8();
+            _cycles += cbOpcodeCycles(opcode);
             switch (opcode) {
 
                 // RLC r
@@ -1179,6 +1271,7 @@ void Cpu::processNextInstruction()
             gb::Word nn = _getArg16();
             if (flag(gb::Cpu::FlagZ)) {
                 _call(nn);
+                _cycles += 12;
             }
             break;
         }
@@ -1195,7 +1288,7 @@ void Cpu::processNextInstruction()
         case 0xCE:
         {
             gb::Byte n = _getArg8();
-            _add8(gb::Cpu::RegA, n + flag(gb::Cpu::FlagC));
+            _add8(gb::Cpu::RegA, n, flag(gb::Cpu::FlagC));
             break;
         }
 
@@ -1211,6 +1304,7 @@ void Cpu::processNextInstruction()
         {
             if (!flag(gb::Cpu::FlagC)) {
                 _return();
+                _cycles += 12;
             }
             break;
         }
@@ -1221,6 +1315,7 @@ void Cpu::processNextInstruction()
             gb::Word nn = _getArg16();
             if (!flag(gb::Cpu::FlagC)) {
                 _registers.PC = nn;
+                _cycles += 4;
             }
             break;
         }
@@ -1231,6 +1326,7 @@ void Cpu::processNextInstruction()
             gb::Word nn = _getArg16();
             if (!flag(gb::Cpu::FlagC)) {
                 _call(nn);
+                _cycles += 12;
             }
             break;
         }
@@ -1254,6 +1350,7 @@ void Cpu::processNextInstruction()
         {
             if (flag(gb::Cpu::FlagC)) {
                 _return();
+                _cycles += 12;
             }
             break;
         }
@@ -1272,6 +1369,7 @@ void Cpu::processNextInstruction()
             gb::Word nn = _getArg16();
             if (flag(gb::Cpu::FlagC)) {
                 _registers.PC = nn;
+                _cycles += 4;
             }
             break;
         }
@@ -1282,6 +1380,7 @@ void Cpu::processNextInstruction()
             gb::Word nn = _getArg16();
             if (flag(gb::Cpu::FlagC)) {
                 _call(nn);
+                _cycles += 12;
             }
             break;
         }
@@ -1290,7 +1389,7 @@ void Cpu::processNextInstruction()
         case 0xDE:
         {
             gb::Byte n = _getArg8();
-            _sub8(gb::Cpu::RegA, n + flag(gb::Cpu::FlagC));
+            _sub8(gb::Cpu::RegA, n, flag(gb::Cpu::FlagC));
             break;
         }
 
@@ -1328,23 +1427,14 @@ void Cpu::processNextInstruction()
         // ADD SP,dd
         case 0xE8:
         {
-            gb::Byte offset = _getArg8();
-            int ioffset = gb::toInt8(offset);
-            if (ioffset >= 0) {
-                _add16(gb::Cpu::RegSP, offset);
-            } else {
-                gb::Byte absOffset = abs(ioffset);
-                _sub16(gb::Cpu::RegSP, absOffset);
-            }
-            _assignFlag(gb::Cpu::FlagZ, 0);
-            _assignFlag(gb::Cpu::FlagN, 0);
+            _registers.SP = _addSp(_getArg8());
             break;
         }
 
         // JP (HL)
         case 0xE9:
         {
-            _registers.PC = (*_memory)[_registers.HL];
+            _registers.PC = _registers.HL;
             break;
         }
 
@@ -1407,38 +1497,7 @@ void Cpu::processNextInstruction()
         // LD HL,SP+dd
         case 0xF8:
         {
-            // TODO: this can be done better
-
-            // This is a special one, we want to add16 but the result doesn't
-            // go into the same register.
-            gb::Word* data = _getTargetPtr16(gb::Cpu::RegHL);
-            gb::Word sp = _getTargetValue16(gb::Cpu::RegSP);
-
-            // This is an 8 bit signed, convert to a 16 bit signed
-            gb::Byte arg = _getArg8();
-            int offset = gb::toInt8(arg);
-            gb::Word absOffset = abs(offset);
-
-            gb::Word val = 0x00;
-
-            // Do either a SUB or ADD check depending on sign of val
-            if (offset > 0) {
-                val = sp + absOffset;
-                int fullRes = sp + absOffset;
-                _assignFlags(0,
-                             0, 
-                             (((sp&0x0FFF) + (absOffset&0x0FFF))&0x1000) == 0x1000, 
-                             fullRes > std::numeric_limits<gb::Word>::max());
-            } else {
-                val = sp - absOffset;
-                int fullRes = sp - absOffset;
-                _assignFlags(0,
-                             0, 
-                             (static_cast<int>(sp&0x0FFF) - static_cast<int>(absOffset&0x0FFF)) < 0,
-                             fullRes < 0);
-            }
-
-            (*data) = val;
+            _registers.HL = _addSp(_getArg8());
             break;
         }
 
@@ -1483,18 +1542,30 @@ void Cpu::processNextInstruction()
             break;
         }
     }
+
+#ifdef GB_PROFILE
+    if (_profiler) {
+        // A CB prefixed instruction left its second opcode in opcode
+        size_t index = firstOpcode == 0xCB ? Profiler::CbOpcodes + opcode : firstOpcode;
+        _profiler->record(profilePc, index, _cycles - profileCycles);
+    }
+#endif
+
+    if (_scheduler) {
+        _scheduler->advanceTo(clock());
+    }
 }
 
 gb::Byte Cpu::_getArg8()
 {
-    gb::Byte arg = (*_memory)[_registers.PC++];
+    gb::Byte arg = _memory->read(_registers.PC++);
     return arg;
 }
 
 gb::Word Cpu::_getArg16()
 {
-    gb::Word a = (*_memory)[_registers.PC++];
-    gb::Word b = (*_memory)[_registers.PC++];
+    gb::Word a = _memory->read(_registers.PC++);
+    gb::Word b = _memory->read(_registers.PC++);
     return ((b << 8) | a);
 }
 
@@ -1562,11 +1633,11 @@ gb::Byte Cpu::_getTargetValue8(Cpu::Target target) const
         case Cpu::RegE:     return _registers.E;
         case Cpu::RegH:     return _registers.H;
         case Cpu::RegL:     return _registers.L;
-        case Cpu::MemHL:    return (*_memory)[_registers.HL];
+        case Cpu::MemHL:    return _memory->read(_registers.HL);
         case Cpu::RegA:     return _registers.A;
-        case Cpu::MemBC:    return (*_memory)[_registers.BC];
-        case Cpu::MemDE:    return (*_memory)[_registers.DE];
-        case Cpu::MemSP:    return (*_memory)[_registers.SP];
+        case Cpu::MemBC:    return _memory->read(_registers.BC);
+        case Cpu::MemDE:    return _memory->read(_registers.DE);
+        case Cpu::MemSP:    return _memory->read(_registers.SP);
         default:            assert(false && "Switch case not handled"); break;
     }        
 }
@@ -1582,25 +1653,6 @@ gb::Word Cpu::_getTargetValue16(Cpu::Target target) const
     }        
 }
 
-gb::Byte* Cpu::_getTargetPtr8(Cpu::Target target)
-{
-    switch (target) {
-        case Cpu::RegB:     return &_registers.B;
-        case Cpu::RegC:     return &_registers.C;
-        case Cpu::RegD:     return &_registers.D;
-        case Cpu::RegE:     return &_registers.E;
-        case Cpu::RegH:     return &_registers.H;
-        case Cpu::RegL:     return &_registers.L;
-        case Cpu::MemHL:    return &(*_memory)[_registers.HL];
-        case Cpu::RegA:     return &_registers.A;
-        case Cpu::MemBC:    return &(*_memory)[_registers.BC];
-        case Cpu::MemDE:    return &(*_memory)[_registers.DE];
-        case Cpu::MemSP:    return &(*_memory)[_registers.SP];
-        default:            assert(false && "Switch case not handled");
-    }
-    return nullptr;
-}
-
 gb::Word* Cpu::_getTargetPtr16(Cpu::Target target)
 {
     switch (target) {
@@ -1622,11 +1674,11 @@ void Cpu::_load(Cpu::Target target, gb::Byte n)
         case Cpu::RegE:     _registers.E = n;  break;
         case Cpu::RegH:     _registers.H = n;  break;
         case Cpu::RegL:     _registers.L = n;  break;
-        case Cpu::MemHL:    (*_memory)[_registers.HL] = n;  break;
+        case Cpu::MemHL:    _memory->write(_registers.HL, n); break;
         case Cpu::RegA:     _registers.A = n;  break;
-        case Cpu::MemBC:    (*_memory)[_registers.BC] = n;  break;
-        case Cpu::MemDE:    (*_memory)[_registers.DE] = n;  break;
-        case Cpu::MemSP:    (*_memory)[_registers.SP] = n;  break;
+        case Cpu::MemBC:    _memory->write(_registers.BC, n); break;
+        case Cpu::MemDE:    _memory->write(_registers.DE, n); break;
+        case Cpu::MemSP:    _memory->write(_registers.SP, n); break;
         default:            assert(false && "Switch case not handled"); break;
     }        
 }
@@ -1660,11 +1712,11 @@ void Cpu::_loadToMem(gb::Word addr, Cpu::Target source)
 {
     Cpu::TargetType sourceType = _getTargetType(source);
     if (sourceType == Cpu::TargetType8) {
-        (*_memory)[addr] = _getTargetValue8(source);
+        _memory->write(addr, _getTargetValue8(source));
     } else if (sourceType == Cpu::TargetType16) {
         gb::Word val = _getTargetValue16(source);
-        (*_memory)[addr] = val & 0x00FF; 
-        (*_memory)[addr + 1] = val & 0xFF00; 
+        _memory->write(addr, val & 0x00FF);
+        _memory->write(addr + 1, val >> 8);
     } else {
         assert(false && "Unhandled target type");
     }
@@ -1673,20 +1725,20 @@ void Cpu::_loadToMem(gb::Word addr, Cpu::Target source)
 
 void Cpu::_loadFromMem(Cpu::Target target, gb::Word addr)
 {
-    _load(target, (*_memory)[addr]);
+    _load(target, _memory->read(addr));
 }
 
-void Cpu::_add8(Cpu::Target target, gb::Byte val)
+void Cpu::_add8(Cpu::Target target, gb::Byte val, int carry)
 {
-    gb::Byte* data = _getTargetPtr8(target);
+    gb::Byte data = _getTargetValue8(target);
 
-    int fullRes = *data + val;
+    int fullRes = data + val + carry;
     gb::Byte res = static_cast<gb::Byte>(fullRes);
     _assignFlags(res == 0, 
                  0, 
-                 ((((*data)&0x0F) + (val&0x0F))&0x10) == 0x10, 
+                 (((data&0x0F) + (val&0x0F) + carry)&0x10) == 0x10, 
                  fullRes > std::numeric_limits<gb::Byte>::max());
-    *data = res;
+    _load(target, res);
 }
 
 void Cpu::_add16(Cpu::Target target, gb::Word val)
@@ -1702,17 +1754,29 @@ void Cpu::_add16(Cpu::Target target, gb::Word val)
     *data = res;
 }
 
-void Cpu::_sub8(Cpu::Target target, gb::Byte val)
+gb::Word Cpu::_addSp(gb::Byte offset)
 {
-    gb::Byte* data = _getTargetPtr8(target);
+    // The offset is signed, but h and c come from the unsigned add of the
+    // low bytes, as the ALU does it 8 bits at a time
+    gb::Word sp = _registers.SP;
+    _assignFlags(0,
+                 0,
+                 ((sp&0x0F) + (offset&0x0F)) > 0x0F,
+                 ((sp&0xFF) + offset) > 0xFF);
+    return static_cast<gb::Word>(sp + gb::toInt8(offset));
+}
 
-    int fullRes = *data - val;
+void Cpu::_sub8(Cpu::Target target, gb::Byte val, int carry)
+{
+    gb::Byte data = _getTargetValue8(target);
+
+    int fullRes = data - val - carry;
     gb::Byte res = static_cast<gb::Byte>(fullRes);
     _assignFlags(res == 0, 
                  1, 
-                 (static_cast<int>((*data)&0x0F) - static_cast<int>(val&0x0F)) < 0,
+                 (static_cast<int>(data&0x0F) - static_cast<int>(val&0x0F) - carry) < 0,
                  fullRes < 0);
-    *data = res;
+    _load(target, res);
 }
 
 void Cpu::_sub16(Cpu::Target target, gb::Word val)
@@ -1730,30 +1794,34 @@ void Cpu::_sub16(Cpu::Target target, gb::Word val)
 
 void Cpu::_and(Cpu::Target target, gb::Byte val)
 {
-    gb::Byte* data = _getTargetPtr8(target);
-    *data &= val;
-    _assignFlags(*data == 0, 0, 1, 0); 
+    gb::Byte data = _getTargetValue8(target);
+    data &= val;
+    _assignFlags(data == 0, 0, 1, 0); 
+    _load(target, data);
 }
 
 void Cpu::_or(Cpu::Target target, gb::Byte val)
 {
-    gb::Byte* data = _getTargetPtr8(target);
-    *data |= val;
-    _assignFlags(*data == 0, 0, 0, 0); 
+    gb::Byte data = _getTargetValue8(target);
+    data |= val;
+    _assignFlags(data == 0, 0, 0, 0); 
+    _load(target, data);
 }
 
 void Cpu::_xor(Cpu::Target target, gb::Byte val)
 {
-    gb::Byte* data = _getTargetPtr8(target);
-    *data ^= val;
-    _assignFlags(*data == 0, 0, 0, 0); 
+    gb::Byte data = _getTargetValue8(target);
+    data ^= val;
+    _assignFlags(data == 0, 0, 0, 0); 
+    _load(target, data);
 }
 
 void Cpu::_complement(Cpu::Target target)
 {
-    gb::Byte* data = _getTargetPtr8(target);
-    *data = ~(*data);
+    gb::Byte data = _getTargetValue8(target);
+    data = ~data;
     _assignFlags(flag(FlagZ), 1, 1, flag(FlagC)); 
+    _load(target, data);
 }
 
 void Cpu::_bit(int bit, gb::Byte val)
@@ -1770,77 +1838,87 @@ void Cpu::_bit(int bit, gb::Byte val)
 
 void Cpu::_set(int bit, gb::Cpu::Target target)
 {
-    gb::Byte* data = _getTargetPtr8(target);
-    (*data) |= (1 << bit);
+    gb::Byte data = _getTargetValue8(target);
+    data |= (1 << bit);
+    _load(target, data);
 }
 
 void Cpu::_clear(int bit, gb::Cpu::Target target)
 {
-    gb::Byte* data = _getTargetPtr8(target);
-    (*data) &= ~(1 << bit);
+    gb::Byte data = _getTargetValue8(target);
+    data &= ~(1 << bit);
+    _load(target, data);
 }
 
 void Cpu::_rlc(gb::Cpu::Target target)
 {
-    gb::Byte* data = _getTargetPtr8(target);
-    gb::Byte carry = ((*data) >> 7);
-    (*data) = ((*data) << 1) | carry;
-    _assignFlags((*data) == 0, 0, 0, carry);
+    gb::Byte data = _getTargetValue8(target);
+    gb::Byte carry = (data >> 7);
+    data = (data << 1) | carry;
+    _assignFlags(data == 0, 0, 0, carry);
+    _load(target, data);
 }
 
 void Cpu::_rrc(gb::Cpu::Target target)
 {
-    gb::Byte* data = _getTargetPtr8(target);
-    gb::Byte carry = ((*data) & 0x01);
-    (*data) = ((*data) >> 1) | (carry << 7);
-    _assignFlags((*data) == 0, 0, 0, carry);
+    gb::Byte data = _getTargetValue8(target);
+    gb::Byte carry = (data & 0x01);
+    data = (data >> 1) | (carry << 7);
+    _assignFlags(data == 0, 0, 0, carry);
+    _load(target, data);
 }
 
 void Cpu::_rl(gb::Cpu::Target target)
 {
-    gb::Byte* data = _getTargetPtr8(target);
-    gb::Byte carry = ((*data) >> 7);
-    (*data) = ((*data) << 1) | flag(gb::Cpu::FlagC);
-    _assignFlags((*data) == 0, 0, 0, carry);
+    gb::Byte data = _getTargetValue8(target);
+    gb::Byte carry = (data >> 7);
+    data = (data << 1) | flag(gb::Cpu::FlagC);
+    _assignFlags(data == 0, 0, 0, carry);
+    _load(target, data);
 }
 
 void Cpu::_rr(gb::Cpu::Target target)
 {
-    gb::Byte* data = _getTargetPtr8(target);
-    gb::Byte carry = ((*data) & 0x01);
-    (*data) = ((*data) >> 1) | (flag(gb::Cpu::FlagC) << 7);
-    _assignFlags((*data) == 0, 0, 0, carry);
+    gb::Byte data = _getTargetValue8(target);
+    gb::Byte carry = (data & 0x01);
+    data = (data >> 1) | (flag(gb::Cpu::FlagC) << 7);
+    _assignFlags(data == 0, 0, 0, carry);
+    _load(target, data);
 }
 
 void Cpu::_sla(gb::Cpu::Target target)
 {
-    gb::Byte* data = _getTargetPtr8(target);
-    gb::Byte carry = ((*data) & 0x80) >> 7;
-    (*data) = ((*data) << 1);
-    _assignFlags((*data) == 0, 0, 0, carry);
+    gb::Byte data = _getTargetValue8(target);
+    gb::Byte carry = (data & 0x80) >> 7;
+    data = (data << 1);
+    _assignFlags(data == 0, 0, 0, carry);
+    _load(target, data);
 }
 
 void Cpu::_sra(gb::Cpu::Target target)
 {
-    gb::Byte* data = _getTargetPtr8(target);
-    gb::Byte carry = ((*data) & 0x01);
-    (*data) = ((*data) >> 1) | ((*data) & 0x80);
-    _assignFlags((*data) == 0, 0, 0, carry);
+    gb::Byte data = _getTargetValue8(target);
+    gb::Byte carry = (data & 0x01);
+    data = (data >> 1) | (data & 0x80);
+    _assignFlags(data == 0, 0, 0, carry);
+    _load(target, data);
 }
 
 void Cpu::_srl(gb::Cpu::Target target)
 {
-    gb::Byte* data = _getTargetPtr8(target);
-    gb::Byte carry = ((*data) & 0x01);
-    (*data) >>= 1;
-    _assignFlags((*data) == 0, 0, 0, carry);
+    gb::Byte data = _getTargetValue8(target);
+    gb::Byte carry = (data & 0x01);
+    data >>= 1;
+    _assignFlags(data == 0, 0, 0, carry);
+    _load(target, data);
 }
 
 void Cpu::_swap(gb::Cpu::Target target)
 {
-    gb::Byte* data = _getTargetPtr8(target);
-    (*data) = ((*data) << 4) | (((*data) & 0xF0) >> 4);
-    _assignFlags((*data) == 0, 0, 0, 0);
+    gb::Byte data = _getTargetValue8(target);
+    data = (data << 4) | ((data & 0xF0) >> 4);
+    _assignFlags(data == 0, 0, 0, 0);
+    _load(target, data);
 }
 
 void Cpu::_compare(gb::Byte a, gb::Byte b)
@@ -1854,17 +1932,61 @@ void Cpu::_compare(gb::Byte a, gb::Byte b)
                  fullRes < 0);
 }
 
+void Cpu::_serviceInterrupt(gb::Byte pending)
+{
+    // Lowest bit has the highest priority, vectors start at 0x40
+    int bit = 0;
+    while ((pending & (1 << bit)) == 0) {
+        ++bit;
+    }
+
+    _interrupts->acknowledge(static_cast<Interrupts::Interrupt>(bit));
+    _interruptsEnabled = false;
+    _call(0x0040 + bit*8);
+    _cycles += 20;
+
+    if (_scheduler) {
+        _scheduler->advanceTo(clock());
+    }
+}
+
+void Cpu::_wait()
+{
+    // Halted with nothing pending, jump straight to whatever can raise an
+    // interrupt next instead of spinning on 4 cycle steps.
+    uint64_t next = _cycles + 4;
+    if (_scheduler && _scheduler->nextEventTime() != Scheduler::Never) {
+        uint64_t event = std::max(_scheduler->nextEventTime(), _clockBase);
+        next = std::max(next, _cycleBase + ((event - _clockBase) << _speedShift));
+    }
+    _cycles = next;
+
+    if (_scheduler) {
+        _scheduler->advanceTo(clock());
+    }
+}
+
 void Cpu::_call(gb::Word addr)
 {
-    (*_memory)[--_registers.SP] = (_registers.PC >> 8);
-    (*_memory)[--_registers.SP] = (_registers.PC & 0x00FF);
+    _memory->write(--_registers.SP, _registers.PC >> 8);
+    _memory->write(--_registers.SP, _registers.PC & 0x00FF);
     _registers.PC = addr;
+#ifdef GB_PROFILE
+    if (_sampler) {
+        _sampler->onCall(addr, _registers.SP);
+    }
+#endif
 }
 
 void Cpu::_return()
 {
-    gb::Byte low = (*_memory)[_registers.SP++];
-    gb::Byte high = (*_memory)[_registers.SP++];
+#ifdef GB_PROFILE
+    if (_sampler) {
+        _sampler->onReturn(_registers.SP);
+    }
+#endif
+    gb::Byte low = _memory->read(_registers.SP++);
+    gb::Byte high = _memory->read(_registers.SP++);
     gb::Word addr = (high << 8) | low;
     _registers.PC = addr;
 }
@@ -1,14 +1,22 @@
 #ifndef GB_CPU_H
 #define GB_CPU_H
 
+#include <cstdint>
 #include <vector>
 
 #include "cpu/addressable.h"
+#include "cpu/cgb.h"
+#include "cpu/interrupts.h"
+#include "cpu/scheduler.h"
 #include "util/units.h"
 #include "util/util.h"
 
 namespace gb {
 
+class Profiler;
+class Sampler;
+class Tracer;
+
 /**
  * Emulates the modified GameBoy Z80 processor opcodes.
  */
@@ -107,8 +115,18 @@ public:
         TargetType16,
     };
 
+    // Stall while the clock settles after a speed switch
+    static const uint64_t SpeedSwitchCycles = 8200;
+
 public:
-    Cpu()
+    Cpu() :
+        _memory(nullptr),
+        _scheduler(nullptr),
+        _interrupts(nullptr),
+        _cgb(nullptr),
+        _tracer(nullptr),
+        _profiler(nullptr),
+        _sampler(nullptr)
     {
         reset();
     }
@@ -119,6 +137,45 @@ public:
      */
     void setMemory(Addressable* mem) { _memory = mem; }
 
+    /*
+     * Optional. When set the scheduler clock follows cycles() and its events
+     * run between instructions. Caller retains ownership of scheduler.
+     */
+    void setScheduler(Scheduler* scheduler) { _scheduler = scheduler; }
+
+    /*
+     * Optional. When set pending interrupts are serviced and HALT waits for
+     * one. Caller retains ownership of interrupts.
+     */
+    void setInterrupts(Interrupts* interrupts) { _interrupts = interrupts; }
+
+    /*
+     * Optional. When set STOP carries out a speed switch armed in KEY1.
+     * Caller retains ownership of cgb.
+     */
+    void setCgb(Cgb* cgb) { _cgb = cgb; }
+
+    /*
+     * Optional. When set every instruction is recorded into tracer, if
+     * tracing was compiled in (see IsTraceEnabled). Caller retains ownership
+     * of tracer.
+     */
+    void setTracer(Tracer* tracer) { _tracer = tracer; }
+
+    /*
+     * Optional. When set every instruction is counted by profiler, if
+     * profiling was compiled in (see IsProfileEnabled). Caller retains
+     * ownership of profiler.
+     */
+    void setProfiler(Profiler* profiler) { _profiler = profiler; }
+
+    /*
+     * Optional. When set calls and returns are reported to sampler, if
+     * profiling was compiled in (see IsProfileEnabled). Caller retains
+     * ownership of sampler.
+     */
+    void setSampler(Sampler* sampler) { _sampler = sampler; }
+
     Registers& registers()     { return _registers; }
     Byte flag(Flag flag) const { return (_registers.F & (1<<flag)) >> flag; }
 
@@ -131,6 +188,30 @@ public:
     bool isStopped() const { return _isStopped; }
     bool isHalted() const { return _isHalted; }
 
+    /**
+     * In double speed instructions take half as long on the peripheral
+     * clock. Only the mapping between the two clocks changes, so switching
+     * is constant time.
+     */
+    bool isDoubleSpeed() const { return _speedShift != 0; }
+    void setDoubleSpeed(bool isDoubleSpeed);
+
+    /**
+     * Number of clock cycles executed since the last reset.
+     */
+    uint64_t cycles() const { return _cycles; }
+
+    /**
+     * Number of instructions executed since the last reset, not counting
+     * interrupt dispatch or waiting in HALT.
+     */
+    uint64_t instructions() const { return _instructions; }
+
+    /**
+     * cycles() on the peripheral clock, which the scheduler follows.
+     */
+    uint64_t clock() const { return _clockBase + ((_cycles - _cycleBase) >> _speedShift); }
+
 protected:
     gb::Byte _getArg8();
     gb::Word _getArg16();
@@ -143,7 +224,6 @@ protected:
     gb::Byte _getTargetValue8(Cpu::Target target) const;
     gb::Word _getTargetValue16(Cpu::Target target) const;
 
-    gb::Byte* _getTargetPtr8(Cpu::Target target); 
     gb::Word* _getTargetPtr16(Cpu::Target target); 
 
     void _load(Cpu::Target target, gb::Byte val);
@@ -152,9 +232,11 @@ protected:
     void _loadToMem(gb::Word addr, Cpu::Target source);
     void _loadFromMem(Cpu::Target target, gb::Word addr);
 
-    void _add8(Cpu::Target target, gb::Byte val);
+    // carry is the carry in for ADC and SBC, it takes part in the h and c flags
+    void _add8(Cpu::Target target, gb::Byte val, int carry = 0);
     void _add16(Cpu::Target target, gb::Word val);
-    void _sub8(Cpu::Target target, gb::Byte val);
+    gb::Word _addSp(gb::Byte offset);
+    void _sub8(Cpu::Target target, gb::Byte val, int carry = 0);
     void _sub16(Cpu::Target target, gb::Word val);
     void _and(Cpu::Target target, gb::Byte val);
     void _or(Cpu::Target target, gb::Byte val);
@@ -177,6 +259,9 @@ protected:
     
     void _compare(gb::Byte a, gb::Byte b);
 
+    void _serviceInterrupt(gb::Byte pending);
+    void _wait();
+
     void _call(gb::Word addr);
     void _return();
     void _reset();
@@ -187,6 +272,20 @@ protected:
 private:
     Registers _registers;
     Addressable* _memory;
+    Scheduler* _scheduler;
+    Interrupts* _interrupts;
+    Cgb* _cgb;
+    Tracer* _tracer;
+    Profiler* _profiler;
+    Sampler* _sampler;
+    uint64_t _cycles;
+    uint64_t _instructions;
+
+    // clock() was _clockBase at cycle _cycleBase
+    uint64_t _clockBase;
+    uint64_t _cycleBase;
+    unsigned int _speedShift;
+
     bool _interruptsEnabled;
     bool _isHalted;
     bool _isStopped;
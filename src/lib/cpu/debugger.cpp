@@ -0,0 +1,134 @@
+#include "debugger.h"
+using gb::Debugger;
+
+#include <algorithm>
+#include <cassert>
+
+Debugger::Debugger(Cpu* cpu, MMU* mmu) :
+    _cpu(cpu),
+    _mmu(mmu),
+    _breakpointBits(0x10000/8, 0),
+    _breakpointCount(0),
+    _isAtBreakpoint(false),
+    _breakpointPc(0),
+    _isWatchHit(false),
+    _watchAddress(0),
+    _watchAccess(MMU::AccessRead),
+    _watchValue(0)
+{
+    assert(_cpu && _mmu);
+    std::fill(_pageBreakpoints, _pageBreakpoints + MMU::NumPages, 0);
+    _mmu->setWatcher(this);
+}
+
+Debugger::~Debugger()
+{
+    _mmu->setWatcher(nullptr);
+}
+
+void Debugger::addBreakpoint(gb::Word address, Condition condition)
+{
+    if (!hasBreakpoint(address)) {
+        _breakpointBits[address >> 3] |= 1 << (address & 0x07);
+        ++_pageBreakpoints[address >> MMU::PageBits];
+        ++_breakpointCount;
+    }
+
+    if (condition) {
+        _conditions[address] = condition;
+    } else {
+        _conditions.erase(address);
+    }
+}
+
+void Debugger::removeBreakpoint(gb::Word address)
+{
+    if (!hasBreakpoint(address)) {
+        return;
+    }
+
+    _breakpointBits[address >> 3] &= ~(1 << (address & 0x07));
+    --_pageBreakpoints[address >> MMU::PageBits];
+    --_breakpointCount;
+    _conditions.erase(address);
+}
+
+bool Debugger::hasBreakpoint(gb::Word address) const
+{
+    return (_breakpointBits[address >> 3] & (1 << (address & 0x07))) != 0;
+}
+
+void Debugger::addWatchpoint(gb::Word address, int access)
+{
+    _mmu->watch(address, access);
+}
+
+void Debugger::removeWatchpoint(gb::Word address, int access)
+{
+    _mmu->unwatch(address, access);
+}
+
+Debugger::StopReason Debugger::run(uint64_t untilClock)
+{
+    if (_breakpointCount == 0 && !_mmu->hasWatches()) {
+        _isAtBreakpoint = false;
+        while (!_cpu->isStopped() && _cpu->clock() < untilClock) {
+            _cpu->processNextInstruction();
+        }
+        return _cpu->isStopped() ? StopCpuStopped : StopNone;
+    }
+
+    // Resuming from a breakpoint executes its instruction first
+    bool isResuming = _isAtBreakpoint && _cpu->registers().PC == _breakpointPc;
+    _isAtBreakpoint = false;
+
+    while (!_cpu->isStopped() && _cpu->clock() < untilClock) {
+        gb::Word pc = _cpu->registers().PC;
+        if (!isResuming && _isBreakpoint(pc)) {
+            _isAtBreakpoint = true;
+            _breakpointPc = pc;
+            return StopBreakpoint;
+        }
+        isResuming = false;
+
+        StopReason reason = step();
+        if (reason != StopNone) {
+            return reason;
+        }
+    }
+    return _cpu->isStopped() ? StopCpuStopped : StopNone;
+}
+
+Debugger::StopReason Debugger::step()
+{
+    _isWatchHit = false;
+    _cpu->processNextInstruction();
+
+    if (_isWatchHit) {
+        return StopWatchpoint;
+    }
+    return _cpu->isStopped() ? StopCpuStopped : StopNone;
+}
+
+void Debugger::onWatch(size_t address, MMU::Access access, gb::Byte val)
+{
+    // The first access of an instruction is the one reported
+    if (_isWatchHit) {
+        return;
+    }
+
+    _isWatchHit = true;
+    _watchAddress = static_cast<gb::Word>(address);
+    _watchAccess = access;
+    _watchValue = val;
+}
+
+bool Debugger::_isBreakpoint(gb::Word pc) const
+{
+    if (_pageBreakpoints[pc >> MMU::PageBits] == 0 || !hasBreakpoint(pc)) {
+        return false;
+    }
+
+    auto it = _conditions.find(pc);
+    return it == _conditions.end() || it->second(_cpu->registers());
+}
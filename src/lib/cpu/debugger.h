@@ -0,0 +1,101 @@
+#ifndef GB_DEBUGGER_H
+#define GB_DEBUGGER_H
+
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+#include "cpu/cpu.h"
+#include "cpu/mmu.h"
+#include "util/units.h"
+
+namespace gb {
+
+/**
+ * Breakpoints and memory watchpoints over a Cpu and its MMU.
+ *
+ * With nothing set run() is the plain instruction loop. Breakpoints are a
+ * PC bitmap with a per-page count in front of it, so instructions outside
+ * a page holding a breakpoint cost one load. Watchpoints live in the MMU
+ * page table and only slow down accesses to pages which hold one.
+ */
+class Debugger : public MMU::Watcher
+{
+public:
+    enum StopReason
+    {
+        StopNone,
+        StopBreakpoint,
+        StopWatchpoint,
+        StopCpuStopped,
+    };
+
+    /**
+     * Evaluated when a breakpoint is reached, the breakpoint only fires if
+     * it returns true.
+     */
+    typedef std::function<bool(const Cpu::Registers&)> Condition;
+
+    /**
+     * Caller retains ownership of cpu and mmu.
+     */
+    Debugger(Cpu* cpu, MMU* mmu);
+    ~Debugger();
+
+    void addBreakpoint(gb::Word address, Condition condition = Condition());
+    void removeBreakpoint(gb::Word address);
+    bool hasBreakpoint(gb::Word address) const;
+
+    /**
+     * access is a mask of MMU::Access bits.
+     */
+    void addWatchpoint(gb::Word address, int access);
+    void removeWatchpoint(gb::Word address, int access);
+
+    /**
+     * Runs until cpu.clock() reaches untilClock or something stops it, so a
+     * limit covers the same emulated time in CGB double speed. A breakpoint
+     * at the PC the last run stopped on is stepped over.
+     */
+    StopReason run(uint64_t untilClock);
+
+    /**
+     * Runs a single instruction, watchpoints still apply.
+     */
+    StopReason step();
+
+    /**
+     * The access which triggered the last StopWatchpoint.
+     */
+    gb::Word watchAddress() const       { return _watchAddress; }
+    MMU::Access watchAccess() const     { return _watchAccess; }
+    gb::Byte watchValue() const         { return _watchValue; }
+
+    virtual void onWatch(size_t address, MMU::Access access, gb::Byte val) override;
+
+private:
+    bool _isBreakpoint(gb::Word pc) const;
+
+    Cpu* _cpu;
+    MMU* _mmu;
+
+    // One bit per address, and the number of breakpoints in each page
+    std::vector<gb::Byte> _breakpointBits;
+    unsigned int _pageBreakpoints[MMU::NumPages];
+    std::unordered_map<gb::Word, Condition> _conditions;
+    size_t _breakpointCount;
+
+    // Set when the last run stopped at a breakpoint on this PC
+    bool _isAtBreakpoint;
+    gb::Word _breakpointPc;
+
+    bool _isWatchHit;
+    gb::Word _watchAddress;
+    MMU::Access _watchAccess;
+    gb::Byte _watchValue;
+};
+
+}
+
+#endif
@@ -0,0 +1,55 @@
+#include "dma.h"
+using gb::Dma;
+
+#include <cassert>
+
+Dma::Dma(MMU* mmu, Scheduler* scheduler, Addressable* oam, gb::Range oamRange) :
+    _mmu(mmu),
+    _scheduler(scheduler),
+    _oam(oam),
+    _oamRange(oamRange),
+    _isActive(false),
+    _source(0x00)
+{
+    assert(_mmu && _scheduler && _oam);
+    assert(_oamRange.max() - _oamRange.min() + 1 == TransferSize);
+    _finishEvent = _scheduler->addEvent([this](uint64_t) { _finish(); });
+}
+
+Dma::~Dma()
+{
+}
+
+gb::Byte& Dma::operator[](size_t address)
+{
+    assert(isValidAddress(address));
+    return _source;
+}
+
+bool Dma::isValidAddress(size_t address) const
+{
+    return address == 0;
+}
+
+void Dma::write(size_t address, gb::Byte val)
+{
+    assert(isValidAddress(address));
+    _source = val;
+
+    if (_isActive) {
+        // Restarting a transfer, OAM has to be writable for the copy
+        _mmu->remap(_oam, gb::Range(0, TransferSize - 1), _oamRange);
+    }
+
+    _mmu->copy(_oamRange.min(), static_cast<size_t>(val) << 8, TransferSize);
+
+    _mmu->remap(&_lockedOam, gb::Range(0, TransferSize - 1), _oamRange);
+    _isActive = true;
+    _scheduler->schedule(_finishEvent, _scheduler->now() + TransferCycles);
+}
+
+void Dma::_finish()
+{
+    _mmu->remap(_oam, gb::Range(0, TransferSize - 1), _oamRange);
+    _isActive = false;
+}
@@ -0,0 +1,58 @@
+#ifndef GB_DMA_H
+#define GB_DMA_H
+
+#include <cstdint>
+
+#include "cpu/addressable.h"
+#include "cpu/mmu.h"
+#include "cpu/openbus.h"
+#include "cpu/scheduler.h"
+#include "util/units.h"
+#include "util/util.h"
+
+namespace gb {
+
+/**
+ * OAM DMA, started by writing a source page to the DMA register (0xFF46).
+ *
+ * The 160 byte transfer runs immediately as one MMU::copy(), a memcpy when
+ * source and OAM are plain memory. The bus conflict window of the real
+ * transfer is modelled with the clock: OAM is remapped to a stand-in which
+ * reads 0xFF and ignores writes, and a scheduled event maps it back once the
+ * transfer time has passed.
+ */
+class Dma : public Addressable
+{
+public:
+    static const size_t TransferSize = 0xA0;
+    static const uint64_t TransferCycles = 640;
+
+    /**
+     * oam must be mapped into mmu at oamRange. Caller retains ownership of
+     * mmu, scheduler and oam.
+     */
+    Dma(MMU* mmu, Scheduler* scheduler, Addressable* oam, gb::Range oamRange);
+    ~Dma();
+
+    bool isActive() const { return _isActive; }
+
+    virtual gb::Byte& operator[](size_t address) override;
+    virtual bool isValidAddress(size_t address) const override;
+    virtual void write(size_t address, gb::Byte val) override;
+
+private:
+    void _finish();
+
+    MMU* _mmu;
+    Scheduler* _scheduler;
+    Addressable* _oam;
+    gb::Range _oamRange;
+    OpenBus _lockedOam;
+    Scheduler::EventId _finishEvent;
+    bool _isActive;
+    gb::Byte _source;
+};
+
+}
+
+#endif
@@ -0,0 +1,146 @@
+#include "gameboy.h"
+using gb::GameBoy;
+
+#include <algorithm>
+#include <cassert>
+
+namespace {
+
+struct IoValue
+{
+    gb::Word address;
+    gb::Byte value;
+};
+
+// Registers as the DMG boot ROM leaves them. NR52 comes first so the APU
+// takes the rest, and the NRx4 trigger bits are left out so no channel
+// starts playing.
+const IoValue PostBootIo[] = {
+    {0xFF26, 0xF1}, {0xFF05, 0x00}, {0xFF06, 0x00}, {0xFF07, 0x00}, {0xFF0F, 0xE1},
+    {0xFF10, 0x80}, {0xFF11, 0xBF}, {0xFF12, 0xF3}, {0xFF14, 0x3F}, {0xFF16, 0x3F},
+    {0xFF17, 0x00}, {0xFF19, 0x3F}, {0xFF1A, 0x7F}, {0xFF1B, 0xFF}, {0xFF1C, 0x9F},
+    {0xFF1E, 0x3F}, {0xFF20, 0xFF}, {0xFF21, 0x00}, {0xFF22, 0x00}, {0xFF23, 0x3F},
+    {0xFF24, 0x77}, {0xFF25, 0xF3}, {0xFF40, 0x91}, {0xFF42, 0x00}, {0xFF43, 0x00},
+    {0xFF45, 0x00}, {0xFF47, 0xFC}, {0xFF48, 0xFF}, {0xFF49, 0xFF}, {0xFF4A, 0x00},
+    {0xFF4B, 0x00}, {0xFFFF, 0x00},
+};
+
+// Internal timer counter at 0x0100, DIV reads 0xAB
+const uint16_t PostBootCounter = 0xABCC;
+
+}
+
+GameBoy::GameBoy() :
+    _vram(VramSize),
+    _wram(WramSize),
+    _oam(Dma::TransferSize),
+    _hram(HramSize),
+    _io(0x80),
+    _timer(&_scheduler, &_interrupts),
+    _serial(&_scheduler, &_interrupts),
+    _joypad(&_scheduler, &_interrupts),
+    _dma(&_mmu, &_scheduler, &_oam, gb::Range(0xFE00, 0xFE9F)),
+    _apu(&_scheduler),
+    _cgb(&_mmu, &_vram, &_wram, &_timer, &_serial),
+    _hdma(&_mmu, &_scheduler),
+    _cartridge(nullptr),
+    _saveFlushEvent(-1)
+{
+    for (Memory* mem : {&_vram, &_wram, &_oam, &_hram, &_io}) {
+        std::fill(mem->data(), mem->data() + mem->size(), 0x00);
+    }
+
+    // Bank 0 of VRAM and banks 0 and 1 of WRAM, the switchable windows are
+    // separate mappings so Cgb can re-point them
+    _mmu.map(&_vram, gb::Range(0x0000, Cgb::VramBankSize - 1), gb::Range(0x8000, 0x9FFF));
+    _mmu.map(&_wram, gb::Range(0x0000, 0x0FFF), gb::Range(0xC000, 0xCFFF));
+    _mmu.map(&_wram, gb::Range(0x1000, 0x1FFF), gb::Range(0xD000, 0xDFFF));
+    _mmu.map(&_wram, gb::Range(0x0000, 0x0FFF), gb::Range(0xE000, 0xEFFF));
+    _mmu.map(&_wram, gb::Range(0x1000, 0x1DFF), gb::Range(0xF000, 0xFDFF));
+    _mmu.map(&_oam, gb::Range(0x00, Dma::TransferSize - 1), gb::Range(0xFE00, 0xFE9F));
+    _mmu.map(&_unusable, gb::Range(0x00, 0x5F), gb::Range(0xFEA0, 0xFEFF));
+    _mmu.map(&_hram, gb::Range(0x00, HramSize - 1), gb::Range(0xFF80, 0xFFFE));
+    _mapIo();
+
+    _cpu.setMemory(&_mmu);
+    _cpu.setScheduler(&_scheduler);
+    _cpu.setInterrupts(&_interrupts);
+    _cpu.setCgb(&_cgb);
+}
+
+GameBoy::~GameBoy()
+{
+}
+
+bool GameBoy::loadBootRom(const std::vector<gb::Byte>& image)
+{
+    assert(!_cartridge);
+    return _bootRom.load(image);
+}
+
+void GameBoy::skipBoot()
+{
+    assert(_cartridge && !_bootRom.isMapped());
+
+    for (const IoValue& io : PostBootIo) {
+        _mmu.write(io.address, io.value);
+    }
+    _timer.setCounter(PostBootCounter);
+
+    // A CGB boot ROM identifies itself to the game through A
+    Cpu::Registers& regs = _cpu.registers();
+    regs.AF = _cartridge->isCgb() ? 0x1180 : 0x01B0;
+    regs.BC = _cartridge->isCgb() ? 0x0000 : 0x0013;
+    regs.DE = _cartridge->isCgb() ? 0xFF56 : 0x00D8;
+    regs.HL = _cartridge->isCgb() ? 0x000D : 0x014D;
+    regs.SP = 0xFFFE;
+    regs.PC = 0x0100;
+    _cpu.setInterruptsEnabled(false);
+}
+
+void GameBoy::insertCartridge(Cartridge* cartridge)
+{
+    assert(cartridge && !_cartridge);
+    _cartridge = cartridge;
+    _cartridge->attach(&_mmu);
+    if (_bootRom.isLoaded()) {
+        _bootRom.attach(_cartridge);
+    }
+    _cartridge->rtc().setScheduler(&_scheduler);
+    _cgb.setEnabled(_cartridge->isCgb());
+    _hdma.setEnabled(_cartridge->isCgb());
+
+    if (_cartridge->hasSave()) {
+        _saveFlushEvent = _scheduler.addEvent([this](uint64_t when) { _flushSave(when); });
+        _scheduler.schedule(_saveFlushEvent, _scheduler.now() + SaveFlushInterval);
+    }
+}
+
+void GameBoy::_mapIo()
+{
+    _mmu.map(&_joypad, gb::Range(0x00, 0x00), gb::Range(0xFF00, 0xFF00));
+    _mmu.map(&_serial, gb::Range(Serial::RegSB, Serial::RegSC), gb::Range(0xFF01, 0xFF02));
+    _mmu.map(&_timer, gb::Range(Timer::RegDIV, Timer::RegTAC), gb::Range(0xFF04, 0xFF07));
+    _mmu.map(&_interrupts, gb::Range(Interrupts::RegIF, Interrupts::RegIF), gb::Range(0xFF0F, 0xFF0F));
+    _mmu.map(&_apu, gb::Range(Apu::RegNR10, Apu::NumRegisters - 1), gb::Range(0xFF10, 0xFF3F));
+    _mmu.map(&_dma, gb::Range(0x00, 0x00), gb::Range(0xFF46, 0xFF46));
+    _mmu.map(&_cgb, gb::Range(Cgb::RegKEY1, Cgb::RegKEY1), gb::Range(0xFF4D, 0xFF4D));
+    _mmu.map(&_cgb, gb::Range(Cgb::RegVBK, Cgb::RegVBK), gb::Range(0xFF4F, 0xFF4F));
+    _mmu.map(&_bootRom, gb::Range(0x00, 0x00), gb::Range(0xFF50, 0xFF50));
+    _mmu.map(&_hdma, gb::Range(Hdma::RegHDMA1, Hdma::RegHDMA5), gb::Range(0xFF51, 0xFF55));
+    _mmu.map(&_cgb, gb::Range(Cgb::RegSVBK, Cgb::RegSVBK), gb::Range(0xFF70, 0xFF70));
+    _mmu.map(&_interrupts, gb::Range(Interrupts::RegIE, Interrupts::RegIE), gb::Range(0xFFFF, 0xFFFF));
+
+    // Everything else in the I/O page is a plain register for now
+    for (size_t address = 0xFF00; address < 0xFF80; ++address) {
+        if (!_mmu.isValidAddress(address)) {
+            _mmu.map(&_io, gb::Range(address & 0x7F, address & 0x7F), gb::Range(address, address));
+        }
+    }
+}
+
+void GameBoy::_flushSave(uint64_t when)
+{
+    _cartridge->flushSave();
+    _scheduler.schedule(_saveFlushEvent, when + SaveFlushInterval);
+}
@@ -0,0 +1,113 @@
+#ifndef GB_GAMEBOY_H
+#define GB_GAMEBOY_H
+
+#include "cpu/apu.h"
+#include "cpu/bootrom.h"
+#include "cpu/cartridge.h"
+#include "cpu/cgb.h"
+#include "cpu/cpu.h"
+#include "cpu/dma.h"
+#include "cpu/hdma.h"
+#include "cpu/interrupts.h"
+#include "cpu/joypad.h"
+#include "cpu/memory.h"
+#include "cpu/mmu.h"
+#include "cpu/openbus.h"
+#include "cpu/scheduler.h"
+#include "cpu/serial.h"
+#include "cpu/timer.h"
+
+namespace gb {
+
+/**
+ * Wires the Cpu and peripherals together behind the GameBoy memory map.
+ *
+ * I/O addresses without a device are backed by plain registers so that
+ * software touching hardware which isn't emulated yet keeps running.
+ */
+class GameBoy
+{
+public:
+    // Every bank of the GameBoy Color, DMG cartridges only see the first
+    static const size_t VramSize = Cgb::VramBanks*Cgb::VramBankSize;
+    static const size_t WramSize = Cgb::WramBanks*Cgb::WramBankSize;
+    static const size_t HramSize = 0x7F;
+
+    // Save RAM is written back once per emulated second
+    static const uint64_t SaveFlushInterval = 4194304;
+
+    GameBoy();
+    ~GameBoy();
+
+    /**
+     * Runs image from 0x0000 before the cartridge. Must be called before
+     * insertCartridge(). Returns false if the image isn't a DMG boot ROM.
+     */
+    bool loadBootRom(const std::vector<gb::Byte>& image);
+
+    /**
+     * Installs the CPU registers and I/O values the boot ROM leaves behind
+     * and starts at the cartridge entry point 0x0100. Call after
+     * insertCartridge() when not running a boot ROM.
+     */
+    void skipBoot();
+
+    /**
+     * Maps cartridge at 0x0000-0x7FFF and 0xA000-0xBFFF. Must be called once
+     * before running. Caller retains ownership of cartridge.
+     *
+     * If the cartridge has a save file it's flushed every SaveFlushInterval
+     * cycles. A GameBoy Color cartridge enables the CGB registers and HDMA.
+     */
+    void insertCartridge(Cartridge* cartridge);
+
+    Cpu& cpu()                  { return _cpu; }
+    MMU& mmu()                  { return _mmu; }
+    Scheduler& scheduler()      { return _scheduler; }
+    Interrupts& interrupts()    { return _interrupts; }
+    Timer& timer()              { return _timer; }
+    Dma& dma()                  { return _dma; }
+    Apu& apu()                  { return _apu; }
+    Serial& serial()            { return _serial; }
+    Joypad& joypad()            { return _joypad; }
+    Cgb& cgb()                  { return _cgb; }
+    Hdma& hdma()                { return _hdma; }
+    Memory& vram()              { return _vram; }
+    Memory& wram()              { return _wram; }
+    Memory& oam()               { return _oam; }
+    Memory& hram()              { return _hram; }
+    BootRom& bootRom()          { return _bootRom; }
+    Cartridge* cartridge()      { return _cartridge; }
+
+private:
+    void _mapIo();
+    void _flushSave(uint64_t when);
+
+    Scheduler _scheduler;
+    Interrupts _interrupts;
+    MMU _mmu;
+
+    Memory _vram;
+    Memory _wram;
+    Memory _oam;
+    Memory _hram;
+    Memory _io;
+    OpenBus _unusable;
+
+    Timer _timer;
+    Serial _serial;
+    Joypad _joypad;
+    Dma _dma;
+    Apu _apu;
+    Cgb _cgb;
+    Hdma _hdma;
+    BootRom _bootRom;
+    Cpu _cpu;
+
+    Cartridge* _cartridge;
+    Scheduler::EventId _saveFlushEvent;
+};
+
+}
+
+#endif
@@ -0,0 +1,421 @@
+#include "gdbstub.h"
+using gb::GdbStub;
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cassert>
+
+namespace {
+
+const char HexDigits[] = "0123456789abcdef";
+
+void appendHex(std::string& out, gb::Byte val)
+{
+    out.push_back(HexDigits[val >> 4]);
+    out.push_back(HexDigits[val & 0x0F]);
+}
+
+int hexValue(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+/**
+ * Parses a hex number from str at pos up to the next non hex digit, pos is
+ * left after it. Returns false if there are no digits.
+ */
+bool parseHex(const std::string& str, size_t& pos, unsigned long& val)
+{
+    size_t start = pos;
+    val = 0;
+    while (pos < str.size() && hexValue(str[pos]) >= 0) {
+        val = (val << 4) | hexValue(str[pos]);
+        ++pos;
+    }
+    return pos > start;
+}
+
+bool parseByte(const std::string& str, size_t pos, gb::Byte& val)
+{
+    if (pos + 1 >= str.size() || hexValue(str[pos]) < 0 || hexValue(str[pos + 1]) < 0) {
+        return false;
+    }
+    val = static_cast<gb::Byte>((hexValue(str[pos]) << 4) | hexValue(str[pos + 1]));
+    return true;
+}
+
+}
+
+GdbStub::GdbStub(Cpu* cpu, MMU* mmu, Debugger* debugger) :
+    _cpu(cpu),
+    _mmu(mmu),
+    _debugger(debugger),
+    _listenFd(-1),
+    _clientFd(-1),
+    _isDone(false),
+    _isKilled(false)
+{
+    assert(_cpu && _mmu && _debugger);
+}
+
+GdbStub::~GdbStub()
+{
+    _close();
+    if (_listenFd >= 0) {
+        ::close(_listenFd);
+    }
+}
+
+bool GdbStub::listen(int port)
+{
+    _listenFd = socket(AF_INET, SOCK_STREAM, 0);
+    if (_listenFd < 0) {
+        return false;
+    }
+
+    int one = 1;
+    setsockopt(_listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(_listenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 ||
+        ::listen(_listenFd, 1) < 0) {
+        ::close(_listenFd);
+        _listenFd = -1;
+        return false;
+    }
+    return true;
+}
+
+bool GdbStub::serve()
+{
+    if (_listenFd < 0) {
+        return false;
+    }
+
+    _clientFd = accept(_listenFd, nullptr, nullptr);
+    if (_clientFd < 0) {
+        return false;
+    }
+
+    // Packets are small and latency bound
+    int one = 1;
+    setsockopt(_clientFd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    _isDone = false;
+    std::string packet;
+    while (!_isDone && _readPacket(packet)) {
+        std::string reply = handlePacket(packet);
+        if (!_isKilled && !_sendPacket(reply)) {
+            break;
+        }
+    }
+
+    _close();
+    return true;
+}
+
+std::string GdbStub::handlePacket(const std::string& packet)
+{
+    if (packet.empty()) {
+        return "";
+    }
+
+    std::string args = packet.substr(1);
+    switch (packet[0]) {
+        case '?':
+            return "S05";
+        case 'g':
+            return _readRegisters();
+        case 'G':
+            return _writeRegisters(args);
+        case 'm':
+            return _readMemory(args);
+        case 'M':
+            return _writeMemory(args);
+        case 'Z':
+            return _setBreakpoint(args, true);
+        case 'z':
+            return _setBreakpoint(args, false);
+        case 'H':
+            return "OK";
+        case 'p':
+        {
+            size_t pos = 0;
+            unsigned long index = 0;
+            if (!parseHex(args, pos, index) || index >= NumRegisters) {
+                return "E01";
+            }
+            return _readRegisters().substr(index*4, 4);
+        }
+        case 'P':
+        {
+            size_t pos = 0;
+            unsigned long index = 0;
+            if (!parseHex(args, pos, index) || index >= NumRegisters || pos >= args.size() ||
+                args[pos] != '=') {
+                return "E01";
+            }
+            std::string regs = _readRegisters();
+            regs.replace(index*4, 4, args.substr(pos + 1, 4));
+            return _writeRegisters(regs);
+        }
+        case 'c':
+        case 's':
+        {
+            size_t pos = 0;
+            unsigned long address = 0;
+            if (parseHex(args, pos, address)) {
+                _cpu->registers().PC = static_cast<gb::Word>(address);
+            }
+            return packet[0] == 'c' ? _continue() : _stopReply(_debugger->step());
+        }
+        case 'D':
+            _isDone = true;
+            return "OK";
+        case 'k':
+            _isDone = true;
+            _isKilled = true;
+            return "";
+        case 'q':
+            if (packet.compare(0, 10, "qSupported") == 0) {
+                return "PacketSize=1000";
+            }
+            if (packet == "qAttached") {
+                return "1";
+            }
+            return "";
+        default:
+            // Unsupported packets get an empty reply
+            return "";
+    }
+}
+
+std::string GdbStub::encodePacket(const std::string& payload)
+{
+    unsigned int checksum = 0;
+    for (char c : payload) {
+        checksum += static_cast<unsigned char>(c);
+    }
+
+    std::string out = "$" + payload + "#";
+    appendHex(out, static_cast<gb::Byte>(checksum & 0xFF));
+    return out;
+}
+
+std::string GdbStub::_stopReply(Debugger::StopReason reason) const
+{
+    switch (reason) {
+        case Debugger::StopWatchpoint:
+        {
+            std::string reply = _debugger->watchAccess() == MMU::AccessWrite ? "T05watch:" : "T05rwatch:";
+            gb::Word address = _debugger->watchAddress();
+            appendHex(reply, address >> 8);
+            appendHex(reply, address & 0xFF);
+            return reply + ";";
+        }
+        case Debugger::StopCpuStopped:
+            return "W00";
+        default:
+            return "S05";
+    }
+}
+
+std::string GdbStub::_readRegisters()
+{
+    const Cpu::Registers& regs = _cpu->registers();
+    std::string out;
+    for (gb::Word reg : {regs.AF, regs.BC, regs.DE, regs.HL, regs.SP, regs.PC}) {
+        appendHex(out, reg & 0xFF);
+        appendHex(out, reg >> 8);
+    }
+    return out;
+}
+
+std::string GdbStub::_writeRegisters(const std::string& args)
+{
+    gb::Word values[NumRegisters];
+    for (int i = 0; i < NumRegisters; ++i) {
+        gb::Byte low = 0;
+        gb::Byte high = 0;
+        if (!parseByte(args, i*4, low) || !parseByte(args, i*4 + 2, high)) {
+            return "E01";
+        }
+        values[i] = static_cast<gb::Word>(low | (high << 8));
+    }
+
+    Cpu::Registers& regs = _cpu->registers();
+    regs.AF = values[RegAF];
+    regs.BC = values[RegBC];
+    regs.DE = values[RegDE];
+    regs.HL = values[RegHL];
+    regs.SP = values[RegSP];
+    regs.PC = values[RegPC];
+    return "OK";
+}
+
+std::string GdbStub::_readMemory(const std::string& args)
+{
+    size_t pos = 0;
+    unsigned long address = 0;
+    unsigned long length = 0;
+    if (!parseHex(args, pos, address) || pos >= args.size() || args[pos++] != ',' ||
+        !parseHex(args, pos, length)) {
+        return "E01";
+    }
+
+    std::string out;
+    for (unsigned long i = 0; i < length; ++i) {
+        if (!_mmu->isValidAddress(address + i)) {
+            return out.empty() ? "E14" : out;
+        }
+        appendHex(out, (*_mmu)[address + i]);
+    }
+    return out;
+}
+
+std::string GdbStub::_writeMemory(const std::string& args)
+{
+    size_t pos = 0;
+    unsigned long address = 0;
+    unsigned long length = 0;
+    if (!parseHex(args, pos, address) || pos >= args.size() || args[pos++] != ',' ||
+        !parseHex(args, pos, length) || pos >= args.size() || args[pos++] != ':') {
+        return "E01";
+    }
+
+    for (unsigned long i = 0; i < length; ++i) {
+        gb::Byte val = 0;
+        if (!parseByte(args, pos + i*2, val) || !_mmu->isValidAddress(address + i)) {
+            return "E14";
+        }
+        (*_mmu)[address + i] = val;
+    }
+    return "OK";
+}
+
+std::string GdbStub::_setBreakpoint(const std::string& args, bool isInsert)
+{
+    size_t pos = 0;
+    unsigned long type = 0;
+    unsigned long address = 0;
+    if (!parseHex(args, pos, type) || pos >= args.size() || args[pos++] != ',' ||
+        !parseHex(args, pos, address) || address > 0xFFFF) {
+        return "E01";
+    }
+
+    gb::Word word = static_cast<gb::Word>(address);
+    int access = 0;
+    switch (type) {
+        case 0:
+        case 1:
+            if (isInsert) {
+                _debugger->addBreakpoint(word);
+            } else {
+                _debugger->removeBreakpoint(word);
+            }
+            return "OK";
+        case 2: access = MMU::AccessWrite; break;
+        case 3: access = MMU::AccessRead; break;
+        case 4: access = MMU::AccessRead | MMU::AccessWrite; break;
+        default:
+            return "";
+    }
+
+    if (isInsert) {
+        _debugger->addWatchpoint(word, access);
+    } else {
+        _debugger->removeWatchpoint(word, access);
+    }
+    return "OK";
+}
+
+std::string GdbStub::_continue()
+{
+    while (true) {
+        Debugger::StopReason reason = _debugger->run(_cpu->clock() + ContinueCycles);
+        if (reason != Debugger::StopNone) {
+            return _stopReply(reason);
+        }
+        if (_isInterruptPending()) {
+            return "S02";
+        }
+    }
+}
+
+bool GdbStub::_readPacket(std::string& payload)
+{
+    char c = 0;
+    while (true) {
+        if (recv(_clientFd, &c, 1, 0) != 1) {
+            return false;
+        }
+        if (c != '$') {
+            // Acks, and interrupts which arrive while already stopped
+            continue;
+        }
+
+        payload.clear();
+        while (recv(_clientFd, &c, 1, 0) == 1 && c != '#') {
+            payload.push_back(c);
+        }
+
+        char checksum[2];
+        if (c != '#' || recv(_clientFd, checksum, 2, MSG_WAITALL) != 2) {
+            return false;
+        }
+
+        std::string expected = encodePacket(payload);
+        bool isValid = expected.compare(expected.size() - 2, 2, checksum, 2) == 0;
+        if (send(_clientFd, isValid ? "+" : "-", 1, 0) != 1) {
+            return false;
+        }
+        if (isValid) {
+            return true;
+        }
+    }
+}
+
+bool GdbStub::_sendPacket(const std::string& payload)
+{
+    std::string packet = encodePacket(payload);
+    return send(_clientFd, packet.data(), packet.size(), 0) == static_cast<ssize_t>(packet.size());
+}
+
+bool GdbStub::_isInterruptPending()
+{
+    if (_clientFd < 0) {
+        return false;
+    }
+
+    pollfd fd = {_clientFd, POLLIN, 0};
+    if (poll(&fd, 1, 0) <= 0) {
+        return false;
+    }
+
+    // The client sends a bare 0x03 to interrupt, a hang up stops us too
+    char c = 0;
+    if (recv(_clientFd, &c, 1, 0) != 1) {
+        _isDone = true;
+        return true;
+    }
+    return c == 0x03;
+}
+
+void GdbStub::_close()
+{
+    if (_clientFd >= 0) {
+        ::close(_clientFd);
+        _clientFd = -1;
+    }
+}
@@ -0,0 +1,100 @@
+#ifndef GB_GDBSTUB_H
+#define GB_GDBSTUB_H
+
+#include <cstdint>
+#include <string>
+
+#include "cpu/cpu.h"
+#include "cpu/debugger.h"
+#include "cpu/mmu.h"
+#include "util/units.h"
+
+namespace gb {
+
+/**
+ * Serves the GDB remote serial protocol to one client on a localhost TCP
+ * port.
+ *
+ * The register file is AF, BC, DE, HL, SP and PC, 16 bits each in little
+ * endian. Memory accesses are raw, so reading I/O registers has no side
+ * effects. Continue runs the Debugger a batch of ContinueCycles at a time,
+ * checking for an interrupt from the client in between, rather than
+ * stepping instruction by instruction.
+ */
+class GdbStub
+{
+public:
+    enum RegisterIndex
+    {
+        RegAF,
+        RegBC,
+        RegDE,
+        RegHL,
+        RegSP,
+        RegPC,
+        NumRegisters,
+    };
+
+    static const uint64_t ContinueCycles = 70224;
+
+    /**
+     * Caller retains ownership of cpu, mmu and debugger.
+     */
+    GdbStub(Cpu* cpu, MMU* mmu, Debugger* debugger);
+    ~GdbStub();
+
+    /**
+     * Starts listening on 127.0.0.1:port. Returns false on failure.
+     */
+    bool listen(int port);
+
+    /**
+     * Waits for a client, then serves it until it detaches, kills the
+     * program or disconnects, or the Cpu stops. Returns false if no client
+     * could be accepted.
+     */
+    bool serve();
+
+    /**
+     * The client asked for the program to be killed.
+     */
+    bool isKilled() const { return _isKilled; }
+
+    /**
+     * Reply payload for a packet payload, without framing. Continue and step
+     * run the Cpu before replying.
+     */
+    std::string handlePacket(const std::string& packet);
+
+    /**
+     * Frames payload as $payload#checksum.
+     */
+    static std::string encodePacket(const std::string& payload);
+
+private:
+    std::string _stopReply(Debugger::StopReason reason) const;
+    std::string _readRegisters();
+    std::string _writeRegisters(const std::string& args);
+    std::string _readMemory(const std::string& args);
+    std::string _writeMemory(const std::string& args);
+    std::string _setBreakpoint(const std::string& args, bool isInsert);
+    std::string _continue();
+
+    bool _readPacket(std::string& payload);
+    bool _sendPacket(const std::string& payload);
+    bool _isInterruptPending();
+    void _close();
+
+    Cpu* _cpu;
+    MMU* _mmu;
+    Debugger* _debugger;
+
+    int _listenFd;
+    int _clientFd;
+    bool _isDone;
+    bool _isKilled;
+};
+
+}
+
+#endif
@@ -0,0 +1,133 @@
+#include "hdma.h"
+using gb::Hdma;
+
+#include <algorithm>
+#include <cassert>
+
+Hdma::Hdma(MMU* mmu, Scheduler* scheduler) :
+    _mmu(mmu),
+    _scheduler(scheduler),
+    _isEnabled(false)
+{
+    assert(_mmu && _scheduler);
+    _hblankEvent = _scheduler->addEvent([this](uint64_t when) { _hblank(when); });
+    reset();
+}
+
+Hdma::~Hdma()
+{
+}
+
+void Hdma::reset()
+{
+    _isActive = false;
+    _source = 0x0000;
+    _dest = 0x0000;
+    _blocks = 0;
+    _scheduler->cancel(_hblankEvent);
+}
+
+uint64_t Hdma::nextHBlank(uint64_t when)
+{
+    uint64_t lineStart = when - when % LineCycles;
+    if ((when % FrameCycles)/LineCycles >= VisibleLines) {
+        // In VBlank, wait for line 0 of the next frame
+        return when - when % FrameCycles + FrameCycles + HBlankStart;
+    }
+    return std::max(when, lineStart + HBlankStart);
+}
+
+gb::Byte& Hdma::operator[](size_t address)
+{
+    assert(isValidAddress(address));
+    _snapshot[address] = read(address);
+    return _snapshot[address];
+}
+
+bool Hdma::isValidAddress(size_t address) const
+{
+    return address <= RegHDMA5;
+}
+
+gb::Byte Hdma::read(size_t address)
+{
+    assert(isValidAddress(address));
+    if (!_isEnabled || address != RegHDMA5) {
+        return 0xFF;
+    }
+
+    // Bit 7 is clear while an HBlank transfer runs, a finished transfer
+    // reads 0xFF
+    return (_isActive ? 0x00 : 0x80) | ((_blocks - 1) & 0x7F);
+}
+
+void Hdma::write(size_t address, gb::Byte val)
+{
+    assert(isValidAddress(address));
+    if (!_isEnabled) {
+        return;
+    }
+
+    switch (address) {
+        case RegHDMA1:
+            _source = static_cast<gb::Word>((val << 8) | (_source & 0x00FF));
+            return;
+        case RegHDMA2:
+            _source = static_cast<gb::Word>((_source & 0xFF00) | (val & 0xF0));
+            return;
+        case RegHDMA3:
+            _dest = static_cast<gb::Word>(((val & 0x1F) << 8) | (_dest & 0x00FF));
+            return;
+        case RegHDMA4:
+            _dest = static_cast<gb::Word>((_dest & 0x1F00) | (val & 0xF0));
+            return;
+        default:
+            break;
+    }
+
+    size_t blocks = (val & 0x7F) + 1;
+    if (_isActive && (val & 0x80) == 0) {
+        // Stops the HBlank transfer, the remaining length stays readable
+        _scheduler->cancel(_hblankEvent);
+        _isActive = false;
+        return;
+    }
+
+    if (val & 0x80) {
+        _blocks = blocks;
+        _isActive = true;
+        _scheduler->schedule(_hblankEvent, nextHBlank(_scheduler->now()));
+        return;
+    }
+
+    _copy(blocks);
+    _blocks = 0;
+}
+
+void Hdma::_copy(size_t blocks)
+{
+    // Split only where the destination wraps around VRAM or the source
+    // around the address space
+    size_t length = blocks*BlockSize;
+    while (length > 0) {
+        size_t dest = 0x8000 + _dest;
+        size_t run = std::min(length, std::min<size_t>(0xA000 - dest, 0x10000 - _source));
+        _mmu->copy(dest, _source, run);
+
+        _source = static_cast<gb::Word>(_source + run);
+        _dest = static_cast<gb::Word>((_dest + run) & 0x1FF0);
+        length -= run;
+    }
+}
+
+void Hdma::_hblank(uint64_t when)
+{
+    _copy(1);
+    if (--_blocks == 0) {
+        _isActive = false;
+        return;
+    }
+
+    uint64_t nextLine = when - when % LineCycles + LineCycles;
+    _scheduler->schedule(_hblankEvent, nextHBlank(nextLine));
+}
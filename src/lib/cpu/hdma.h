@@ -0,0 +1,93 @@
+#ifndef GB_HDMA_H
+#define GB_HDMA_H
+
+#include <cstdint>
+
+#include "cpu/addressable.h"
+#include "cpu/mmu.h"
+#include "cpu/scheduler.h"
+#include "util/units.h"
+
+namespace gb {
+
+/**
+ * GameBoy Color VRAM DMA, HDMA1-HDMA5 (0xFF51-0xFF55).
+ *
+ * A general purpose transfer runs immediately as one MMU::copy(), a single
+ * memcpy when source and VRAM are plain memory. An HBlank transfer copies a
+ * 16 byte block per scheduled event, one at the start of each visible
+ * line's HBlank. Until the LCD is emulated the HBlank times follow the
+ * fixed scanline timing from clock 0.
+ *
+ * On a DMG cartridge the registers are disabled, they read 0xFF and ignore
+ * writes.
+ */
+class Hdma : public Addressable
+{
+public:
+    enum Register
+    {
+        RegHDMA1 = 0,
+        RegHDMA2 = 1,
+        RegHDMA3 = 2,
+        RegHDMA4 = 3,
+        RegHDMA5 = 4,
+    };
+
+    static const size_t BlockSize = 0x10;
+
+    // Scanline timing, in normal speed clock cycles
+    static const uint64_t LineCycles = 456;
+    static const uint64_t HBlankStart = 252;
+    static const uint64_t VisibleLines = 144;
+    static const uint64_t FrameCycles = 154*LineCycles;
+
+    /**
+     * Caller retains ownership of mmu and scheduler.
+     */
+    Hdma(MMU* mmu, Scheduler* scheduler);
+    ~Hdma();
+
+    void reset();
+
+    bool isEnabled() const          { return _isEnabled; }
+    void setEnabled(bool isEnabled) { _isEnabled = isEnabled; }
+
+    bool isActive() const           { return _isActive; }
+
+    /**
+     * Start of the first HBlank of a visible line at or after when, or when
+     * itself if that's within one.
+     */
+    static uint64_t nextHBlank(uint64_t when);
+
+    /**
+     * Raw access to a snapshot of the registers, for debugging. Writes
+     * through the returned reference are not seen by the transfer.
+     */
+    virtual gb::Byte& operator[](size_t address) override;
+    virtual bool isValidAddress(size_t address) const override;
+    virtual gb::Byte read(size_t address) override;
+    virtual void write(size_t address, gb::Byte val) override;
+
+private:
+    void _copy(size_t blocks);
+    void _hblank(uint64_t when);
+
+    MMU* _mmu;
+    Scheduler* _scheduler;
+    Scheduler::EventId _hblankEvent;
+
+    bool _isEnabled;
+    bool _isActive;
+    gb::Word _source;
+    gb::Word _dest;
+
+    // Blocks left of the current or last HBlank transfer
+    size_t _blocks;
+    gb::Byte _snapshot[5];
+};
+
+}
+
+#endif
@@ -0,0 +1,79 @@
+#ifndef GB_INTERRUPTS_H
+#define GB_INTERRUPTS_H
+
+#include <cassert>
+
+#include "cpu/addressable.h"
+#include "util/units.h"
+
+namespace gb {
+
+/**
+ * The interrupt flag (IF, 0xFF0F) and interrupt enable (IE, 0xFFFF) registers.
+ *
+ * Local address 0 is IF and 1 is IE, so the two are mapped separately.
+ * Peripherals call request() and the Cpu services whatever is pending().
+ */
+class Interrupts : public Addressable
+{
+public:
+    enum Interrupt
+    {
+        InterruptVBlank = 0,
+        InterruptStat   = 1,
+        InterruptTimer  = 2,
+        InterruptSerial = 3,
+        InterruptJoypad = 4,
+    };
+
+    enum Register
+    {
+        RegIF = 0,
+        RegIE = 1,
+    };
+
+    Interrupts()
+    {
+        reset();
+    }
+
+    void reset()
+    {
+        _regs[RegIF] = 0x00;
+        _regs[RegIE] = 0x00;
+    }
+
+    void request(Interrupt interrupt)     { _regs[RegIF] |= (1 << interrupt); }
+    void acknowledge(Interrupt interrupt) { _regs[RegIF] &= ~(1 << interrupt); }
+
+    /**
+     * Bitmask of interrupts which are both requested and enabled.
+     */
+    gb::Byte pending() const { return _regs[RegIF] & _regs[RegIE] & 0x1F; }
+
+    virtual gb::Byte& operator[](size_t address) override
+    {
+        assert(isValidAddress(address));
+        return _regs[address];
+    }
+
+    virtual bool isValidAddress(size_t address) const override
+    {
+        return address <= RegIE;
+    }
+
+    virtual gb::Byte read(size_t address) override
+    {
+        assert(isValidAddress(address));
+
+        // Unused IF bits read back as set
+        return address == RegIF ? (_regs[RegIF] | 0xE0) : _regs[RegIE];
+    }
+
+private:
+    gb::Byte _regs[2];
+};
+
+}
+
+#endif
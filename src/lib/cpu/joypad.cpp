@@ -0,0 +1,115 @@
+#include "joypad.h"
+using gb::Joypad;
+
+#include <cassert>
+
+namespace {
+
+const size_t QueueSize = 256;
+
+}
+
+Joypad::Joypad(Scheduler* scheduler, Interrupts* interrupts) :
+    _scheduler(scheduler),
+    _interrupts(interrupts),
+    _queue(QueueSize)
+{
+    assert(_scheduler && _interrupts);
+    _pollEvent = _scheduler->addEvent([this](uint64_t when) { _poll(when); });
+    _pendingEvent = _scheduler->addEvent([this](uint64_t when) { _applyPending(when); });
+    reset();
+}
+
+Joypad::~Joypad()
+{
+}
+
+void Joypad::reset()
+{
+    _select = 0x30;
+    _pressed = 0x00;
+    _value = 0xFF;
+    _hasPending = false;
+    _scheduler->cancel(_pendingEvent);
+    _scheduler->schedule(_pollEvent, _scheduler->now() + PollInterval);
+}
+
+bool Joypad::post(const Event& event)
+{
+    return _queue.write(&event, 1) == 1;
+}
+
+void Joypad::setPressed(Button button, bool isPressed)
+{
+    gb::Byte lines = _lines();
+    gb::Byte mask = 1 << button;
+    _pressed = isPressed ? (_pressed | mask) : (_pressed & ~mask);
+
+    // The interrupt fires when a selected line goes low
+    if (_lines() & ~lines) {
+        _interrupts->request(Interrupts::InterruptJoypad);
+    }
+}
+
+gb::Byte& Joypad::operator[](size_t address)
+{
+    assert(isValidAddress(address));
+    _value = read(address);
+    return _value;
+}
+
+bool Joypad::isValidAddress(size_t address) const
+{
+    return address == 0;
+}
+
+gb::Byte Joypad::read(size_t address)
+{
+    return 0xC0 | _select | (~_lines() & 0x0F);
+}
+
+void Joypad::write(size_t address, gb::Byte val)
+{
+    assert(isValidAddress(address));
+    _select = val & 0x30;
+}
+
+gb::Byte Joypad::_lines() const
+{
+    // A line is low when a pressed button is on a selected row
+    gb::Byte lines = 0x00;
+    if ((_select & 0x10) == 0) {
+        lines |= _pressed & 0x0F;
+    }
+    if ((_select & 0x20) == 0) {
+        lines |= _pressed >> 4;
+    }
+    return lines;
+}
+
+void Joypad::_drain(uint64_t when)
+{
+    while (!_hasPending && _queue.read(&_pending, 1) == 1) {
+        if (_pending.time <= when) {
+            setPressed(_pending.button, _pending.isPressed);
+        } else {
+            // Later events wait behind this one to keep their order
+            _hasPending = true;
+            _scheduler->schedule(_pendingEvent, _pending.time);
+        }
+    }
+}
+
+void Joypad::_poll(uint64_t when)
+{
+    _drain(when);
+    _scheduler->schedule(_pollEvent, when + PollInterval);
+}
+
+void Joypad::_applyPending(uint64_t when)
+{
+    assert(_hasPending);
+    _hasPending = false;
+    setPressed(_pending.button, _pending.isPressed);
+    _drain(when);
+}
@@ -0,0 +1,100 @@
+#ifndef GB_JOYPAD_H
+#define GB_JOYPAD_H
+
+#include <cstdint>
+
+#include "cpu/addressable.h"
+#include "cpu/interrupts.h"
+#include "cpu/scheduler.h"
+#include "util/ringbuffer.h"
+#include "util/units.h"
+
+namespace gb {
+
+/**
+ * The joypad register P1 (0xFF00).
+ *
+ * Button state is a cached bitmask, so a read is a couple of bit operations.
+ * A frontend on another thread posts timestamped changes to a lock-free
+ * queue. The queue is drained by a scheduler event, each change takes
+ * effect at its own time, and a press on a selected line raises the joypad
+ * interrupt there and then.
+ */
+class Joypad : public Addressable
+{
+public:
+    enum Button
+    {
+        ButtonRight  = 0,
+        ButtonLeft   = 1,
+        ButtonUp     = 2,
+        ButtonDown   = 3,
+        ButtonA      = 4,
+        ButtonB      = 5,
+        ButtonSelect = 6,
+        ButtonStart  = 7,
+    };
+
+    struct Event
+    {
+        // Clock cycle the change takes effect, 0 for as soon as possible
+        uint64_t time;
+        Button button;
+        bool isPressed;
+    };
+
+    // How often posted events are picked up, a little under a frame
+    static const uint64_t PollInterval = 65536;
+
+    /**
+     * Caller retains ownership of scheduler and interrupts.
+     */
+    Joypad(Scheduler* scheduler, Interrupts* interrupts);
+    ~Joypad();
+
+    void reset();
+
+    /**
+     * Queues a change from the frontend thread. Returns false if the queue is
+     * full.
+     */
+    bool post(const Event& event);
+
+    /**
+     * Changes a button straight away, from the emulation thread.
+     */
+    void setPressed(Button button, bool isPressed);
+
+    /**
+     * Pressed buttons, one bit per Button.
+     */
+    gb::Byte pressed() const { return _pressed; }
+
+    virtual gb::Byte& operator[](size_t address) override;
+    virtual bool isValidAddress(size_t address) const override;
+    virtual gb::Byte read(size_t address) override;
+    virtual void write(size_t address, gb::Byte val) override;
+
+private:
+    gb::Byte _lines() const;
+    void _drain(uint64_t when);
+    void _poll(uint64_t when);
+    void _applyPending(uint64_t when);
+
+    Scheduler* _scheduler;
+    Interrupts* _interrupts;
+    Scheduler::EventId _pollEvent;
+    Scheduler::EventId _pendingEvent;
+
+    gb::Byte _select;
+    gb::Byte _pressed;
+    gb::Byte _value;
+
+    gb::RingBuffer<Event> _queue;
+    Event _pending;
+    bool _hasPending;
+};
+
+}
+
+#endif
@@ -0,0 +1,68 @@
+#include "linkcable.h"
+using gb::LinkCable;
+
+#include <cassert>
+#include <limits>
+
+namespace {
+
+const size_t InboxSize = 64;
+
+}
+
+LinkCable::End::End() :
+    inbox(InboxSize),
+    clock(0),
+    isConnected(false)
+{
+}
+
+LinkCable::LinkCable()
+{
+}
+
+bool LinkCable::send(size_t end, const Message& message)
+{
+    assert(end < NumEnds);
+    return _ends[1 - end].inbox.write(&message, 1) == 1;
+}
+
+bool LinkCable::receive(size_t end, Message& message)
+{
+    assert(end < NumEnds);
+    return _ends[end].inbox.read(&message, 1) == 1;
+}
+
+void LinkCable::publishClock(size_t end, uint64_t cycles)
+{
+    assert(end < NumEnds);
+    _ends[end].clock.store(cycles, std::memory_order_release);
+}
+
+uint64_t LinkCable::partnerClock(size_t end) const
+{
+    assert(end < NumEnds);
+    const End& partner = _ends[1 - end];
+    if (!partner.isConnected.load(std::memory_order_acquire)) {
+        return std::numeric_limits<uint64_t>::max();
+    }
+    return partner.clock.load(std::memory_order_acquire);
+}
+
+void LinkCable::connect(size_t end)
+{
+    assert(end < NumEnds);
+    _ends[end].isConnected.store(true, std::memory_order_release);
+}
+
+void LinkCable::disconnect(size_t end)
+{
+    assert(end < NumEnds);
+    _ends[end].isConnected.store(false, std::memory_order_release);
+}
+
+bool LinkCable::isPartnerConnected(size_t end) const
+{
+    assert(end < NumEnds);
+    return _ends[1 - end].isConnected.load(std::memory_order_acquire);
+}
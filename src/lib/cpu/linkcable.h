@@ -0,0 +1,74 @@
+#ifndef GB_LINKCABLE_H
+#define GB_LINKCABLE_H
+
+#include <atomic>
+#include <cstdint>
+
+#include "util/ringbuffer.h"
+#include "util/units.h"
+
+namespace gb {
+
+/**
+ * Connects the serial ports of two emulators running on separate threads.
+ *
+ * Each end is driven by one thread only. Messages go through a lock-free
+ * queue per direction, and each end publishes its clock so the other can
+ * stay within a bounded skew of it. Ends are numbered 0 and 1.
+ */
+class LinkCable
+{
+public:
+    struct Message
+    {
+        enum Type
+        {
+            TypeStart,
+            TypeReply,
+        };
+
+        Type type;
+        gb::Byte data;
+
+        // Sender's clock when the message was sent
+        uint64_t time;
+    };
+
+    static const size_t NumEnds = 2;
+
+    LinkCable();
+
+    /**
+     * Queues message for the other end. Returns false if it's full.
+     */
+    bool send(size_t end, const Message& message);
+    bool receive(size_t end, Message& message);
+
+    void publishClock(size_t end, uint64_t cycles);
+
+    /**
+     * The other end's last published clock. Never behind any clock once it
+     * disconnected, so nobody waits for it.
+     */
+    uint64_t partnerClock(size_t end) const;
+
+    void connect(size_t end);
+    void disconnect(size_t end);
+    bool isPartnerConnected(size_t end) const;
+
+private:
+    struct End
+    {
+        End();
+
+        gb::RingBuffer<Message> inbox;
+        std::atomic<uint64_t> clock;
+        std::atomic<bool> isConnected;
+    };
+
+    End _ends[NumEnds];
+};
+
+}
+
+#endif
@@ -0,0 +1,49 @@
+#include "mappedmemory.h"
+using gb::MappedMemory;
+
+#include <cassert>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedMemory::MappedMemory(const std::string& path, size_t size) :
+    _path(path)
+{
+    assert(size > 0);
+
+    int fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        return;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && (static_cast<size_t>(st.st_size) >= size || ftruncate(fd, size) == 0)) {
+        void* mem = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (mem != MAP_FAILED) {
+            _mem = static_cast<gb::Byte*>(mem);
+            _size = size;
+        }
+    }
+
+    // The mapping keeps its own reference to the file
+    close(fd);
+}
+
+MappedMemory::~MappedMemory()
+{
+    if (_mem) {
+        flush(true);
+        munmap(_mem, _size);
+        _mem = nullptr;
+    }
+}
+
+bool MappedMemory::flush(bool wait)
+{
+    if (!_mem) {
+        return false;
+    }
+    return msync(_mem, _size, wait ? MS_SYNC : MS_ASYNC) == 0;
+}
@@ -0,0 +1,44 @@
+#ifndef GB_MAPPEDMEMORY_H
+#define GB_MAPPEDMEMORY_H
+
+#include <string>
+
+#include "cpu/memory.h"
+#include "util/units.h"
+
+namespace gb {
+
+/**
+ * Memory backed by a shared mapping of a file.
+ *
+ * Writes land in the page cache as soon as they're made, so the contents
+ * survive the process crashing. flush() asks the kernel to write back the
+ * dirty pages, only those which changed are written.
+ */
+class MappedMemory : public Memory
+{
+public:
+
+    /**
+     * Maps the first size bytes of path, creating the file or growing it with
+     * zeros if needed. Existing contents are kept.
+     */
+    MappedMemory(const std::string& path, size_t size);
+    ~MappedMemory();
+
+    bool isOpen() const { return _mem != nullptr; }
+    const std::string& path() const { return _path; }
+
+    /**
+     * Schedules write back of modified pages. When wait is set, blocks until
+     * they're on disk.
+     */
+    bool flush(bool wait = false);
+
+private:
+    std::string _path;
+};
+
+}
+
+#endif
@@ -24,7 +24,7 @@ public:
     {
     }
 
-    ~Memory()
+    virtual ~Memory()
     {
         delete[] _mem;
     }
@@ -46,8 +46,22 @@ public:
         return _size;
     }
 
+    virtual gb::Byte* data() override
+    {
+        return _mem;
+    }
+
 protected:
 
+    /**
+     * For subclasses which provide their own storage.
+     */
+    Memory() :
+        _mem(nullptr),
+        _size(0)
+    {
+    }
+
     gb::Byte* _mem;
     size_t _size;
 
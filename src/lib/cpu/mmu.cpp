@@ -1,10 +1,15 @@
 #include "mmu.h"
 using namespace gb;
 
+#include <algorithm>
 #include <cassert>
+#include <cstring>
 
-MMU::MMU()
+MMU::MMU() :
+    _watcher(nullptr),
+    _watchCount(0)
 {
+    std::fill(_pageWatches, _pageWatches + NumPages, 0);
 }
 
 MMU::~MMU()
@@ -13,24 +18,59 @@ MMU::~MMU()
 
 bool MMU::isValidAddress(size_t address) const 
 {
-    for (const MapEntry& e : _entries) {
-        if (e.localRange.contains(address)) {
-            return true;
+    return _entryIndex(address) >= 0;
+}
+
+gb::Byte& MMU::operator[](size_t address)
+{
+    if (address < 0x10000) {
+        const Page& page = _pages[address >> PageBits];
+        if (page.direct) {
+            return page.direct[address & (PageSize - 1)];
         }
     }
-    return false;
+
+    const MapEntry& e = _findEntry(address);
+    return (*e.target)[e.targetRange.min() + (address - e.localRange.min())];
 }
 
-gb::Byte& MMU::operator[](size_t address)
+gb::Byte MMU::read(size_t address)
 {
-    for (const MapEntry& e : _entries) {
-        if (e.localRange.contains(address)) {
-            size_t diff = address - e.localRange.min();
-            assert(e.target);
-            return (*e.target)[e.targetRange.min() + diff];
+    if (address < 0x10000) {
+        const Page& page = _pages[address >> PageBits];
+        if (page.direct) {
+            return page.direct[address & (PageSize - 1)];
+        }
+    }
+
+    const MapEntry& e = _findEntry(address);
+    gb::Byte val = e.target->read(e.targetRange.min() + (address - e.localRange.min()));
+    if (address < 0x10000 && (_pageWatches[address >> PageBits] & AccessRead)) {
+        _checkWatch(address, AccessRead, val);
+    }
+    return val;
+}
+
+void MMU::write(size_t address, gb::Byte val)
+{
+    if (address < 0x10000) {
+        const Page& page = _pages[address >> PageBits];
+        if (page.writeDirect) {
+            page.writeDirect[address & (PageSize - 1)] = val;
+            return;
         }
     }
-    assert(false && "MMU: unmapped memory access attempted");
+
+    const MapEntry& e = _findEntry(address);
+    if (e.writeHandler) {
+        e.writeHandler->write(address, val);
+    } else {
+        e.target->write(e.targetRange.min() + (address - e.localRange.min()), val);
+    }
+
+    if (address < 0x10000 && (_pageWatches[address >> PageBits] & AccessWrite)) {
+        _checkWatch(address, AccessWrite, val);
+    }
 }
 
 void MMU::map(Addressable* target, gb::Range targetRange, gb::Range localRange)
@@ -41,8 +81,228 @@ void MMU::map(Addressable* target, gb::Range targetRange, gb::Range localRange)
                !e.localRange.contains(localRange.max()));
     }
 #endif
+    assert(targetRange.max() - targetRange.min() == localRange.max() - localRange.min());
 
     MapEntry newEntry(target, targetRange, localRange);
     _entries.push_back(newEntry);
+    _updatePages(localRange, static_cast<int>(_entries.size() - 1));
 }
 
+void MMU::mapReadOnly(Addressable* target, gb::Range targetRange, gb::Range localRange,
+                      Addressable* writeHandler)
+{
+    assert(writeHandler);
+    map(target, targetRange, localRange);
+    _entries.back().writeHandler = writeHandler;
+    _updatePages(localRange, static_cast<int>(_entries.size() - 1));
+}
+
+void MMU::remap(Addressable* target, gb::Range targetRange, gb::Range localRange)
+{
+    assert(targetRange.max() - targetRange.min() == localRange.max() - localRange.min());
+
+    int index = _entryIndex(localRange.min());
+    assert(index >= 0 && "MMU: remap of a range which was never mapped");
+
+    MapEntry& e = _entries[index];
+    assert(e.localRange.min() == localRange.min() && e.localRange.max() == localRange.max());
+    e.target = target;
+    e.targetRange = targetRange;
+    _updatePages(localRange, index);
+}
+
+gb::Byte* MMU::directData(size_t address, size_t length)
+{
+    return _directData(address, length, false);
+}
+
+void MMU::copy(size_t dest, size_t source, size_t length)
+{
+    gb::Byte* to = _directData(dest, length, true);
+    gb::Byte* from = _directData(source, length, false);
+    if (to && from) {
+        memmove(to, from, length);
+        return;
+    }
+
+    for (size_t i = 0; i < length; ++i) {
+        write(dest + i, read(source + i));
+    }
+}
+
+void MMU::watch(size_t address, int access)
+{
+    assert(address < 0x10000);
+    if (_watches.empty()) {
+        _watches.assign(0x10000, 0);
+    }
+
+    gb::Byte& bits = _watches[address];
+    _watchCount += (bits == 0 && access != 0);
+    bits |= access;
+    _updatePageWatches(address >> PageBits);
+}
+
+void MMU::unwatch(size_t address, int access)
+{
+    assert(address < 0x10000);
+    if (_watches.empty()) {
+        return;
+    }
+
+    gb::Byte& bits = _watches[address];
+    bool wasWatched = bits != 0;
+    bits &= ~access;
+    _watchCount -= (wasWatched && bits == 0);
+    _updatePageWatches(address >> PageBits);
+}
+
+gb::Byte* MMU::_directData(size_t address, size_t length, bool forWrite)
+{
+    assert(length > 0);
+
+    // Bulk copies mustn't slip past a watch
+    if (_watchCount > 0 && address < 0x10000) {
+        size_t last = std::min<size_t>(address + length - 1, 0xFFFF);
+        for (size_t p = address >> PageBits; p <= (last >> PageBits); ++p) {
+            if (_pageWatches[p]) {
+                return nullptr;
+            }
+        }
+    }
+
+    // Mappings are contiguous, so if both ends belong to the same one the
+    // whole range does
+    int first = _entryIndex(address);
+    if (first < 0 || first != _entryIndex(address + length - 1)) {
+        return nullptr;
+    }
+
+    const MapEntry& e = _entries[first];
+    gb::Byte* data = e.target->data();
+    if (!data || (forWrite && e.writeHandler)) {
+        return nullptr;
+    }
+    return data + e.targetRange.min() + (address - e.localRange.min());
+}
+
+int MMU::_entryIndex(size_t address) const
+{
+    if (address < 0x10000) {
+        const Page& page = _pages[address >> PageBits];
+        if (page.entry >= 0) {
+            return page.entry;
+        }
+        if (page.entries.empty()) {
+            return -1;
+        }
+        return page.entries[address & (PageSize - 1)];
+    }
+
+    for (size_t i = 0; i < _entries.size(); ++i) {
+        if (_entries[i].localRange.contains(address)) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+const MMU::MapEntry& MMU::_findEntry(size_t address) const
+{
+    int index = _entryIndex(address);
+    assert(index >= 0 && "MMU: unmapped memory access attempted");
+
+    const MapEntry& e = _entries[index];
+    assert(e.target);
+    return e;
+}
+
+void MMU::_updatePages(const gb::Range& localRange, int entry)
+{
+    if (localRange.min() >= 0x10000) {
+        return;
+    }
+
+    size_t firstPage = localRange.min() >> PageBits;
+    size_t lastPage = std::min<size_t>(localRange.max(), 0xFFFF) >> PageBits;
+
+    for (size_t p = firstPage; p <= lastPage; ++p) {
+        Page& page = _pages[p];
+        gb::Range pageRange(p << PageBits, ((p + 1) << PageBits) - 1);
+
+        if (entry >= 0 && localRange.min() <= pageRange.min() && localRange.max() >= pageRange.max()) {
+            // Owned entirely by the given mapping, no need to look at the others
+            _setPageEntry(page, pageRange, entry);
+            continue;
+        }
+
+        page = Page();
+
+        for (size_t i = 0; i < _entries.size(); ++i) {
+            const MapEntry& e = _entries[i];
+            if (e.localRange.max() < pageRange.min() || e.localRange.min() > pageRange.max()) {
+                continue;
+            }
+
+            if (e.localRange.min() <= pageRange.min() && e.localRange.max() >= pageRange.max()) {
+                _setPageEntry(page, pageRange, static_cast<int>(i));
+                break;
+            }
+
+            if (page.entries.empty()) {
+                page.entries.assign(PageSize, -1);
+            }
+            size_t from = std::max(e.localRange.min(), pageRange.min());
+            size_t to = std::min(e.localRange.max(), pageRange.max());
+            for (size_t a = from; a <= to; ++a) {
+                page.entries[a & (PageSize - 1)] = static_cast<int>(i);
+            }
+        }
+    }
+}
+
+void MMU::_setPageEntry(Page& page, const gb::Range& pageRange, int entry)
+{
+    const MapEntry& e = _entries[entry];
+
+    page.entry = entry;
+    page.entries.clear();
+    page.direct = nullptr;
+    page.writeDirect = nullptr;
+
+    gb::Byte* data = e.target ? e.target->data() : nullptr;
+    if (data) {
+        gb::Byte* direct = data + e.targetRange.min() + (pageRange.min() - e.localRange.min());
+        gb::Byte watches = _pageWatches[pageRange.min() >> PageBits];
+        if (!(watches & AccessRead)) {
+            page.direct = direct;
+        }
+        if (!e.writeHandler && !(watches & AccessWrite)) {
+            page.writeDirect = direct;
+        }
+    }
+}
+
+void MMU::_updatePageWatches(size_t page)
+{
+    gb::Byte watches = 0;
+    for (size_t i = 0; i < PageSize; ++i) {
+        watches |= _watches[(page << PageBits) + i];
+    }
+    if (watches == _pageWatches[page]) {
+        return;
+    }
+
+    _pageWatches[page] = watches;
+    if (_pages[page].entry >= 0) {
+        gb::Range pageRange(page << PageBits, ((page + 1) << PageBits) - 1);
+        _setPageEntry(_pages[page], pageRange, _pages[page].entry);
+    }
+}
+
+void MMU::_checkWatch(size_t address, Access access, gb::Byte val)
+{
+    if (_watcher && (_watches[address] & access)) {
+        _watcher->onWatch(address, access, val);
+    }
+}
@@ -12,16 +12,47 @@ namespace gb {
 /**
  * A MMU (memory mapper unit) provides a virtual memory abstraction over multiple addressable units.
  *
- * This takes the form of an address mapping range.
+ * This takes the form of an address mapping range. Lookups in the 16 bit
+ * address space go through a table of 256 byte pages. A page owned by a
+ * single target with plain backing storage (see Addressable::data()) is
+ * accessed directly, anything else is an I/O handler page dispatched to its
+ * target's read() and write().
+ *
+ * Watched addresses are found the same way. A page holding a watch loses
+ * its direct pointers, so accesses to it take the handler path and are
+ * reported to the Watcher. Pages without one are untouched.
  */
 class MMU : public Addressable
 {
 public:
+    static const size_t PageBits = 8;
+    static const size_t PageSize = 1 << PageBits;
+    static const size_t NumPages = 0x10000 >> PageBits;
+
+    enum Access
+    {
+        AccessRead  = 1 << 0,
+        AccessWrite = 1 << 1,
+    };
+
+    /**
+     * Told about emulated reads and writes of watched addresses, after the
+     * access.
+     */
+    class Watcher
+    {
+    public:
+        virtual ~Watcher() { }
+        virtual void onWatch(size_t address, Access access, gb::Byte val) = 0;
+    };
+
     MMU();
     ~MMU();
 
     virtual bool isValidAddress(size_t address) const override;
     virtual gb::Byte& operator[](size_t address) override;
+    virtual gb::Byte read(size_t address) override;
+    virtual void write(size_t address, gb::Byte val) override;
 
     /**
      * Caller retains ownership of target.
@@ -31,24 +62,99 @@ public:
      */
     void map(Addressable* target, gb::Range targetRange, gb::Range localRange);
 
+    /**
+     * Like map(), but writes go to writeHandler at their local address
+     * instead of to target. Used for ROM, where writes program the bank
+     * controller. Caller retains ownership of target and writeHandler.
+     */
+    void mapReadOnly(Addressable* target, gb::Range targetRange, gb::Range localRange,
+                     Addressable* writeHandler);
+
+    /**
+     * Points an existing mapping of exactly localRange at a new target, any
+     * write handler is kept. Only the page entries covering localRange are
+     * updated, nothing is copied.
+     */
+    void remap(Addressable* target, gb::Range targetRange, gb::Range localRange);
+
+    /**
+     * Pointer to length bytes of plain memory backing address onwards for
+     * reading, or nullptr if the range crosses a handler page or separate
+     * mappings.
+     */
+    gb::Byte* directData(size_t address, size_t length);
+
+    /**
+     * Copies length bytes from source to dest. Runs as a single memcpy when
+     * both ranges are directly mapped, byte by byte through read() and
+     * write() otherwise.
+     */
+    void copy(size_t dest, size_t source, size_t length);
+
+    /**
+     * Caller retains ownership of watcher.
+     */
+    void setWatcher(Watcher* watcher) { _watcher = watcher; }
+
+    /**
+     * Adds or removes the Access bits in access for address.
+     */
+    void watch(size_t address, int access);
+    void unwatch(size_t address, int access);
+    bool hasWatches() const { return _watchCount > 0; }
+
 private:
     struct MapEntry
     {
         MapEntry(Addressable* target, const gb::Range& targetRange, const gb::Range& localRange) : 
             target(target),
             targetRange(targetRange),
-            localRange(localRange)
+            localRange(localRange),
+            writeHandler(nullptr)
         {
         }
 
         Addressable* target;
         gb::Range targetRange;   
         gb::Range localRange;   
+        Addressable* writeHandler;
     };
+
+    struct Page
+    {
+        Page() : direct(nullptr), writeDirect(nullptr), entry(-1) { }
+
+        // Set when the whole page is plain memory of a single mapping, for
+        // reads and for writes respectively
+        gb::Byte* direct;
+        gb::Byte* writeDirect;
+
+        // Mapping owning the whole page, or -1
+        int entry;
+
+        // Mapping of each address when the page is shared, -1 if unmapped
+        std::vector<int> entries;
+    };
+
     std::vector<MapEntry> _entries;
+    Page _pages[NumPages];
+
+    // Access bits watched for each address, allocated on the first watch,
+    // and their union over each page
+    Watcher* _watcher;
+    std::vector<gb::Byte> _watches;
+    gb::Byte _pageWatches[NumPages];
+    size_t _watchCount;
+
+    gb::Byte* _directData(size_t address, size_t length, bool forWrite);
+    int _entryIndex(size_t address) const;
+    const MapEntry& _findEntry(size_t address) const;
+    void _updatePages(const gb::Range& localRange, int entry);
+    void _setPageEntry(Page& page, const gb::Range& pageRange, int entry);
+    void _updatePageWatches(size_t page);
+    void _checkWatch(size_t address, Access access, gb::Byte val);
 };
 
 }
 
 #endif
-
@@ -0,0 +1,42 @@
+#ifndef GB_OPENBUS_H
+#define GB_OPENBUS_H
+
+#include "cpu/addressable.h"
+#include "util/units.h"
+
+namespace gb {
+
+/**
+ * Stands in for memory which is not connected or currently inaccessible.
+ * Every address reads as 0xFF and writes are ignored.
+ */
+class OpenBus : public Addressable
+{
+public:
+    virtual gb::Byte& operator[](size_t address) override
+    {
+        _value = 0xFF;
+        return _value;
+    }
+
+    virtual bool isValidAddress(size_t address) const override
+    {
+        return true;
+    }
+
+    virtual gb::Byte read(size_t address) override
+    {
+        return 0xFF;
+    }
+
+    virtual void write(size_t address, gb::Byte val) override
+    {
+    }
+
+private:
+    gb::Byte _value;
+};
+
+}
+
+#endif
@@ -0,0 +1,102 @@
+#include "profiler.h"
+using gb::Profiler;
+
+#include <algorithm>
+#include <iomanip>
+#include <numeric>
+#include <sstream>
+
+Profiler::Profiler() :
+    _opcodeCounts(NumOpcodes, 0),
+    _opcodeCycles(NumOpcodes, 0),
+    _pcCounts(0x10000, 0),
+    _pcCycles(0x10000, 0)
+{
+}
+
+uint64_t Profiler::instructions() const
+{
+    return std::accumulate(_opcodeCounts.begin(), _opcodeCounts.end(), uint64_t(0));
+}
+
+uint64_t Profiler::cycles() const
+{
+    return std::accumulate(_opcodeCycles.begin(), _opcodeCycles.end(), uint64_t(0));
+}
+
+std::string Profiler::opcodeName(size_t opcode)
+{
+    std::stringstream ss;
+    if (opcode >= CbOpcodes) {
+        ss << "cb ";
+    }
+    ss << std::hex << std::setfill('0') << std::setw(2) << (opcode & 0xFF);
+    return ss.str();
+}
+
+void Profiler::writeReport(std::ostream& out, size_t top) const
+{
+    double total = std::max<uint64_t>(cycles(), 1);
+    std::ios_base::fmtflags flags = out.flags();
+
+    out << "Opcodes" << std::endl;
+    out << "  opcode          count         cycles       %" << std::endl;
+    std::vector<size_t> opcodes = _sorted(_opcodeCycles);
+    for (size_t i = 0; i < std::min(top, opcodes.size()); ++i) {
+        size_t op = opcodes[i];
+        out << "  " << std::left << std::setw(6) << opcodeName(op) << std::right
+            << std::setw(15) << _opcodeCounts[op] << std::setw(15) << _opcodeCycles[op]
+            << std::fixed << std::setprecision(2) << std::setw(8) << 100*_opcodeCycles[op]/total
+            << std::endl;
+    }
+
+    out << "PCs" << std::endl;
+    out << "  pc              count         cycles       %" << std::endl;
+    std::vector<size_t> pcs = _sorted(_pcCycles);
+    for (size_t i = 0; i < std::min(top, pcs.size()); ++i) {
+        size_t pc = pcs[i];
+        out << "  " << std::hex << std::setfill('0') << std::setw(4) << pc << std::dec << std::setfill(' ')
+            << "  " << std::setw(15) << _pcCounts[pc] << std::setw(15) << _pcCycles[pc]
+            << std::fixed << std::setprecision(2) << std::setw(8) << 100*_pcCycles[pc]/total
+            << std::endl;
+    }
+    out.flags(flags);
+}
+
+void Profiler::writeJson(std::ostream& out) const
+{
+    out << "{\n  \"instructions\": " << instructions() << ",\n  \"cycles\": " << cycles() << ",\n";
+
+    out << "  \"opcodes\": [";
+    std::vector<size_t> opcodes = _sorted(_opcodeCycles);
+    for (size_t i = 0; i < opcodes.size(); ++i) {
+        size_t op = opcodes[i];
+        out << (i ? ",\n" : "\n") << "    {\"opcode\": \"" << opcodeName(op) << "\", \"count\": "
+            << _opcodeCounts[op] << ", \"cycles\": " << _opcodeCycles[op] << "}";
+    }
+    out << "\n  ],\n";
+
+    out << "  \"pcs\": [";
+    std::vector<size_t> pcs = _sorted(_pcCycles);
+    for (size_t i = 0; i < pcs.size(); ++i) {
+        size_t pc = pcs[i];
+        out << (i ? ",\n" : "\n") << "    {\"pc\": " << pc << ", \"count\": " << _pcCounts[pc]
+            << ", \"cycles\": " << _pcCycles[pc] << "}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+std::vector<size_t> Profiler::_sorted(const std::vector<uint64_t>& cycles) const
+{
+    // Only what actually ran, most cycles first
+    std::vector<size_t> indices;
+    for (size_t i = 0; i < cycles.size(); ++i) {
+        if (cycles[i] > 0) {
+            indices.push_back(i);
+        }
+    }
+    std::stable_sort(indices.begin(), indices.end(), [&cycles](size_t a, size_t b) {
+        return cycles[a] > cycles[b];
+    });
+    return indices;
+}
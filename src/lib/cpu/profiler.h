@@ -0,0 +1,82 @@
+#ifndef GB_PROFILER_H
+#define GB_PROFILER_H
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "util/units.h"
+
+namespace gb {
+
+/**
+ * Whether the Cpu counts into its Profiler. Profiling is compiled in with
+ * GB_PROFILE, without it the Cpu has no profiling code at all.
+ */
+#ifdef GB_PROFILE
+const bool IsProfileEnabled = true;
+#else
+const bool IsProfileEnabled = false;
+#endif
+
+/**
+ * Execution counts and cycles for every opcode and every PC.
+ *
+ * Counters are plain arrays, main opcodes at 0x000-0x0FF and CB prefixed
+ * ones at 0x100-0x1FF, bumped once per instruction.
+ */
+class Profiler
+{
+public:
+    static const size_t NumOpcodes = 0x200;
+    static const size_t CbOpcodes = 0x100;
+
+    Profiler();
+
+    /**
+     * Counts one instruction at pc, which took cycles.
+     */
+    void record(gb::Word pc, size_t opcode, uint64_t cycles)
+    {
+        ++_opcodeCounts[opcode];
+        _opcodeCycles[opcode] += cycles;
+        ++_pcCounts[pc];
+        _pcCycles[pc] += cycles;
+    }
+
+    uint64_t opcodeCount(size_t opcode) const   { return _opcodeCounts[opcode]; }
+    uint64_t opcodeCycles(size_t opcode) const  { return _opcodeCycles[opcode]; }
+    uint64_t pcCount(gb::Word pc) const         { return _pcCounts[pc]; }
+    uint64_t pcCycles(gb::Word pc) const        { return _pcCycles[pc]; }
+
+    uint64_t instructions() const;
+    uint64_t cycles() const;
+
+    /**
+     * Opcode as text, "3c" or "cb 11".
+     */
+    static std::string opcodeName(size_t opcode);
+
+    /**
+     * Writes the top opcodes and PCs, by cycles spent, as a table.
+     */
+    void writeReport(std::ostream& out, size_t top) const;
+
+    /**
+     * Writes every opcode and PC which ran as JSON, sorted by cycles spent.
+     */
+    void writeJson(std::ostream& out) const;
+
+private:
+    std::vector<size_t> _sorted(const std::vector<uint64_t>& cycles) const;
+
+    std::vector<uint64_t> _opcodeCounts;
+    std::vector<uint64_t> _opcodeCycles;
+    std::vector<uint64_t> _pcCounts;
+    std::vector<uint64_t> _pcCycles;
+};
+
+}
+
+#endif
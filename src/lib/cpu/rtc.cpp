@@ -0,0 +1,184 @@
+#include "rtc.h"
+using gb::Rtc;
+
+#include <cassert>
+#include <ctime>
+
+namespace {
+
+const uint64_t SecondsPerDay = 24*60*60;
+const uint64_t DayCounterSize = 512;
+
+// Bits which exist in each register
+const gb::Byte RegisterMasks[Rtc::NumRegisters] = {0x3F, 0x3F, 0x1F, 0xFF, 0xC1};
+
+void putLe(gb::Byte* out, uint64_t val, size_t bytes)
+{
+    for (size_t i = 0; i < bytes; ++i) {
+        out[i] = static_cast<gb::Byte>(val >> (8*i));
+    }
+}
+
+uint64_t getLe(const gb::Byte* in, size_t bytes)
+{
+    uint64_t val = 0;
+    for (size_t i = 0; i < bytes; ++i) {
+        val |= static_cast<uint64_t>(in[i]) << (8*i);
+    }
+    return val;
+}
+
+}
+
+Rtc::Rtc() :
+    _scheduler(nullptr),
+    _isRealTime(false),
+    _counter(0),
+    _baseCycles(0),
+    _baseTime(0),
+    _isHalted(false),
+    _hasCarry(false),
+    _selected(RegSeconds)
+{
+    for (gb::Byte& reg : _latched) {
+        reg = 0x00;
+    }
+    _resetBase();
+}
+
+Rtc::~Rtc()
+{
+}
+
+void Rtc::setScheduler(Scheduler* scheduler)
+{
+    _sync();
+    _scheduler = scheduler;
+    _resetBase();
+}
+
+void Rtc::setRealTime(bool isRealTime)
+{
+    _sync();
+    _isRealTime = isRealTime;
+    _resetBase();
+}
+
+void Rtc::latch()
+{
+    _sync();
+    _toRegisters(_latched);
+}
+
+void Rtc::save(gb::Byte* out)
+{
+    _sync();
+
+    gb::Byte regs[NumRegisters];
+    _toRegisters(regs);
+    for (size_t i = 0; i < NumRegisters; ++i) {
+        putLe(out + 4*i, regs[i], 4);
+        putLe(out + 4*(NumRegisters + i), _latched[i], 4);
+    }
+    putLe(out + 8*NumRegisters, static_cast<uint64_t>(std::time(nullptr)), 8);
+}
+
+void Rtc::load(const gb::Byte* in)
+{
+    gb::Byte regs[NumRegisters];
+    for (size_t i = 0; i < NumRegisters; ++i) {
+        regs[i] = getLe(in + 4*i, 4) & RegisterMasks[i];
+        _latched[i] = getLe(in + 4*(NumRegisters + i), 4) & RegisterMasks[i];
+    }
+    _fromRegisters(regs);
+    _resetBase();
+
+    // Catch up on the time the emulator wasn't running. A zero timestamp is
+    // a fresh save.
+    int64_t savedTime = static_cast<int64_t>(getLe(in + 8*NumRegisters, 8));
+    if (_isRealTime && !_isHalted && savedTime > 0 && savedTime < _baseTime) {
+        _counter += _baseTime - savedTime;
+        _sync();
+    }
+}
+
+gb::Byte& Rtc::operator[](size_t address)
+{
+    assert(isValidAddress(address));
+    return _latched[_selected];
+}
+
+bool Rtc::isValidAddress(size_t address) const
+{
+    return address < 0x2000;
+}
+
+gb::Byte Rtc::read(size_t address)
+{
+    assert(isValidAddress(address));
+    return _latched[_selected];
+}
+
+void Rtc::write(size_t address, gb::Byte val)
+{
+    assert(isValidAddress(address));
+
+    _sync();
+
+    gb::Byte regs[NumRegisters];
+    _toRegisters(regs);
+    regs[_selected] = val & RegisterMasks[_selected];
+    _latched[_selected] = regs[_selected];
+
+    _fromRegisters(regs);
+    _resetBase();
+}
+
+void Rtc::_sync()
+{
+    if (!_isHalted) {
+        uint64_t elapsed = 0;
+        if (_isRealTime) {
+            int64_t now = static_cast<int64_t>(std::time(nullptr));
+            elapsed = now > _baseTime ? now - _baseTime : 0;
+            _baseTime += elapsed;
+        } else if (_scheduler) {
+            elapsed = (_scheduler->now() - _baseCycles)/CyclesPerSecond;
+            _baseCycles += elapsed*CyclesPerSecond;
+        }
+        _counter += elapsed;
+    }
+
+    // The day counter overflows into a sticky carry bit
+    uint64_t days = _counter/SecondsPerDay;
+    if (days >= DayCounterSize) {
+        _hasCarry = true;
+        _counter -= (days - days % DayCounterSize)*SecondsPerDay;
+    }
+}
+
+void Rtc::_resetBase()
+{
+    _baseCycles = _scheduler ? _scheduler->now() : 0;
+    _baseTime = static_cast<int64_t>(std::time(nullptr));
+}
+
+void Rtc::_toRegisters(gb::Byte* regs) const
+{
+    uint64_t days = _counter/SecondsPerDay;
+    regs[RegSeconds] = _counter % 60;
+    regs[RegMinutes] = (_counter/60) % 60;
+    regs[RegHours] = (_counter/3600) % 24;
+    regs[RegDaysLow] = days & 0xFF;
+    regs[RegDaysHigh] = ((days >> 8) & DaysHighDay8) |
+                        (_isHalted ? DaysHighHalt : 0) |
+                        (_hasCarry ? DaysHighCarry : 0);
+}
+
+void Rtc::_fromRegisters(const gb::Byte* regs)
+{
+    uint64_t days = regs[RegDaysLow] | ((regs[RegDaysHigh] & DaysHighDay8) << 8);
+    _counter = regs[RegSeconds] + regs[RegMinutes]*60 + regs[RegHours]*3600 + days*SecondsPerDay;
+    _isHalted = (regs[RegDaysHigh] & DaysHighHalt) != 0;
+    _hasCarry = (regs[RegDaysHigh] & DaysHighCarry) != 0;
+}
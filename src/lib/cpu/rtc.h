@@ -0,0 +1,100 @@
+#ifndef GB_RTC_H
+#define GB_RTC_H
+
+#include <cstdint>
+
+#include "cpu/addressable.h"
+#include "cpu/scheduler.h"
+#include "util/units.h"
+
+namespace gb {
+
+/**
+ * The MBC3 real time clock.
+ *
+ * Nothing ticks. The clock is a seconds counter at a base point in time, and
+ * is only brought up to date when the game latches or writes it. Time comes
+ * from the scheduler clock, or from the host clock in real time mode so that
+ * it keeps running while the emulator is closed.
+ *
+ * The selected register is visible at every address of the 0xA000 window.
+ */
+class Rtc : public Addressable
+{
+public:
+    enum Register
+    {
+        RegSeconds  = 0,
+        RegMinutes  = 1,
+        RegHours    = 2,
+        RegDaysLow  = 3,
+        RegDaysHigh = 4,
+        NumRegisters,
+    };
+
+    enum DaysHighBit
+    {
+        DaysHighDay8  = 0x01,
+        DaysHighHalt  = 0x40,
+        DaysHighCarry = 0x80,
+    };
+
+    static const uint64_t CyclesPerSecond = 4194304;
+
+    /**
+     * Bytes used by save() and load(): the current and latched registers as
+     * 32-bit values followed by a 64-bit host timestamp, as other emulators
+     * append to .sav files.
+     */
+    static const size_t SaveSize = 48;
+
+    Rtc();
+    ~Rtc();
+
+    /**
+     * Caller retains ownership of scheduler. Without one, emulated time
+     * doesn't pass.
+     */
+    void setScheduler(Scheduler* scheduler);
+
+    bool isRealTime() const { return _isRealTime; }
+    void setRealTime(bool isRealTime);
+
+    void select(Register reg) { _selected = reg; }
+
+    /**
+     * Copies the current time into the registers seen by the game.
+     */
+    void latch();
+
+    void save(gb::Byte* out);
+    void load(const gb::Byte* in);
+
+    virtual gb::Byte& operator[](size_t address) override;
+    virtual bool isValidAddress(size_t address) const override;
+    virtual gb::Byte read(size_t address) override;
+    virtual void write(size_t address, gb::Byte val) override;
+
+private:
+    void _sync();
+    void _resetBase();
+    void _toRegisters(gb::Byte* regs) const;
+    void _fromRegisters(const gb::Byte* regs);
+
+    Scheduler* _scheduler;
+    bool _isRealTime;
+
+    // Counter value at the base time, in seconds
+    uint64_t _counter;
+    uint64_t _baseCycles;
+    int64_t _baseTime;
+    bool _isHalted;
+    bool _hasCarry;
+
+    Register _selected;
+    gb::Byte _latched[NumRegisters];
+};
+
+}
+
+#endif
@@ -0,0 +1,90 @@
+#include "sampler.h"
+using gb::Sampler;
+
+#include <cassert>
+
+#include "cpu/cartridge.h"
+#include "cpu/cpu.h"
+
+Sampler::Sampler(Cpu* cpu, Scheduler* scheduler, uint64_t interval) :
+    _cpu(cpu),
+    _scheduler(scheduler),
+    _cartridge(nullptr),
+    _interval(interval),
+    _samples(0)
+{
+    assert(_cpu && _scheduler && _interval > 0);
+    _frames.reserve(MaxDepth);
+    _sampleEvent = _scheduler->addEvent([this](uint64_t when) { _sample(when); });
+    _scheduler->schedule(_sampleEvent, _scheduler->now() + _interval);
+}
+
+Sampler::~Sampler()
+{
+    _scheduler->cancel(_sampleEvent);
+}
+
+void Sampler::onCall(gb::Word target, gb::Word sp)
+{
+    while (!_frames.empty() && _frames.back().sp <= sp) {
+        _frames.pop_back();
+    }
+    if (_frames.size() < MaxDepth) {
+        _frames.push_back(Frame{_address(target), sp});
+    }
+}
+
+void Sampler::onReturn(gb::Word sp)
+{
+    while (!_frames.empty() && _frames.back().sp <= sp) {
+        _frames.pop_back();
+    }
+}
+
+std::vector<uint32_t> Sampler::callStack() const
+{
+    std::vector<uint32_t> stack;
+    stack.reserve(_frames.size());
+    for (const Frame& frame : _frames) {
+        stack.push_back(frame.address);
+    }
+    return stack;
+}
+
+void Sampler::writeFolded(std::ostream& out, const SymbolTable& symbols) const
+{
+    // Different addresses can fold to the same names
+    std::map<std::string, uint64_t> folded;
+    for (const auto& entry : _stacks) {
+        std::string line;
+        for (uint32_t address : entry.first) {
+            if (!line.empty()) {
+                line += ';';
+            }
+            line += symbols.name(address >> 16, address & 0xFFFF);
+        }
+        folded[line] += entry.second;
+    }
+
+    for (const auto& entry : folded) {
+        out << entry.first << " " << entry.second << "\n";
+    }
+}
+
+uint32_t Sampler::_address(gb::Word address) const
+{
+    if (_cartridge && address >= 0x4000 && address < 0x8000) {
+        return static_cast<uint32_t>((_cartridge->romBank() << 16) | address);
+    }
+    return address;
+}
+
+void Sampler::_sample(uint64_t when)
+{
+    std::vector<uint32_t> stack = callStack();
+    stack.push_back(_address(_cpu->registers().PC));
+    ++_stacks[stack];
+    ++_samples;
+
+    _scheduler->schedule(_sampleEvent, when + _interval);
+}
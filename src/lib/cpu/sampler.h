@@ -0,0 +1,97 @@
+#ifndef GB_SAMPLER_H
+#define GB_SAMPLER_H
+
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <vector>
+
+#include "cpu/scheduler.h"
+#include "util/symbols.h"
+#include "util/units.h"
+
+namespace gb {
+
+class Cartridge;
+class Cpu;
+
+/**
+ * Sampling profiler, every interval clock cycles records the PC along with
+ * the guest call stack.
+ *
+ * The call stack is a shadow stack kept from the Cpu's calls and returns
+ * (CALL, RST, interrupts, RET, RETI), so the Cpu only feeds it when
+ * profiling was compiled in (see IsProfileEnabled). Each frame remembers the
+ * SP its return address was pushed to: a return pops every frame at or
+ * below its SP and a call first drops frames the stack pointer has already
+ * moved above, which keeps the stack in step with code that jumps out of
+ * functions or resets SP.
+ *
+ * Addresses are kept with the ROM bank mapped when they were seen, for
+ * symbolizing against an RGBDS .sym file.
+ */
+class Sampler
+{
+public:
+    static const size_t MaxDepth = 64;
+
+    /**
+     * Samples start one interval from now. Caller retains ownership of cpu
+     * and scheduler.
+     */
+    Sampler(Cpu* cpu, Scheduler* scheduler, uint64_t interval);
+    ~Sampler();
+
+    /*
+     * Optional. When set addresses in 0x4000-0x7FFF are tagged with the ROM
+     * bank mapped there. Caller retains ownership of cartridge.
+     */
+    void setCartridge(Cartridge* cartridge) { _cartridge = cartridge; }
+
+    void onCall(gb::Word target, gb::Word sp);
+    void onReturn(gb::Word sp);
+
+    /**
+     * Call targets on the shadow stack, outermost first, as bank << 16 |
+     * address.
+     */
+    std::vector<uint32_t> callStack() const;
+
+    uint64_t samples() const { return _samples; }
+
+    /**
+     * Sample counts by stack, the call targets followed by the sampled PC.
+     */
+    const std::map<std::vector<uint32_t>, uint64_t>& stacks() const { return _stacks; }
+
+    /**
+     * Writes the samples as folded stacks, "outer;inner;leaf count" per
+     * line, for flamegraph.pl and compatible tools. Addresses are named
+     * with symbols.
+     */
+    void writeFolded(std::ostream& out, const SymbolTable& symbols) const;
+
+private:
+    struct Frame
+    {
+        uint32_t address;
+        gb::Word sp;
+    };
+
+    uint32_t _address(gb::Word address) const;
+    void _sample(uint64_t when);
+
+    Cpu* _cpu;
+    Scheduler* _scheduler;
+    Cartridge* _cartridge;
+    Scheduler::EventId _sampleEvent;
+    uint64_t _interval;
+
+    std::vector<Frame> _frames;
+    std::map<std::vector<uint32_t>, uint64_t> _stacks;
+    uint64_t _samples;
+};
+
+}
+
+#endif
@@ -0,0 +1,75 @@
+#include "scheduler.h"
+using gb::Scheduler;
+
+#include <cassert>
+#include <limits>
+
+const uint64_t Scheduler::Never = std::numeric_limits<uint64_t>::max();
+
+Scheduler::Scheduler() :
+    _now(0),
+    _nextEventTime(Never)
+{
+}
+
+Scheduler::EventId Scheduler::addEvent(const Callback& callback)
+{
+    Event event = {callback, Never};
+    _events.push_back(event);
+    return static_cast<EventId>(_events.size() - 1);
+}
+
+void Scheduler::schedule(EventId event, uint64_t when)
+{
+    assert(event >= 0 && event < static_cast<EventId>(_events.size()));
+    _events[event].when = when;
+    _updateNextEventTime();
+}
+
+void Scheduler::cancel(EventId event)
+{
+    assert(event >= 0 && event < static_cast<EventId>(_events.size()));
+    _events[event].when = Never;
+    _updateNextEventTime();
+}
+
+bool Scheduler::isScheduled(EventId event) const
+{
+    assert(event >= 0 && event < static_cast<EventId>(_events.size()));
+    return _events[event].when != Never;
+}
+
+void Scheduler::reset()
+{
+    _now = 0;
+    for (Event& e : _events) {
+        e.when = Never;
+    }
+    _nextEventTime = Never;
+}
+
+void Scheduler::_runDueEvents()
+{
+    while (_nextEventTime <= _now) {
+        // Run the earliest due event, it may reschedule itself or others
+        for (Event& e : _events) {
+            if (e.when == _nextEventTime) {
+                uint64_t when = e.when;
+                e.when = Never;
+                e.callback(when);
+                break;
+            }
+        }
+        _updateNextEventTime();
+    }
+}
+
+void Scheduler::_updateNextEventTime()
+{
+    _nextEventTime = Never;
+    for (const Event& e : _events) {
+        if (e.when < _nextEventTime) {
+            _nextEventTime = e.when;
+        }
+    }
+}
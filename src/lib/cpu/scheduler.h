@@ -0,0 +1,81 @@
+#ifndef GB_SCHEDULER_H
+#define GB_SCHEDULER_H
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace gb {
+
+/**
+ * Runs callbacks at future points of the emulated clock.
+ *
+ * Peripherals register an event once and then schedule it for an absolute
+ * cycle count, so nothing needs to be ticked per instruction. Advancing the
+ * clock costs a single comparison unless an event is due.
+ */
+class Scheduler
+{
+public:
+    typedef int EventId;
+
+    /**
+     * Called with the cycle count the event was scheduled for, which may be
+     * slightly earlier than now().
+     */
+    typedef std::function<void(uint64_t when)> Callback;
+
+    static const uint64_t Never;
+
+    Scheduler();
+
+    uint64_t now() const { return _now; }
+    uint64_t nextEventTime() const { return _nextEventTime; }
+
+    /**
+     * Registers a new, unscheduled event.
+     */
+    EventId addEvent(const Callback& callback);
+
+    /**
+     * Schedules event at the absolute cycle count when, replacing any previous
+     * schedule of the same event.
+     */
+    void schedule(EventId event, uint64_t when);
+    void cancel(EventId event);
+    bool isScheduled(EventId event) const;
+
+    /**
+     * Moves the clock forward, running every event which became due in order.
+     */
+    void advanceTo(uint64_t cycles)
+    {
+        _now = cycles;
+        if (cycles >= _nextEventTime) {
+            _runDueEvents();
+        }
+    }
+
+    /**
+     * Resets the clock to zero and cancels all events.
+     */
+    void reset();
+
+private:
+    struct Event
+    {
+        Callback callback;
+        uint64_t when;
+    };
+
+    void _runDueEvents();
+    void _updateNextEventTime();
+
+    std::vector<Event> _events;
+    uint64_t _now;
+    uint64_t _nextEventTime;
+};
+
+}
+
+#endif
@@ -0,0 +1,185 @@
+#include "serial.h"
+using gb::Serial;
+
+#include <algorithm>
+#include <cassert>
+#include <thread>
+
+Serial::Serial(Scheduler* scheduler, Interrupts* interrupts) :
+    _scheduler(scheduler),
+    _interrupts(interrupts),
+    _cable(nullptr),
+    _end(0)
+{
+    assert(_scheduler && _interrupts);
+    _masterEvent = _scheduler->addEvent([this](uint64_t when) { _finishMaster(when); });
+    _slaveEvent = _scheduler->addEvent([this](uint64_t) { _finish(_slaveReceived); });
+    _answerEvent = _scheduler->addEvent([this](uint64_t) { _answer(); });
+    _syncEvent = _scheduler->addEvent([this](uint64_t when) { _sync(when); });
+    reset();
+}
+
+Serial::~Serial()
+{
+    disconnect();
+}
+
+void Serial::reset()
+{
+    _sb = 0x00;
+    _sc = 0x00;
+    _speedShift = 0;
+    _output.clear();
+    _isAwaitingReply = false;
+    _reply = 0xFF;
+    _replyTime = 0;
+    _slaveReceived = 0xFF;
+    _scheduler->cancel(_masterEvent);
+    _scheduler->cancel(_slaveEvent);
+    _scheduler->cancel(_answerEvent);
+}
+
+void Serial::connect(LinkCable* cable, size_t end)
+{
+    assert(cable && !_cable);
+    _cable = cable;
+    _end = end;
+    _cable->publishClock(_end, _scheduler->now());
+    _cable->connect(_end);
+    _scheduler->schedule(_syncEvent, _scheduler->now() + SyncQuantum);
+}
+
+void Serial::disconnect()
+{
+    if (!_cable) {
+        return;
+    }
+
+    _cable->disconnect(_end);
+    _cable = nullptr;
+    _scheduler->cancel(_syncEvent);
+}
+
+gb::Byte& Serial::operator[](size_t address)
+{
+    assert(isValidAddress(address));
+    return address == RegSB ? _sb : _sc;
+}
+
+bool Serial::isValidAddress(size_t address) const
+{
+    return address <= RegSC;
+}
+
+gb::Byte Serial::read(size_t address)
+{
+    assert(isValidAddress(address));
+    return address == RegSB ? _sb : (_sc | 0x7E);
+}
+
+void Serial::write(size_t address, gb::Byte val)
+{
+    assert(isValidAddress(address));
+
+    if (address == RegSB) {
+        _sb = val;
+        return;
+    }
+
+    _sc = val & 0x81;
+    if (!isTransferring() || !_hasInternalClock()) {
+        // With the external clock the partner's transfer completes this one
+        return;
+    }
+
+    uint64_t now = _scheduler->now();
+    _output.push_back(static_cast<char>(_sb));
+    // A send which fails on a full inbox reads as a disconnected cable,
+    // rather than the last transfer's reply
+    _reply = 0xFF;
+    if (_cable) {
+        LinkCable::Message message = {LinkCable::Message::TypeStart, _sb, now};
+        _isAwaitingReply = _cable->send(_end, message);
+        _replyTime = now + ReplyDelay;
+    }
+    _scheduler->schedule(_masterEvent, now + (TransferCycles >> _speedShift));
+}
+
+void Serial::_finish(gb::Byte received)
+{
+    _sb = received;
+    _sc &= 0x7F;
+    _interrupts->request(Interrupts::InterruptSerial);
+}
+
+void Serial::_finishMaster(uint64_t when)
+{
+    if (_cable) {
+        // Once the partner's clock is past _replyTime it has answered, or
+        // couldn't send the reply and so reads as disconnected
+        _cable->publishClock(_end, when);
+        _poll();
+        while (_isAwaitingReply && _cable->partnerClock(_end) <= _replyTime) {
+            std::this_thread::yield();
+            _poll();
+        }
+
+        // The partner may have replied just before disconnecting
+        _poll();
+    }
+
+    _finish(_isAwaitingReply ? 0xFF : _reply);
+    _isAwaitingReply = false;
+}
+
+void Serial::_sync(uint64_t when)
+{
+    assert(_cable);
+
+    _cable->publishClock(_end, when);
+    _poll();
+    while (when > MaxSkew && _cable->partnerClock(_end) < when - MaxSkew) {
+        std::this_thread::yield();
+        _poll();
+    }
+
+    _scheduler->schedule(_syncEvent, when + SyncQuantum);
+}
+
+void Serial::_poll()
+{
+    LinkCable::Message message;
+    while (_cable->receive(_end, message)) {
+        if (message.type == LinkCable::Message::TypeReply) {
+            _reply = message.data;
+            _isAwaitingReply = false;
+            continue;
+        }
+
+        // The partner waits for the reply, so at most one start is pending.
+        // MaxSkew keeps the answer time ahead of now, max() is a safety net.
+        _start = message;
+        _scheduler->schedule(_answerEvent, std::max(_scheduler->now(), message.time + ReplyDelay));
+    }
+}
+
+void Serial::_answer()
+{
+    if (!_cable) {
+        return;
+    }
+
+    // Only a port waiting for an external clock shifts its byte out
+    bool isReady = isTransferring() && !_hasInternalClock();
+    LinkCable::Message reply = {LinkCable::Message::TypeReply, isReady ? _sb : gb::Byte(0xFF),
+                                _scheduler->now()};
+
+    // If the reply can't be sent the partner reads 0xFF, as if the cable
+    // were pulled, so this end isn't clocked either
+    if (_cable->send(_end, reply) && isReady) {
+        _output.push_back(static_cast<char>(_sb));
+        _slaveReceived = _start.data;
+        uint64_t done = std::max(_scheduler->now(), _start.time + TransferCycles);
+        _scheduler->schedule(_slaveEvent, done);
+    }
+}
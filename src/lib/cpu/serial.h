@@ -0,0 +1,116 @@
+#ifndef GB_SERIAL_H
+#define GB_SERIAL_H
+
+#include <cstdint>
+#include <string>
+
+#include "cpu/addressable.h"
+#include "cpu/interrupts.h"
+#include "cpu/linkcable.h"
+#include "cpu/scheduler.h"
+#include "util/units.h"
+
+namespace gb {
+
+/**
+ * The serial port, SB and SC (0xFF01-0xFF02).
+ *
+ * A transfer is one scheduled event rather than eight bit shifts. Without a
+ * cable the other side reads as 0xFF. With one, the two emulators exchange
+ * whole bytes over the LinkCable and meet every SyncQuantum cycles, each
+ * waiting only when it gets more than MaxSkew cycles ahead of the other.
+ * Every byte sent is also kept in output(), which test ROMs print to.
+ *
+ * The receiving end answers a transfer ReplyDelay cycles after it started,
+ * on its own clock. It can't have got that far before the start arrives, so
+ * the bytes exchanged depend only on the two programs and not on how the
+ * threads were scheduled.
+ */
+class Serial : public Addressable
+{
+public:
+    enum Register
+    {
+        RegSB = 0,
+        RegSC = 1,
+    };
+
+    // 8 bits at 8192Hz with the internal clock
+    static const uint64_t TransferCycles = 4096;
+    static const uint64_t SyncQuantum = 512;
+    static const uint64_t MaxSkew = 512;
+
+    // A start is seen within MaxSkew + SyncQuantum of being sent. Answering
+    // before a double speed transfer ends means two ports transferring at
+    // once never wait on each other.
+    static const uint64_t ReplyDelay = MaxSkew + 2*SyncQuantum;
+    static_assert(ReplyDelay < TransferCycles/2, "Replies must be due before a transfer finishes");
+
+    /**
+     * Caller retains ownership of scheduler and interrupts.
+     */
+    Serial(Scheduler* scheduler, Interrupts* interrupts);
+    ~Serial();
+
+    void reset();
+
+    /**
+     * Plugs into end of cable. Both ends must be connected before either
+     * emulator starts running. Caller retains ownership of cable.
+     */
+    void connect(LinkCable* cable, size_t end);
+
+    /**
+     * Unplugs, after which the other end never waits for this one. Must be
+     * called when this emulator stops running.
+     */
+    void disconnect();
+
+    /**
+     * In CGB double speed the internal clock shifts twice as fast.
+     */
+    void setDoubleSpeed(bool isDoubleSpeed) { _speedShift = isDoubleSpeed ? 1 : 0; }
+
+    bool isTransferring() const { return (_sc & 0x80) != 0; }
+    const std::string& output() const { return _output; }
+
+    virtual gb::Byte& operator[](size_t address) override;
+    virtual bool isValidAddress(size_t address) const override;
+    virtual gb::Byte read(size_t address) override;
+    virtual void write(size_t address, gb::Byte val) override;
+
+private:
+    bool _hasInternalClock() const { return (_sc & 0x01) != 0; }
+
+    void _finish(gb::Byte received);
+    void _finishMaster(uint64_t when);
+    void _answer();
+    void _sync(uint64_t when);
+    void _poll();
+
+    Scheduler* _scheduler;
+    Interrupts* _interrupts;
+    Scheduler::EventId _masterEvent;
+    Scheduler::EventId _slaveEvent;
+    Scheduler::EventId _answerEvent;
+    Scheduler::EventId _syncEvent;
+
+    gb::Byte _sb;
+    gb::Byte _sc;
+    unsigned int _speedShift;
+    std::string _output;
+
+    LinkCable* _cable;
+    size_t _end;
+    bool _isAwaitingReply;
+    gb::Byte _reply;
+    uint64_t _replyTime;
+    gb::Byte _slaveReceived;
+
+    // The partner's transfer, answered at _answerEvent
+    LinkCable::Message _start;
+};
+
+}
+
+#endif
@@ -0,0 +1,162 @@
+#include "timer.h"
+using gb::Timer;
+
+#include <cassert>
+
+namespace {
+
+// Clock cycles per TIMA increment for each TAC frequency
+const uint64_t TimaPeriods[4] = {1024, 16, 64, 256};
+
+}
+
+Timer::Timer(Scheduler* scheduler, Interrupts* interrupts) :
+    _scheduler(scheduler),
+    _interrupts(interrupts)
+{
+    assert(_scheduler && _interrupts);
+    _overflowEvent = _scheduler->addEvent([this](uint64_t when) { _overflow(when); });
+    reset();
+}
+
+Timer::~Timer()
+{
+}
+
+void Timer::reset()
+{
+    _counterBase = 0;
+    _clockBase = _scheduler->now();
+    _speedShift = 0;
+    _tima = 0;
+    _timaSync = _clockBase;
+    _tma = 0;
+    _tac = 0;
+    _scheduler->cancel(_overflowEvent);
+}
+
+void Timer::setDoubleSpeed(bool isDoubleSpeed)
+{
+    uint64_t now = _scheduler->now();
+    _syncTima(now);
+    _counterBase = _counter(now);
+    _clockBase = now;
+    _speedShift = isDoubleSpeed ? 1 : 0;
+    _scheduleOverflow();
+}
+
+void Timer::setCounter(uint16_t counter)
+{
+    uint64_t now = _scheduler->now();
+    _syncTima(now);
+    _counterBase = counter;
+    _clockBase = now;
+    _scheduleOverflow();
+}
+
+gb::Byte& Timer::operator[](size_t address)
+{
+    assert(isValidAddress(address));
+    _snapshot[address] = read(address);
+    return _snapshot[address];
+}
+
+bool Timer::isValidAddress(size_t address) const
+{
+    return address <= RegTAC;
+}
+
+gb::Byte Timer::read(size_t address)
+{
+    switch (address) {
+        case RegDIV:
+            return (_counter(_scheduler->now()) >> 8) & 0xFF;
+        case RegTIMA:
+            _syncTima(_scheduler->now());
+            return _tima & 0xFF;
+        case RegTMA:
+            return _tma;
+        case RegTAC:
+            return _tac | 0xF8;
+        default:
+            assert(false && "Timer: invalid register");
+            return 0xFF;
+    }
+}
+
+void Timer::write(size_t address, gb::Byte val)
+{
+    uint64_t now = _scheduler->now();
+
+    switch (address) {
+        case RegDIV:
+            // Any write clears the whole internal counter
+            _syncTima(now);
+            _counterBase = 0;
+            _clockBase = now;
+            break;
+        case RegTIMA:
+            _syncTima(now);
+            _tima = val;
+            break;
+        case RegTMA:
+            _tma = val;
+            return;
+        case RegTAC:
+            _syncTima(now);
+            _tac = val & 0x07;
+            break;
+        default:
+            assert(false && "Timer: invalid register");
+            return;
+    }
+
+    _scheduleOverflow();
+}
+
+uint64_t Timer::_period() const
+{
+    return TimaPeriods[_tac & 0x03];
+}
+
+uint64_t Timer::_counter(uint64_t cycles) const
+{
+    return _counterBase + ((cycles - _clockBase) << _speedShift);
+}
+
+uint64_t Timer::_counterTime(uint64_t counter) const
+{
+    // First scheduler cycle at which the counter has reached counter
+    uint64_t ticks = counter - _counterBase;
+    return _clockBase + ((ticks + (1 << _speedShift) - 1) >> _speedShift);
+}
+
+void Timer::_syncTima(uint64_t cycles)
+{
+    if (_isEnabled()) {
+        // TIMA counts falling edges of a DIV counter bit, i.e. period boundaries
+        uint64_t period = _period();
+        _tima += _counter(cycles)/period - _counter(_timaSync)/period;
+    }
+    _timaSync = cycles;
+}
+
+void Timer::_scheduleOverflow()
+{
+    if (!_isEnabled()) {
+        _scheduler->cancel(_overflowEvent);
+        return;
+    }
+
+    uint64_t period = _period();
+    uint64_t ticks = 0x100 - (_tima & 0xFF);
+    _scheduler->schedule(_overflowEvent, _counterTime((_counter(_timaSync)/period + ticks)*period));
+}
+
+void Timer::_overflow(uint64_t when)
+{
+    _tima = _tma;
+    _timaSync = when;
+    _interrupts->request(Interrupts::InterruptTimer);
+    _scheduleOverflow();
+}
@@ -0,0 +1,91 @@
+#ifndef GB_TIMER_H
+#define GB_TIMER_H
+
+#include <cstdint>
+
+#include "cpu/addressable.h"
+#include "cpu/interrupts.h"
+#include "cpu/scheduler.h"
+#include "util/units.h"
+
+namespace gb {
+
+/**
+ * The DIV, TIMA, TMA and TAC timer registers (0xFF04-0xFF07).
+ *
+ * Nothing is ticked per instruction. DIV and TIMA are computed from the
+ * scheduler clock when read, and TIMA overflow is a scheduled event which
+ * reloads TMA and raises the timer interrupt.
+ */
+class Timer : public Addressable
+{
+public:
+    enum Register
+    {
+        RegDIV  = 0,
+        RegTIMA = 1,
+        RegTMA  = 2,
+        RegTAC  = 3,
+    };
+
+    /**
+     * Caller retains ownership of scheduler and interrupts.
+     */
+    Timer(Scheduler* scheduler, Interrupts* interrupts);
+    ~Timer();
+
+    void reset();
+
+    /**
+     * In CGB double speed the internal counter runs at the CPU clock, twice
+     * per scheduler cycle. DIV and TIMA carry on from their current values.
+     */
+    void setDoubleSpeed(bool isDoubleSpeed);
+
+    /**
+     * Sets the internal counter, DIV being its upper byte. Used to install
+     * the state the boot ROM leaves behind.
+     */
+    void setCounter(uint16_t counter);
+
+    /**
+     * Raw access to a snapshot of the registers, for debugging. Writes
+     * through the returned reference are not seen by the timer.
+     */
+    virtual gb::Byte& operator[](size_t address) override;
+    virtual bool isValidAddress(size_t address) const override;
+    virtual gb::Byte read(size_t address) override;
+    virtual void write(size_t address, gb::Byte val) override;
+
+private:
+    bool _isEnabled() const { return (_tac & 0x04) != 0; }
+    uint64_t _period() const;
+    uint64_t _counter(uint64_t cycles) const;
+    uint64_t _counterTime(uint64_t counter) const;
+
+    void _syncTima(uint64_t cycles);
+    void _scheduleOverflow();
+    void _overflow(uint64_t when);
+
+    Scheduler* _scheduler;
+    Interrupts* _interrupts;
+    Scheduler::EventId _overflowEvent;
+
+    // Internal DIV counter value at scheduler cycle _clockBase, after which
+    // it counts 1 << _speedShift per cycle
+    uint64_t _counterBase;
+    uint64_t _clockBase;
+    unsigned int _speedShift;
+
+    // Value of TIMA as of cycle _timaSync
+    unsigned int _tima;
+    uint64_t _timaSync;
+
+    gb::Byte _tma;
+    gb::Byte _tac;
+    gb::Byte _snapshot[4];
+};
+
+}
+
+#endif
@@ -0,0 +1,121 @@
+#include "tracer.h"
+using gb::Tracer;
+
+#include <algorithm>
+#include <fstream>
+
+namespace {
+
+const char Magic[4] = {'G', 'B', 'T', 'R'};
+const uint32_t Version = 1;
+
+// cycles, six registers and the opcode, little endian
+const size_t RecordSize = 8 + 6*2 + 1;
+
+void putLittle(gb::Byte* out, uint64_t val, size_t bytes)
+{
+    for (size_t i = 0; i < bytes; ++i) {
+        out[i] = static_cast<gb::Byte>(val >> (8*i));
+    }
+}
+
+uint64_t getLittle(const gb::Byte* in, size_t bytes)
+{
+    uint64_t val = 0;
+    for (size_t i = 0; i < bytes; ++i) {
+        val |= static_cast<uint64_t>(in[i]) << (8*i);
+    }
+    return val;
+}
+
+}
+
+Tracer::Tracer(size_t capacity) :
+    _count(0)
+{
+    size_t size = 1;
+    while (size < capacity) {
+        size *= 2;
+    }
+    _records.resize(size);
+    _mask = size - 1;
+}
+
+std::vector<gb::TraceRecord> Tracer::records() const
+{
+    uint64_t size = std::min<uint64_t>(_count, _records.size());
+
+    std::vector<TraceRecord> out;
+    out.reserve(size);
+    for (uint64_t i = _count - size; i < _count; ++i) {
+        out.push_back(_records[i & _mask]);
+    }
+    return out;
+}
+
+bool Tracer::save(const std::string& path) const
+{
+    std::ofstream out(path, std::ios_base::binary);
+    if (!out) {
+        return false;
+    }
+
+    std::vector<TraceRecord> trace = records();
+    gb::Byte header[12];
+    putLittle(header, Version, 4);
+    putLittle(header + 4, trace.size(), 4);
+    putLittle(header + 8, RecordSize, 4);
+    out.write(Magic, sizeof(Magic));
+    out.write(reinterpret_cast<const char*>(header), sizeof(header));
+
+    std::vector<gb::Byte> data(trace.size()*RecordSize);
+    gb::Byte* p = data.data();
+    for (const TraceRecord& r : trace) {
+        putLittle(p, r.cycles, 8);
+        putLittle(p + 8, r.pc, 2);
+        putLittle(p + 10, r.af, 2);
+        putLittle(p + 12, r.bc, 2);
+        putLittle(p + 14, r.de, 2);
+        putLittle(p + 16, r.hl, 2);
+        putLittle(p + 18, r.sp, 2);
+        p[20] = r.opcode;
+        p += RecordSize;
+    }
+    out.write(reinterpret_cast<const char*>(data.data()), data.size());
+    return static_cast<bool>(out);
+}
+
+bool gb::loadTrace(const std::string& path, std::vector<TraceRecord>& records)
+{
+    std::ifstream in(path, std::ios_base::binary);
+    char magic[4];
+    gb::Byte header[12];
+    if (!in.read(magic, sizeof(magic)) || !in.read(reinterpret_cast<char*>(header), sizeof(header))) {
+        return false;
+    }
+    if (!std::equal(magic, magic + sizeof(magic), Magic) || getLittle(header, 4) != Version ||
+        getLittle(header + 8, 4) != RecordSize) {
+        return false;
+    }
+
+    size_t count = getLittle(header + 4, 4);
+    std::vector<gb::Byte> data(count*RecordSize);
+    if (!in.read(reinterpret_cast<char*>(data.data()), data.size())) {
+        return false;
+    }
+
+    records.resize(count);
+    const gb::Byte* p = data.data();
+    for (TraceRecord& r : records) {
+        r.cycles = getLittle(p, 8);
+        r.pc = static_cast<gb::Word>(getLittle(p + 8, 2));
+        r.af = static_cast<gb::Word>(getLittle(p + 10, 2));
+        r.bc = static_cast<gb::Word>(getLittle(p + 12, 2));
+        r.de = static_cast<gb::Word>(getLittle(p + 14, 2));
+        r.hl = static_cast<gb::Word>(getLittle(p + 16, 2));
+        r.sp = static_cast<gb::Word>(getLittle(p + 18, 2));
+        r.opcode = p[20];
+        p += RecordSize;
+    }
+    return true;
+}
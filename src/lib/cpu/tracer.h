@@ -0,0 +1,98 @@
+#ifndef GB_TRACER_H
+#define GB_TRACER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "cpu/cpu.h"
+#include "util/units.h"
+
+namespace gb {
+
+/**
+ * Whether the Cpu records into its Tracer. Tracing is compiled in with
+ * GB_TRACE, without it the Cpu has no tracing code at all.
+ */
+#ifdef GB_TRACE
+const bool IsTraceEnabled = true;
+#else
+const bool IsTraceEnabled = false;
+#endif
+
+/**
+ * State at the start of an instruction.
+ */
+struct TraceRecord
+{
+    uint64_t cycles;
+    gb::Word pc;
+    gb::Word af;
+    gb::Word bc;
+    gb::Word de;
+    gb::Word hl;
+    gb::Word sp;
+    gb::Byte opcode;
+};
+
+/**
+ * Keeps the last capacity instructions executed in a ring of fixed-size
+ * binary records. Recording is a handful of stores, everything else,
+ * including formatting, is left to whoever reads the saved file.
+ */
+class Tracer
+{
+public:
+    /**
+     * capacity is rounded up to a power of two.
+     */
+    Tracer(size_t capacity);
+
+    size_t capacity() const { return _records.size(); }
+
+    /**
+     * Number of instructions recorded, including those overwritten since.
+     */
+    uint64_t count() const { return _count; }
+
+    /**
+     * pc is the opcode's address, regs.PC may already be past it.
+     */
+    void record(uint64_t cycles, gb::Word pc, const Cpu::Registers& regs, gb::Byte opcode)
+    {
+        TraceRecord& r = _records[_count++ & _mask];
+        r.cycles = cycles;
+        r.pc = pc;
+        r.af = regs.AF;
+        r.bc = regs.BC;
+        r.de = regs.DE;
+        r.hl = regs.HL;
+        r.sp = regs.SP;
+        r.opcode = opcode;
+    }
+
+    /**
+     * Records still in the ring, oldest first.
+     */
+    std::vector<TraceRecord> records() const;
+
+    /**
+     * Writes records() to path. Returns false if it can't be written.
+     */
+    bool save(const std::string& path) const;
+
+private:
+    std::vector<TraceRecord> _records;
+    size_t _mask;
+    uint64_t _count;
+};
+
+/**
+ * Reads back a file written by Tracer::save(). Returns false if it is
+ * missing or malformed.
+ */
+bool loadTrace(const std::string& path, std::vector<TraceRecord>& records);
+
+}
+
+#endif
@@ -0,0 +1,174 @@
+#include "audio.h"
+using gb::WavWriter;
+using gb::AudioOutput;
+using gb::RateController;
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+
+namespace {
+
+const int Channels = 2;
+const int BitsPerSample = 16;
+const size_t HeaderSize = 44;
+
+void writeLe(std::ostream& out, uint32_t val, int bytes)
+{
+    for (int i = 0; i < bytes; ++i) {
+        out.put(static_cast<char>(val >> (8*i)));
+    }
+}
+
+}
+
+WavWriter::WavWriter(const std::string& path, unsigned sampleRate) :
+    _out(path, std::ios_base::binary),
+    _isOpen(false),
+    _framesWritten(0)
+{
+    if (!_out) {
+        return;
+    }
+
+    // Sizes are patched by finish()
+    _out.write("RIFF", 4);
+    writeLe(_out, 0, 4);
+    _out.write("WAVE", 4);
+
+    _out.write("fmt ", 4);
+    writeLe(_out, 16, 4);
+    writeLe(_out, 1, 2);
+    writeLe(_out, Channels, 2);
+    writeLe(_out, sampleRate, 4);
+    writeLe(_out, sampleRate*Channels*BitsPerSample/8, 4);
+    writeLe(_out, Channels*BitsPerSample/8, 2);
+    writeLe(_out, BitsPerSample, 2);
+
+    _out.write("data", 4);
+    writeLe(_out, 0, 4);
+
+    _isOpen = true;
+}
+
+WavWriter::~WavWriter()
+{
+    finish();
+}
+
+void WavWriter::consume(const int16_t* samples, size_t frames)
+{
+    assert(_isOpen);
+
+    for (size_t i = 0; i < frames*Channels; ++i) {
+        writeLe(_out, static_cast<uint16_t>(samples[i]), 2);
+    }
+    _framesWritten += frames;
+}
+
+void WavWriter::finish()
+{
+    if (!_isOpen) {
+        return;
+    }
+
+    uint32_t dataSize = static_cast<uint32_t>(_framesWritten*Channels*BitsPerSample/8);
+    _out.seekp(4);
+    writeLe(_out, HeaderSize - 8 + dataSize, 4);
+    _out.seekp(HeaderSize - 4);
+    writeLe(_out, dataSize, 4);
+    _out.close();
+
+    _isOpen = false;
+}
+
+AudioOutput::AudioOutput(AudioRing* ring, AudioSink* sink, unsigned sampleRate,
+                         size_t periodFrames, bool isRealTime) :
+    _ring(ring),
+    _sink(sink),
+    _sampleRate(sampleRate),
+    _periodFrames(periodFrames),
+    _isRealTime(isRealTime),
+    _isClosing(false),
+    _underruns(0)
+{
+    assert(_ring && _sink && _sampleRate > 0 && _periodFrames > 0);
+    _thread = std::thread(&AudioOutput::_run, this);
+}
+
+AudioOutput::~AudioOutput()
+{
+    close();
+}
+
+void AudioOutput::close()
+{
+    if (!_thread.joinable()) {
+        return;
+    }
+
+    _isClosing.store(true, std::memory_order_release);
+    _thread.join();
+    _sink->finish();
+}
+
+void AudioOutput::_run()
+{
+    typedef std::chrono::steady_clock Clock;
+
+    std::vector<int16_t> period(_periodFrames*Channels);
+    Clock::duration periodTime = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(static_cast<double>(_periodFrames)/_sampleRate));
+    Clock::time_point deadline = Clock::now();
+
+    while (true) {
+        // Closing is checked before reading so nothing written before close()
+        // is lost
+        bool isClosing = _isClosing.load(std::memory_order_acquire);
+        size_t frames = _ring->read(period.data(), period.size())/Channels;
+
+        if (_isRealTime) {
+            if (frames == 0 && isClosing) {
+                break;
+            }
+            if (frames < _periodFrames && !isClosing) {
+                std::fill(period.begin() + frames*Channels, period.end(), 0);
+                frames = _periodFrames;
+                _underruns.fetch_add(1, std::memory_order_relaxed);
+            }
+            _sink->consume(period.data(), frames);
+
+            deadline += periodTime;
+            std::this_thread::sleep_until(deadline);
+        } else {
+            if (frames > 0) {
+                _sink->consume(period.data(), frames);
+            } else if (isClosing) {
+                break;
+            } else {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+    }
+}
+
+RateController::RateController(unsigned nominalRate, double targetFill, double maxAdjust) :
+    _nominalRate(nominalRate),
+    _targetFill(targetFill),
+    _maxAdjust(maxAdjust),
+    _fill(targetFill)
+{
+    assert(_targetFill > 0.0 && _targetFill < 1.0);
+}
+
+unsigned RateController::update(double fill)
+{
+    // Smooth out the jitter of the sink pulling whole periods
+    _fill += (fill - _fill)*0.1;
+
+    // Scale the error so empty and full both give the largest adjustment
+    double error = _fill < _targetFill ? (_targetFill - _fill)/_targetFill :
+                                         (_targetFill - _fill)/(1.0 - _targetFill);
+    double ratio = 1.0 + _maxAdjust*std::max(-1.0, std::min(1.0, error));
+    return static_cast<unsigned>(_nominalRate*ratio + 0.5);
+}
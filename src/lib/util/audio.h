@@ -0,0 +1,133 @@
+#ifndef GB_AUDIO_H
+#define GB_AUDIO_H
+
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ringbuffer.h"
+
+namespace gb {
+
+/**
+ * Interleaved 16-bit stereo samples queued between the emulation thread and
+ * the audio thread.
+ */
+typedef RingBuffer<int16_t> AudioRing;
+
+/**
+ * Destination for audio frames, called from the audio thread.
+ */
+class AudioSink
+{
+public:
+    virtual ~AudioSink() {}
+
+    /**
+     * Receives frames stereo frames, interleaved left then right.
+     */
+    virtual void consume(const int16_t* samples, size_t frames) = 0;
+
+    /**
+     * Called once after the last frame.
+     */
+    virtual void finish() {}
+};
+
+/**
+ * Streams 16-bit stereo PCM to a WAV file. The header's sizes are filled in
+ * by finish().
+ */
+class WavWriter : public AudioSink
+{
+public:
+    WavWriter(const std::string& path, unsigned sampleRate);
+    ~WavWriter();
+
+    bool isOpen() const { return _isOpen; }
+    size_t framesWritten() const { return _framesWritten; }
+
+    virtual void consume(const int16_t* samples, size_t frames) override;
+    virtual void finish() override;
+
+private:
+    std::ofstream _out;
+    bool _isOpen;
+    size_t _framesWritten;
+};
+
+/**
+ * Pulls audio from a ring on its own thread and hands it to a sink, one
+ * period at a time.
+ *
+ * In real time mode a period is pulled every period's worth of wall time,
+ * like a sound card would, and missing frames are replaced with silence.
+ * Otherwise frames are passed on as soon as they arrive and nothing is
+ * lost, which suits file output.
+ */
+class AudioOutput
+{
+public:
+    /**
+     * Caller retains ownership of ring and sink.
+     */
+    AudioOutput(AudioRing* ring, AudioSink* sink, unsigned sampleRate, size_t periodFrames,
+                bool isRealTime);
+    ~AudioOutput();
+
+    /**
+     * Plays out what's left in the ring, stops the thread and finishes the
+     * sink.
+     */
+    void close();
+
+    size_t underruns() const { return _underruns.load(std::memory_order_relaxed); }
+
+private:
+    void _run();
+
+    AudioRing* _ring;
+    AudioSink* _sink;
+    unsigned _sampleRate;
+    size_t _periodFrames;
+    bool _isRealTime;
+
+    std::atomic<bool> _isClosing;
+    std::atomic<size_t> _underruns;
+    std::thread _thread;
+};
+
+/**
+ * Picks the resampling rate which keeps a ring's fill level near a target.
+ *
+ * The emulator's clock and the sink's never quite agree, so the ring slowly
+ * drains or fills. Producing slightly more samples when it's low and fewer
+ * when it's high holds it steady, and a change of at most maxAdjust can't
+ * be heard.
+ */
+class RateController
+{
+public:
+    RateController(unsigned nominalRate, double targetFill = 0.5, double maxAdjust = 0.005);
+
+    unsigned nominalRate() const { return _nominalRate; }
+
+    /**
+     * Takes the ring's current fill, from 0 to 1, and returns the rate to
+     * resample to.
+     */
+    unsigned update(double fill);
+
+private:
+    unsigned _nominalRate;
+    double _targetFill;
+    double _maxAdjust;
+    double _fill;
+};
+
+}
+
+#endif
@@ -0,0 +1,89 @@
+#include "blep.h"
+
+#include <cmath>
+
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
+namespace {
+
+// Fraction of the Nyquist frequency passed, leaving room for the window's
+// transition band
+const double Cutoff = 0.9;
+
+struct BlepKernel
+{
+    BlepKernel()
+    {
+        const double Pi = 3.14159265358979323846;
+
+        for (int phase = 0; phase < gb::BlepPhases; ++phase) {
+            double sum = 0.0;
+            double values[gb::BlepWidth];
+            for (int i = 0; i < gb::BlepWidth; ++i) {
+                // Distance from the step, centred in the kernel
+                double x = i - (gb::BlepWidth/2 - 1) - static_cast<double>(phase)/gb::BlepPhases;
+                double sinc = x == 0.0 ? 1.0 : std::sin(Pi*Cutoff*x)/(Pi*Cutoff*x);
+                double w = 2.0*Pi*x/gb::BlepWidth;
+                double window = 0.42 + 0.5*std::cos(w) + 0.08*std::cos(2.0*w);
+                values[i] = sinc*window;
+                sum += values[i];
+            }
+
+            // Each phase sums to one so a step's total change is exact
+            for (int i = 0; i < gb::BlepWidth; ++i) {
+                taps[phase][i] = static_cast<float>(values[i]/sum);
+            }
+        }
+    }
+
+    alignas(16) float taps[gb::BlepPhases][gb::BlepWidth];
+};
+
+const BlepKernel Kernel;
+
+}
+
+void gb::addBlepStep(float* deltas, int phase, float delta)
+{
+    const float* taps = Kernel.taps[phase];
+
+#ifdef __SSE__
+    __m128 d = _mm_set1_ps(delta);
+    for (int i = 0; i < BlepWidth; i += 4) {
+        __m128 out = _mm_loadu_ps(deltas + i);
+        out = _mm_add_ps(out, _mm_mul_ps(_mm_load_ps(taps + i), d));
+        _mm_storeu_ps(deltas + i, out);
+    }
+#else
+    for (int i = 0; i < BlepWidth; ++i) {
+        deltas[i] += taps[i]*delta;
+    }
+#endif
+}
+
+void gb::mixChannels(const float* const* inputs, const float* gains, size_t numInputs,
+                     float* out, size_t count)
+{
+    size_t i = 0;
+
+#ifdef __SSE__
+    for (; i + 4 <= count; i += 4) {
+        __m128 sum = _mm_loadu_ps(out + i);
+        for (size_t input = 0; input < numInputs; ++input) {
+            __m128 samples = _mm_loadu_ps(inputs[input] + i);
+            sum = _mm_add_ps(sum, _mm_mul_ps(samples, _mm_set1_ps(gains[input])));
+        }
+        _mm_storeu_ps(out + i, sum);
+    }
+#endif
+
+    for (; i < count; ++i) {
+        float sum = out[i];
+        for (size_t input = 0; input < numInputs; ++input) {
+            sum += inputs[input][i]*gains[input];
+        }
+        out[i] = sum;
+    }
+}
@@ -0,0 +1,34 @@
+#ifndef GB_BLEP_H
+#define GB_BLEP_H
+
+#include <cstddef>
+
+namespace gb {
+
+/**
+ * Band-limited step (BLEP) synthesis.
+ *
+ * Sound is generated as a buffer of amplitude changes rather than samples. A
+ * change at a fractional sample position is spread over BlepWidth samples
+ * with a windowed sinc, and summing the buffer afterwards gives a signal
+ * without the aliasing of naively sampled square waves. Generating a block
+ * only costs work per amplitude change, not per clock cycle.
+ */
+const int BlepPhases = 32;
+const int BlepWidth = 16;
+
+/**
+ * Adds a step of delta, phase/BlepPhases of a sample after deltas[0]. Writes
+ * the BlepWidth entries from deltas.
+ */
+void addBlepStep(float* deltas, int phase, float delta);
+
+/**
+ * Adds each of the numInputs buffers scaled by its gain to out.
+ */
+void mixChannels(const float* const* inputs, const float* gains, size_t numInputs,
+                 float* out, size_t count);
+
+}
+
+#endif
@@ -0,0 +1,280 @@
+#include "framedump.h"
+using gb::FrameDumpWriter;
+using gb::FrameDumpReader;
+
+#include <algorithm>
+#include <cassert>
+
+namespace {
+
+const char Magic[4] = {'G', 'B', 'F', 'D'};
+const uint32_t Version = 1;
+
+void putVarint(std::vector<gb::Byte>& out, size_t val)
+{
+    while (val >= 0x80) {
+        out.push_back(static_cast<gb::Byte>(val | 0x80));
+        val >>= 7;
+    }
+    out.push_back(static_cast<gb::Byte>(val));
+}
+
+bool getVarint(const gb::Byte*& data, const gb::Byte* end, size_t& val)
+{
+    val = 0;
+    for (int shift = 0; data < end && shift < 64; shift += 7) {
+        gb::Byte b = *data++;
+        val |= static_cast<size_t>(b & 0x7F) << shift;
+        if ((b & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void writeU32(std::ostream& out, uint32_t val)
+{
+    char buf[4] = {
+        static_cast<char>(val),
+        static_cast<char>(val >> 8),
+        static_cast<char>(val >> 16),
+        static_cast<char>(val >> 24)
+    };
+    out.write(buf, 4);
+}
+
+bool readU32(std::istream& in, uint32_t& val)
+{
+    unsigned char buf[4];
+    if (!in.read(reinterpret_cast<char*>(buf), 4)) {
+        return false;
+    }
+    val = buf[0] | (buf[1] << 8) | (buf[2] << 16) | (static_cast<uint32_t>(buf[3]) << 24);
+    return true;
+}
+
+}
+
+void gb::encodeFrameDelta(const gb::Byte* prev, const gb::Byte* cur, size_t size,
+                          std::vector<gb::Byte>& out)
+{
+    out.clear();
+
+    size_t i = 0;
+    while (i < size) {
+        size_t same = i;
+        while (same < size && prev[same] == cur[same]) {
+            ++same;
+        }
+        size_t changed = same;
+        while (changed < size && prev[changed] != cur[changed]) {
+            ++changed;
+        }
+
+        putVarint(out, same - i);
+        putVarint(out, changed - same);
+        for (size_t j = same; j < changed; ++j) {
+            out.push_back(prev[j] ^ cur[j]);
+        }
+        i = changed;
+    }
+}
+
+bool gb::decodeFrameDelta(const gb::Byte* data, size_t length, gb::Byte* frame, size_t size)
+{
+    const gb::Byte* end = data + length;
+
+    size_t i = 0;
+    while (data < end) {
+        size_t same = 0;
+        size_t changed = 0;
+        if (!getVarint(data, end, same) || !getVarint(data, end, changed)) {
+            return false;
+        }
+        if (same > size - i || changed > size - i - same ||
+            changed > static_cast<size_t>(end - data)) {
+            return false;
+        }
+
+        i += same;
+        for (size_t j = 0; j < changed; ++j) {
+            frame[i++] ^= *data++;
+        }
+    }
+    return true;
+}
+
+FrameDumpWriter::FrameDumpWriter(const std::string& path, size_t frameSize) :
+    _out(path, std::ios_base::binary),
+    _isOpen(false),
+    _frameSize(frameSize),
+    _previous(frameSize, 0x00),
+    _fillIndex(0),
+    _framesDropped(0),
+    _queueHead(0),
+    _queueSize(0),
+    _isClosing(false),
+    _hasFailed(false),
+    _framesWritten(0)
+{
+    for (size_t i = 0; i < NumBuffers; ++i) {
+        _buffers[i].resize(frameSize, 0x00);
+        _frameNumbers[i] = 0;
+    }
+
+    if (!_out) {
+        return;
+    }
+
+    _out.write(Magic, sizeof(Magic));
+    writeU32(_out, Version);
+    writeU32(_out, static_cast<uint32_t>(frameSize));
+    if (!_out) {
+        return;
+    }
+
+    _isOpen = true;
+    _thread = std::thread(&FrameDumpWriter::_run, this);
+}
+
+FrameDumpWriter::~FrameDumpWriter()
+{
+    close();
+}
+
+bool FrameDumpWriter::submit(uint32_t frameNumber)
+{
+    assert(_isOpen);
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_hasFailed) {
+            return false;
+        }
+        if (_queueSize == NumBuffers - 1) {
+            // The writer still owns every other buffer, keep filling this one
+            ++_framesDropped;
+            return false;
+        }
+        _frameNumbers[_fillIndex] = frameNumber;
+        ++_queueSize;
+    }
+    _cond.notify_one();
+
+    _fillIndex = (_fillIndex + 1) % NumBuffers;
+    return true;
+}
+
+bool FrameDumpWriter::close()
+{
+    if (!_isOpen) {
+        return !_hasFailed;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _isClosing = true;
+    }
+    _cond.notify_one();
+    _thread.join();
+
+    _out.close();
+    _isOpen = false;
+    if (!_out) {
+        _hasFailed = true;
+    }
+    return !_hasFailed;
+}
+
+size_t FrameDumpWriter::framesWritten()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _framesWritten;
+}
+
+bool FrameDumpWriter::hasFailed()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _hasFailed;
+}
+
+void FrameDumpWriter::_run()
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (true) {
+        _cond.wait(lock, [this] { return _queueSize > 0 || _isClosing; });
+        if (_queueSize == 0) {
+            break;
+        }
+
+        // The buffer stays queued until written so submit() can't refill it
+        size_t index = _queueHead;
+        lock.unlock();
+        bool isWritten = _writeRecord(_frameNumbers[index], _buffers[index]);
+        lock.lock();
+
+        _queueHead = (_queueHead + 1) % NumBuffers;
+        --_queueSize;
+        if (!isWritten) {
+            // Later records would be deltas against one the file doesn't hold
+            _hasFailed = true;
+            break;
+        }
+        ++_framesWritten;
+    }
+    if (!_hasFailed && !_out.flush()) {
+        _hasFailed = true;
+    }
+}
+
+bool FrameDumpWriter::_writeRecord(uint32_t frameNumber, const std::vector<gb::Byte>& frame)
+{
+    gb::encodeFrameDelta(_previous.data(), frame.data(), _frameSize, _encoded);
+    _previous = frame;
+
+    writeU32(_out, frameNumber);
+    writeU32(_out, static_cast<uint32_t>(_encoded.size()));
+    _out.write(reinterpret_cast<const char*>(_encoded.data()), _encoded.size());
+    return static_cast<bool>(_out);
+}
+
+FrameDumpReader::FrameDumpReader(const std::string& path) :
+    _in(path, std::ios_base::binary),
+    _isOpen(false)
+{
+    char magic[4];
+    uint32_t version = 0;
+    uint32_t frameSize = 0;
+    if (!_in.read(magic, sizeof(magic)) || !readU32(_in, version) || !readU32(_in, frameSize)) {
+        return;
+    }
+    if (!std::equal(magic, magic + sizeof(magic), Magic) || version != Version) {
+        return;
+    }
+
+    _frame.resize(frameSize, 0x00);
+    _isOpen = true;
+}
+
+bool FrameDumpReader::next(uint32_t& frameNumber, std::vector<gb::Byte>& frame)
+{
+    if (!_isOpen) {
+        return false;
+    }
+
+    uint32_t length = 0;
+    if (!readU32(_in, frameNumber) || !readU32(_in, length)) {
+        return false;
+    }
+
+    _encoded.resize(length);
+    if (!_in.read(reinterpret_cast<char*>(_encoded.data()), length)) {
+        return false;
+    }
+    if (!gb::decodeFrameDelta(_encoded.data(), length, _frame.data(), _frame.size())) {
+        return false;
+    }
+
+    frame = _frame;
+    return true;
+}
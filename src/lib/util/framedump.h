@@ -0,0 +1,130 @@
+#ifndef GB_FRAMEDUMP_H
+#define GB_FRAMEDUMP_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "units.h"
+
+namespace gb {
+
+/**
+ * XOR delta-codes cur against prev and run-length encodes the result into out.
+ *
+ * The encoding is a sequence of (unchanged run, changed run) varint pairs,
+ * each changed run followed by its bytes XOR'd with prev.
+ */
+void encodeFrameDelta(const gb::Byte* prev, const gb::Byte* cur, size_t size,
+                      std::vector<gb::Byte>& out);
+
+/**
+ * Applies an encoded delta to frame in place. Returns false if the data is
+ * malformed.
+ */
+bool decodeFrameDelta(const gb::Byte* data, size_t length, gb::Byte* frame, size_t size);
+
+/**
+ * Streams fixed-size frames to a file on a background thread.
+ *
+ * The caller fills frameBuffer() and calls submit(). Buffers form a ring: the
+ * emulation thread fills one while the writer thread encodes and writes the
+ * queued ones in order, so a short disk stall only grows the queue. submit()
+ * never waits for the disk, if every other buffer is still queued the new
+ * frame is dropped.
+ */
+class FrameDumpWriter
+{
+public:
+    /** Buffers in the ring, up to one less than this can be queued. */
+    static const size_t NumBuffers = 8;
+
+    FrameDumpWriter(const std::string& path, size_t frameSize);
+    ~FrameDumpWriter();
+
+    bool isOpen() const { return _isOpen; }
+    size_t frameSize() const { return _frameSize; }
+
+    /**
+     * Buffer to fill with the next frame, valid until the next submit().
+     */
+    gb::Byte* frameBuffer() { return _buffers[_fillIndex].data(); }
+
+    /**
+     * Hands the filled buffer over to the writer thread. Returns false if the
+     * frame was dropped or the file has failed.
+     */
+    bool submit(uint32_t frameNumber);
+
+    /**
+     * Writes any queued frames and stops the writer thread. Returns false if
+     * any write failed.
+     */
+    bool close();
+
+    size_t framesWritten();
+    size_t framesDropped() const { return _framesDropped; }
+
+    /**
+     * Set once a write fails, after which no more frames are written.
+     */
+    bool hasFailed();
+
+private:
+    void _run();
+    bool _writeRecord(uint32_t frameNumber, const std::vector<gb::Byte>& frame);
+
+    std::ofstream _out;
+    bool _isOpen;
+    size_t _frameSize;
+
+    std::vector<gb::Byte> _buffers[NumBuffers];
+    uint32_t _frameNumbers[NumBuffers];
+    std::vector<gb::Byte> _previous;
+    std::vector<gb::Byte> _encoded;
+    size_t _fillIndex;
+    size_t _framesDropped;
+
+    // Guarded by _mutex
+    std::mutex _mutex;
+    std::condition_variable _cond;
+    size_t _queueHead;
+    size_t _queueSize;
+    bool _isClosing;
+    bool _hasFailed;
+    size_t _framesWritten;
+
+    std::thread _thread;
+};
+
+/**
+ * Reads back files produced by FrameDumpWriter.
+ */
+class FrameDumpReader
+{
+public:
+    FrameDumpReader(const std::string& path);
+
+    bool isOpen() const { return _isOpen; }
+    size_t frameSize() const { return _frame.size(); }
+
+    /**
+     * Decodes the next frame. Returns false at the end of the file or on a
+     * malformed record.
+     */
+    bool next(uint32_t& frameNumber, std::vector<gb::Byte>& frame);
+
+private:
+    std::ifstream _in;
+    bool _isOpen;
+    std::vector<gb::Byte> _frame;
+    std::vector<gb::Byte> _encoded;
+};
+
+}
+
+#endif
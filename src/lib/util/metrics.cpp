@@ -0,0 +1,152 @@
+#include "metrics.h"
+using gb::Metrics;
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <set>
+#include <sstream>
+
+namespace {
+
+// How often the server thread checks whether it should stop
+const int PollMs = 100;
+
+const char* typeName(Metrics::Type type)
+{
+    return type == Metrics::TypeCounter ? "counter" : "gauge";
+}
+
+}
+
+Metrics::Metrics() :
+    _listenFd(-1),
+    _isServing(false)
+{
+}
+
+Metrics::~Metrics()
+{
+    close();
+}
+
+Metrics::Metric* Metrics::add(const std::string& name, const std::string& labels, Type type,
+                              const std::string& help)
+{
+    _metrics.emplace_back(new Metric(name, labels, type, help));
+    return _metrics.back().get();
+}
+
+void Metrics::write(std::ostream& out) const
+{
+    // Enough digits for whole cycle counts, without showing rounding noise
+    std::streamsize precision = out.precision(15);
+    std::set<std::string> described;
+    for (const auto& metric : _metrics) {
+        if (described.insert(metric->name).second) {
+            out << "# HELP " << metric->name << " " << metric->help << "\n";
+            out << "# TYPE " << metric->name << " " << typeName(metric->type) << "\n";
+        }
+
+        out << metric->name;
+        if (!metric->labels.empty()) {
+            out << "{" << metric->labels << "}";
+        }
+        out << " " << metric->value() << "\n";
+    }
+    out.precision(precision);
+}
+
+bool Metrics::listen(const std::string& path)
+{
+    sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) {
+        return false;
+    }
+    std::strcpy(addr.sun_path, path.c_str());
+
+    _listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (_listenFd < 0) {
+        return false;
+    }
+
+    unlink(path.c_str());
+    if (bind(_listenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+            ::listen(_listenFd, 4) != 0) {
+        ::close(_listenFd);
+        _listenFd = -1;
+        return false;
+    }
+
+    _path = path;
+    _isServing = true;
+    _thread = std::thread(&Metrics::_serve, this);
+    return true;
+}
+
+void Metrics::close()
+{
+    if (_listenFd < 0) {
+        return;
+    }
+
+    _isServing = false;
+    _thread.join();
+    ::close(_listenFd);
+    _listenFd = -1;
+    unlink(_path.c_str());
+}
+
+void Metrics::_serve()
+{
+    while (_isServing) {
+        pollfd pfd = {_listenFd, POLLIN, 0};
+        if (poll(&pfd, 1, PollMs) <= 0) {
+            continue;
+        }
+
+        int fd = accept(_listenFd, nullptr, nullptr);
+        if (fd >= 0) {
+            _respond(fd);
+            ::close(fd);
+        }
+    }
+}
+
+void Metrics::_respond(int fd)
+{
+    // Whatever the request, give it a moment to arrive so the response
+    // doesn't cross it, then answer with the metrics
+    pollfd pfd = {fd, POLLIN, 0};
+    if (poll(&pfd, 1, PollMs) > 0) {
+        char request[1024];
+        if (recv(fd, request, sizeof(request), 0) < 0) {
+            return;
+        }
+    }
+
+    std::stringstream body;
+    write(body);
+    std::string text = body.str();
+
+    std::stringstream response;
+    response << "HTTP/1.0 200 OK\r\n"
+             << "Content-Type: text/plain; version=0.0.4\r\n"
+             << "Content-Length: " << text.size() << "\r\n\r\n"
+             << text;
+    std::string out = response.str();
+
+    size_t sent = 0;
+    while (sent < out.size()) {
+        ssize_t n = send(fd, out.data() + sent, out.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0) {
+            return;
+        }
+        sent += n;
+    }
+}
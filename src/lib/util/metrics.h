@@ -0,0 +1,95 @@
+#ifndef GB_METRICS_H
+#define GB_METRICS_H
+
+#include <atomic>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace gb {
+
+/**
+ * Named values served in the Prometheus text format over a UNIX socket.
+ *
+ * The emulation thread stores into each Metric with relaxed atomics, once
+ * per batch of work rather than per instruction, and a background thread
+ * reads them whenever a client connects. Every connection gets one HTTP
+ * response and is closed, so "curl --unix-socket" works as a scraper.
+ */
+class Metrics
+{
+public:
+    enum Type
+    {
+        TypeCounter,
+        TypeGauge,
+    };
+
+    class Metric
+    {
+    public:
+        Metric(const std::string& name, const std::string& labels, Type type, const std::string& help) :
+            name(name),
+            labels(labels),
+            type(type),
+            help(help),
+            _value(0)
+        {
+        }
+
+        void set(double value) { _value.store(value, std::memory_order_relaxed); }
+        double value() const   { return _value.load(std::memory_order_relaxed); }
+
+        const std::string name;
+        const std::string labels;
+        const Type type;
+        const std::string help;
+
+    private:
+        std::atomic<double> _value;
+    };
+
+    Metrics();
+    ~Metrics();
+
+    /**
+     * Metrics are owned by this and live as long as it. labels is empty or
+     * a Prometheus label list without braces, 'subsystem="audio"'. Metrics
+     * sharing a name should be added together and with the same type and
+     * help. All metrics must be added before listen().
+     */
+    Metric* add(const std::string& name, const std::string& labels, Type type, const std::string& help);
+
+    /**
+     * Writes every metric in the Prometheus text exposition format.
+     */
+    void write(std::ostream& out) const;
+
+    /**
+     * Starts serving on a UNIX socket at path, replacing any stale socket
+     * file. Returns false if it can't be bound.
+     */
+    bool listen(const std::string& path);
+
+    /**
+     * Stops serving and removes the socket file.
+     */
+    void close();
+
+private:
+    void _serve();
+    void _respond(int fd);
+
+    std::vector<std::unique_ptr<Metric>> _metrics;
+
+    std::string _path;
+    int _listenFd;
+    std::atomic<bool> _isServing;
+    std::thread _thread;
+};
+
+}
+
+#endif
@@ -0,0 +1,96 @@
+#ifndef GB_RINGBUFFER_H
+#define GB_RINGBUFFER_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace gb {
+
+/**
+ * A lock-free single producer, single consumer queue of T.
+ *
+ * One thread may call write() while another calls read(). Each side only
+ * stores its own index and reads the other's, so neither ever waits. The
+ * capacity is rounded up to a power of two.
+ */
+template <typename T>
+class RingBuffer
+{
+public:
+    RingBuffer(size_t capacity) :
+        _writeIndex(0),
+        _readIndex(0)
+    {
+        size_t size = 1;
+        while (size < capacity) {
+            size *= 2;
+        }
+        _data.resize(size);
+        _mask = size - 1;
+    }
+
+    size_t capacity() const { return _data.size(); }
+
+    /**
+     * Elements waiting to be read. Exact when called from either side,
+     * otherwise a snapshot.
+     */
+    size_t size() const
+    {
+        return _writeIndex.load(std::memory_order_acquire) - _readIndex.load(std::memory_order_acquire);
+    }
+
+    /**
+     * Producer side. Appends up to count elements and returns how many fit.
+     */
+    size_t write(const T* data, size_t count)
+    {
+        size_t write = _writeIndex.load(std::memory_order_relaxed);
+        size_t read = _readIndex.load(std::memory_order_acquire);
+        count = std::min(count, capacity() - (write - read));
+
+        size_t start = write & _mask;
+        size_t first = std::min(count, capacity() - start);
+        std::copy(data, data + first, _data.begin() + start);
+        std::copy(data + first, data + count, _data.begin());
+
+        _writeIndex.store(write + count, std::memory_order_release);
+        return count;
+    }
+
+    /**
+     * Consumer side. Removes up to count elements into data and returns how
+     * many were available.
+     */
+    size_t read(T* data, size_t count)
+    {
+        size_t read = _readIndex.load(std::memory_order_relaxed);
+        size_t write = _writeIndex.load(std::memory_order_acquire);
+        count = std::min(count, write - read);
+
+        size_t start = read & _mask;
+        size_t first = std::min(count, capacity() - start);
+        std::copy(_data.begin() + start, _data.begin() + start + first, data);
+        std::copy(_data.begin(), _data.begin() + (count - first), data + first);
+
+        _readIndex.store(read + count, std::memory_order_release);
+        return count;
+    }
+
+private:
+    std::vector<T> _data;
+    size_t _mask;
+
+    // Each index on its own cache line so the two sides don't contend
+    char _pad0[64];
+    std::atomic<size_t> _writeIndex;
+    char _pad1[64];
+    std::atomic<size_t> _readIndex;
+    char _pad2[64];
+};
+
+}
+
+#endif
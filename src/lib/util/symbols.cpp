@@ -0,0 +1,90 @@
+#include "symbols.h"
+using gb::SymbolTable;
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+SymbolTable::SymbolTable()
+{
+}
+
+bool SymbolTable::load(const std::string& path)
+{
+    std::ifstream in(path);
+    if (!in) {
+        return false;
+    }
+    return load(in);
+}
+
+bool SymbolTable::load(std::istream& in)
+{
+    std::vector<Symbol> symbols;
+    std::string line;
+    while (std::getline(in, line)) {
+        line = line.substr(0, line.find(';'));
+
+        std::stringstream ss(line);
+        std::string location;
+        std::string name;
+        if (!(ss >> location >> name)) {
+            continue;
+        }
+
+        unsigned int bank = 0;
+        unsigned int address = 0;
+        char colon = 0;
+        if (std::sscanf(location.c_str(), "%x%c%x", &bank, &colon, &address) != 3 ||
+                colon != ':' || address > 0xFFFF) {
+            return false;
+        }
+        if (name.find('.') != std::string::npos) {
+            continue;
+        }
+        symbols.push_back(Symbol{_key(bank, static_cast<gb::Word>(address)), name});
+    }
+
+    _symbols.insert(_symbols.end(), symbols.begin(), symbols.end());
+    std::stable_sort(_symbols.begin(), _symbols.end());
+    return true;
+}
+
+void SymbolTable::add(size_t bank, gb::Word address, const std::string& name)
+{
+    Symbol symbol{_key(bank, address), name};
+    _symbols.insert(std::upper_bound(_symbols.begin(), _symbols.end(), symbol), symbol);
+}
+
+const std::string* SymbolTable::find(size_t bank, gb::Word address) const
+{
+    Symbol symbol{_key(bank, address), std::string()};
+    auto it = std::upper_bound(_symbols.begin(), _symbols.end(), symbol);
+    if (it == _symbols.begin()) {
+        return nullptr;
+    }
+
+    // Never resolve into a different bank or memory area
+    --it;
+    if ((it->key & 0xFFFFC000) != (symbol.key & 0xFFFFC000)) {
+        return nullptr;
+    }
+    return &it->name;
+}
+
+std::string SymbolTable::name(size_t bank, gb::Word address) const
+{
+    const std::string* symbol = find(bank, address);
+    if (symbol) {
+        return *symbol;
+    }
+
+    char text[16];
+    if (bank > 0) {
+        std::snprintf(text, sizeof(text), "%02x:%04x", static_cast<unsigned int>(bank), address);
+    } else {
+        std::snprintf(text, sizeof(text), "%04x", address);
+    }
+    return text;
+}
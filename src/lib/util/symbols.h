@@ -0,0 +1,65 @@
+#ifndef GB_SYMBOLS_H
+#define GB_SYMBOLS_H
+
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <vector>
+
+#include "units.h"
+
+namespace gb {
+
+/**
+ * Label addresses from an RGBDS .sym file, lines of "BB:AAAA Name" with
+ * ';' starting a comment.
+ *
+ * Local labels ("Parent.local") are skipped so that lookups resolve to the
+ * enclosing function.
+ */
+class SymbolTable
+{
+public:
+    SymbolTable();
+
+    bool load(const std::string& path);
+    bool load(std::istream& in);
+
+    void add(size_t bank, gb::Word address, const std::string& name);
+
+    size_t size() const { return _symbols.size(); }
+    bool empty() const  { return _symbols.empty(); }
+
+    /**
+     * Name of the closest label at or below address in the same bank and
+     * 16K area, or nullptr if there isn't one.
+     */
+    const std::string* find(size_t bank, gb::Word address) const;
+
+    /**
+     * Like find(), falling back to the address as hex, "0150" or
+     * "02:4a00" for a switchable ROM bank.
+     */
+    std::string name(size_t bank, gb::Word address) const;
+
+private:
+    struct Symbol
+    {
+        uint32_t key;
+        std::string name;
+
+        bool operator<(const Symbol& other) const { return key < other.key; }
+    };
+
+    static uint32_t _key(size_t bank, gb::Word address)
+    {
+        return static_cast<uint32_t>((bank << 16) | address);
+    }
+
+    // Sorted by key
+    std::vector<Symbol> _symbols;
+};
+
+}
+
+#endif
@@ -0,0 +1,139 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+#include "cpu/apu.h"
+#include "cpu/scheduler.h"
+
+class ApuTest : public testing::Test
+{
+protected:
+
+    ApuTest() :
+        _apu(&_scheduler)
+    {
+    }
+
+    /**
+     * Runs for cycles and returns the interleaved frames generated.
+     */
+    std::vector<int16_t> _run(uint64_t cycles)
+    {
+        std::vector<int16_t> out;
+        int16_t buffer[2*1024];
+
+        uint64_t end = _scheduler.now() + cycles;
+        while (_scheduler.now() < end) {
+            _scheduler.advanceTo(std::min(end, _scheduler.now() + 100000));
+            size_t frames = 0;
+            while ((frames = _apu.readFrames(buffer, 1024)) > 0) {
+                out.insert(out.end(), buffer, buffer + 2*frames);
+            }
+        }
+        return out;
+    }
+
+    void _playSquare(gb::Word frequency)
+    {
+        _apu.write(gb::Apu::RegNR50, 0x77);
+        _apu.write(gb::Apu::RegNR51, 0x22);
+        _apu.write(gb::Apu::RegNR21, 0x80);
+        _apu.write(gb::Apu::RegNR22, 0xF0);
+        _apu.write(gb::Apu::RegNR23, frequency & 0xFF);
+        _apu.write(gb::Apu::RegNR24, 0x80 | (frequency >> 8));
+    }
+
+    gb::Scheduler _scheduler;
+    gb::Apu _apu;
+};
+
+TEST_F(ApuTest, Registers)
+{
+    _apu.write(gb::Apu::RegNR11, 0x00);
+    EXPECT_EQ(0x3F, _apu.read(gb::Apu::RegNR11));
+    EXPECT_EQ(0xFF, _apu.read(gb::Apu::RegNR13));
+    EXPECT_EQ(0xF0, _apu.read(gb::Apu::RegNR52));
+
+    _apu.write(gb::Apu::RegWave + 3, 0x5A);
+    EXPECT_EQ(0x5A, _apu.read(gb::Apu::RegWave + 3));
+
+    // Powering off clears the registers and ignores writes
+    _apu.write(gb::Apu::RegNR50, 0x77);
+    _apu.write(gb::Apu::RegNR52, 0x00);
+    EXPECT_EQ(0x00, _apu.read(gb::Apu::RegNR50));
+    _apu.write(gb::Apu::RegNR50, 0x77);
+    EXPECT_EQ(0x00, _apu.read(gb::Apu::RegNR50));
+    EXPECT_EQ(0x70, _apu.read(gb::Apu::RegNR52));
+}
+
+TEST_F(ApuTest, Trigger)
+{
+    _playSquare(0x700);
+    EXPECT_TRUE(_apu.isChannelOn(gb::Apu::ChannelSquare2));
+    EXPECT_EQ(0xF2, _apu.read(gb::Apu::RegNR52));
+
+    // Turning the DAC off stops the channel
+    _apu.write(gb::Apu::RegNR22, 0x00);
+    EXPECT_FALSE(_apu.isChannelOn(gb::Apu::ChannelSquare2));
+}
+
+TEST_F(ApuTest, Length)
+{
+    _apu.write(gb::Apu::RegNR22, 0xF0);
+    _apu.write(gb::Apu::RegNR21, 0x3E);
+    _apu.write(gb::Apu::RegNR24, 0xC0);
+    EXPECT_TRUE(_apu.isChannelOn(gb::Apu::ChannelSquare2));
+
+    // Two length clocks, the first one after 8192 cycles
+    _scheduler.advanceTo(8192*2);
+    EXPECT_TRUE(_apu.isChannelOn(gb::Apu::ChannelSquare2));
+    _scheduler.advanceTo(8192*3);
+    EXPECT_EQ(0xF0, _apu.read(gb::Apu::RegNR52));
+}
+
+TEST_F(ApuTest, SampleCount)
+{
+    std::vector<int16_t> out = _run(gb::Apu::ClockRate);
+    EXPECT_NEAR(2*48000, out.size(), 2*32);
+}
+
+TEST_F(ApuTest, SquareWave)
+{
+    // 131072/(2048 - 1917) = 1000.6Hz
+    _playSquare(1917);
+    std::vector<int16_t> out = _run(gb::Apu::ClockRate/2);
+
+    size_t crossings = 0;
+    int16_t maxLeft = 0;
+    int16_t maxRight = 0;
+    for (size_t i = 2; i < out.size(); i += 2) {
+        if ((out[i] < 0) != (out[i - 2] < 0)) {
+            ++crossings;
+        }
+        maxLeft = std::max<int16_t>(maxLeft, std::abs(out[i]));
+        maxRight = std::max<int16_t>(maxRight, std::abs(out[i + 1]));
+    }
+
+    EXPECT_NEAR(1000, crossings, 10);
+    EXPECT_GT(maxLeft, 1000);
+    EXPECT_GT(maxRight, 1000);
+
+    // Panned left only, once the high pass filter has settled
+    _apu.write(gb::Apu::RegNR51, 0x20);
+    out = _run(gb::Apu::ClockRate/10);
+    maxRight = 0;
+    for (size_t i = out.size()/4*2; i < out.size(); i += 2) {
+        maxRight = std::max<int16_t>(maxRight, std::abs(out[i + 1]));
+    }
+    EXPECT_LT(maxRight, 50);
+}
+
+TEST_F(ApuTest, SampleRateChange)
+{
+    _run(gb::Apu::ClockRate/4);
+    _apu.setSampleRate(44100);
+    std::vector<int16_t> out = _run(gb::Apu::ClockRate);
+    EXPECT_NEAR(2*44100, out.size(), 2*32);
+}
@@ -0,0 +1,135 @@
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <chrono>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "util/audio.h"
+
+namespace {
+
+std::vector<char> readFile(const std::string& path)
+{
+    std::ifstream in(path, std::ios_base::binary);
+    return std::vector<char>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+uint32_t getU32(const std::vector<char>& data, size_t offset)
+{
+    uint32_t val = 0;
+    for (int i = 0; i < 4; ++i) {
+        val |= static_cast<uint32_t>(static_cast<unsigned char>(data[offset + i])) << (8*i);
+    }
+    return val;
+}
+
+}
+
+TEST(AudioTest, WavWriter)
+{
+    std::string path = testing::TempDir() + "audio_test.wav";
+    {
+        gb::WavWriter writer(path, 48000);
+        ASSERT_TRUE(writer.isOpen());
+        int16_t samples[6] = {1, -1, 2, -2, 0x1234, 0x5678};
+        writer.consume(samples, 3);
+        EXPECT_EQ(3, writer.framesWritten());
+    }
+
+    std::vector<char> data = readFile(path);
+    ASSERT_EQ(44 + 12, data.size());
+    EXPECT_EQ("RIFF", std::string(data.begin(), data.begin() + 4));
+    EXPECT_EQ(36 + 12, getU32(data, 4));
+    EXPECT_EQ(48000, getU32(data, 24));
+    EXPECT_EQ(12, getU32(data, 40));
+    EXPECT_EQ(0x34, static_cast<unsigned char>(data[52]));
+    EXPECT_EQ(0x56, static_cast<unsigned char>(data[55]));
+
+    std::remove(path.c_str());
+}
+
+class CountingSink : public gb::AudioSink
+{
+public:
+    CountingSink() : frames(0), isFinished(false), isOrdered(true), _next(0) {}
+
+    virtual void consume(const int16_t* samples, size_t count) override
+    {
+        for (size_t i = 0; i < 2*count; ++i) {
+            isOrdered = isOrdered && samples[i] == static_cast<int16_t>(_next++);
+        }
+        frames += count;
+    }
+
+    virtual void finish() override
+    {
+        isFinished = true;
+    }
+
+    size_t frames;
+    bool isFinished;
+    bool isOrdered;
+
+private:
+    int _next;
+};
+
+TEST(AudioTest, OutputDrains)
+{
+    gb::AudioRing ring(256);
+    CountingSink sink;
+    gb::AudioOutput output(&ring, &sink, 48000, 32, false);
+
+    std::vector<int16_t> samples(20000);
+    for (size_t i = 0; i < samples.size(); ++i) {
+        samples[i] = static_cast<int16_t>(i);
+    }
+
+    size_t written = 0;
+    while (written < samples.size()) {
+        written += ring.write(samples.data() + written, samples.size() - written);
+    }
+    output.close();
+
+    EXPECT_EQ(10000, sink.frames);
+    EXPECT_TRUE(sink.isOrdered);
+    EXPECT_TRUE(sink.isFinished);
+    EXPECT_EQ(0, output.underruns());
+}
+
+TEST(AudioTest, RealTimeUnderrun)
+{
+    gb::AudioRing ring(256);
+    CountingSink sink;
+    gb::AudioOutput output(&ring, &sink, 48000, 48, true);
+
+    // Nothing is written, so the sink gets silence
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    output.close();
+
+    EXPECT_GT(output.underruns(), 0);
+    EXPECT_EQ(0, sink.frames % 48);
+}
+
+TEST(AudioTest, RateController)
+{
+    gb::RateController controller(48000);
+    EXPECT_EQ(48000, controller.update(0.5));
+
+    // A draining ring speeds up production, a filling one slows it
+    unsigned rate = 0;
+    for (int i = 0; i < 100; ++i) {
+        rate = controller.update(0.0);
+    }
+    EXPECT_GT(rate, 48000);
+    EXPECT_LE(rate, 48240);
+
+    for (int i = 0; i < 100; ++i) {
+        rate = controller.update(1.0);
+    }
+    EXPECT_LT(rate, 48000);
+    EXPECT_GE(rate, 47760);
+}
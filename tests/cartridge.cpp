@@ -0,0 +1,221 @@
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "cpu/cartridge.h"
+#include "cpu/mmu.h"
+#include "cpu/scheduler.h"
+
+class CartridgeTest : public testing::Test
+{
+protected:
+
+    /**
+     * Builds a ROM where the first byte of every bank holds the bank number.
+     */
+    std::vector<gb::Byte> _makeRom(gb::Byte type, size_t banks, gb::Byte ramSizeCode)
+    {
+        std::vector<gb::Byte> rom(banks*gb::Cartridge::RomBankSize, 0x00);
+        for (size_t i = 0; i < banks; ++i) {
+            rom[i*gb::Cartridge::RomBankSize] = i & 0xFF;
+            rom[i*gb::Cartridge::RomBankSize + 1] = i >> 8;
+        }
+
+        std::string title = "TESTCART";
+        std::copy(title.begin(), title.end(), rom.begin() + 0x134);
+        rom[0x147] = type;
+        rom[0x149] = ramSizeCode;
+        return rom;
+    }
+
+    size_t _bankAt(size_t address)
+    {
+        return _mmu.read(address) | (_mmu.read(address + 1) << 8);
+    }
+
+    gb::MMU _mmu;
+};
+
+TEST_F(CartridgeTest, Header)
+{
+    gb::Cartridge cart(_makeRom(0x13, 8, 0x03));
+    EXPECT_EQ("TESTCART", cart.title());
+    EXPECT_EQ(gb::Cartridge::Mbc3, cart.mbc());
+    EXPECT_TRUE(cart.hasBattery());
+    EXPECT_TRUE(cart.isSupported());
+    EXPECT_EQ(8, cart.romBanks());
+    EXPECT_EQ(4, cart.ramBanks());
+
+    gb::Cartridge unsupported(_makeRom(0x05, 2, 0x00));
+    EXPECT_FALSE(unsupported.isSupported());
+
+    // Tiny ROMs are padded to the two fixed banks
+    gb::Cartridge tiny(std::vector<gb::Byte>(32, 0x00));
+    EXPECT_EQ(gb::Cartridge::MbcNone, tiny.mbc());
+    EXPECT_EQ(2, tiny.romBanks());
+    EXPECT_EQ(0, tiny.ramBanks());
+}
+
+TEST_F(CartridgeTest, NoMbc)
+{
+    gb::Cartridge cart(_makeRom(0x00, 2, 0x00));
+    cart.attach(&_mmu);
+
+    EXPECT_EQ(0, _bankAt(0x0000));
+    EXPECT_EQ(1, _bankAt(0x4000));
+
+    // ROM writes don't modify it, RAM reads as open bus
+    _mmu.write(0x4000, 0x55);
+    EXPECT_EQ(1, _bankAt(0x4000));
+    EXPECT_EQ(0xFF, _mmu.read(0xA000));
+}
+
+TEST_F(CartridgeTest, Mbc1)
+{
+    gb::Cartridge cart(_makeRom(0x03, 128, 0x03));
+    cart.attach(&_mmu);
+
+    _mmu.write(0x2000, 0x05);
+    EXPECT_EQ(5, _bankAt(0x4000));
+    EXPECT_EQ(cart.rom().data() + 5*gb::Cartridge::RomBankSize, _mmu.directData(0x4000, 0x4000));
+
+    // Bank 0 selects 1
+    _mmu.write(0x2000, 0x00);
+    EXPECT_EQ(1, _bankAt(0x4000));
+
+    // Upper bits
+    _mmu.write(0x2000, 0x03);
+    _mmu.write(0x4000, 0x02);
+    EXPECT_EQ(0x43, _bankAt(0x4000));
+    EXPECT_EQ(0, _bankAt(0x0000));
+
+    // Advanced mode also switches the low window
+    _mmu.write(0x6000, 0x01);
+    EXPECT_EQ(0x40, _bankAt(0x0000));
+    _mmu.write(0x6000, 0x00);
+    EXPECT_EQ(0, _bankAt(0x0000));
+}
+
+TEST_F(CartridgeTest, Mbc1Ram)
+{
+    gb::Cartridge cart(_makeRom(0x03, 4, 0x03));
+    cart.attach(&_mmu);
+
+    _mmu.write(0xA000, 0x12);
+    EXPECT_EQ(0xFF, _mmu.read(0xA000));
+
+    _mmu.write(0x0000, 0x0A);
+    _mmu.write(0xA000, 0x12);
+    EXPECT_EQ(0x12, _mmu.read(0xA000));
+    EXPECT_EQ(0x12, cart.ram()[0x0000]);
+
+    // RAM banks only switch in advanced mode
+    _mmu.write(0x4000, 0x02);
+    _mmu.write(0xA000, 0x34);
+    EXPECT_EQ(0x34, cart.ram()[0x0000]);
+    _mmu.write(0x6000, 0x01);
+    _mmu.write(0xA000, 0x56);
+    EXPECT_EQ(0x56, cart.ram()[2*gb::Cartridge::RamBankSize]);
+
+    _mmu.write(0x0000, 0x00);
+    EXPECT_EQ(0xFF, _mmu.read(0xA000));
+}
+
+TEST_F(CartridgeTest, Mbc3)
+{
+    gb::Cartridge cart(_makeRom(0x13, 128, 0x03));
+    cart.attach(&_mmu);
+
+    _mmu.write(0x2000, 0x7F);
+    EXPECT_EQ(0x7F, _bankAt(0x4000));
+    _mmu.write(0x2000, 0x00);
+    EXPECT_EQ(1, _bankAt(0x4000));
+
+    _mmu.write(0x0000, 0x0A);
+    _mmu.write(0x4000, 0x03);
+    _mmu.write(0xA000, 0x99);
+    EXPECT_EQ(0x99, cart.ram()[3*gb::Cartridge::RamBankSize]);
+
+    // Clock registers aren't RAM
+    _mmu.write(0x4000, 0x08);
+    EXPECT_NE(0x99, _mmu.read(0xA000));
+}
+
+TEST_F(CartridgeTest, Mbc5)
+{
+    gb::Cartridge cart(_makeRom(0x1B, 512, 0x04));
+    cart.attach(&_mmu);
+
+    // Bank 0 can be mapped in the switchable window
+    _mmu.write(0x2000, 0x00);
+    EXPECT_EQ(0, _bankAt(0x4000));
+
+    _mmu.write(0x2000, 0x23);
+    _mmu.write(0x3000, 0x01);
+    EXPECT_EQ(0x123, _bankAt(0x4000));
+
+    _mmu.write(0x0000, 0x0A);
+    _mmu.write(0x4000, 0x0F);
+    _mmu.write(0xA123, 0x42);
+    EXPECT_EQ(0x42, cart.ram()[15*gb::Cartridge::RamBankSize + 0x123]);
+}
+
+TEST_F(CartridgeTest, Save)
+{
+    std::string path = testing::TempDir() + "cartridge_save.sav";
+    std::remove(path.c_str());
+
+    std::vector<gb::Byte> rom = _makeRom(0x1B, 4, 0x03);
+    {
+        gb::Cartridge cart(rom);
+        ASSERT_TRUE(cart.loadSave(path));
+        cart.attach(&_mmu);
+
+        // Still mapped directly
+        _mmu.write(0x0000, 0x0A);
+        _mmu.write(0x4000, 0x02);
+        EXPECT_EQ(cart.ram().data() + 2*gb::Cartridge::RamBankSize, _mmu.directData(0xA000, 0x2000));
+        _mmu.write(0xA010, 0x5A);
+        _mmu.write(0x0000, 0x00);
+    }
+
+    gb::Cartridge cart(rom);
+    ASSERT_TRUE(cart.loadSave(path));
+    EXPECT_TRUE(cart.hasSave());
+    EXPECT_EQ(0x5A, cart.ram()[2*gb::Cartridge::RamBankSize + 0x10]);
+
+    gb::Cartridge noRam(_makeRom(0x1B, 4, 0x00));
+    EXPECT_FALSE(noRam.loadSave(path));
+    EXPECT_FALSE(noRam.hasSave());
+
+    std::remove(path.c_str());
+}
+
+TEST_F(CartridgeTest, Mbc3Rtc)
+{
+    gb::Scheduler scheduler;
+    gb::Cartridge cart(_makeRom(0x10, 4, 0x03));
+    EXPECT_TRUE(cart.hasRtc());
+    cart.rtc().setScheduler(&scheduler);
+    cart.attach(&_mmu);
+
+    scheduler.advanceTo(42*gb::Rtc::CyclesPerSecond);
+    _mmu.write(0x0000, 0x0A);
+    _mmu.write(0x6000, 0x00);
+    _mmu.write(0x6000, 0x01);
+
+    _mmu.write(0x4000, 0x08);
+    EXPECT_EQ(42, _mmu.read(0xA000));
+    EXPECT_EQ(42, _mmu.read(0xBFFF));
+    _mmu.write(0x4000, 0x09);
+    EXPECT_EQ(0, _mmu.read(0xA000));
+    _mmu.write(0xA000, 30);
+    EXPECT_EQ(30, _mmu.read(0xA000));
+
+    // Back to RAM
+    _mmu.write(0x4000, 0x00);
+    _mmu.write(0xA000, 0x77);
+    EXPECT_EQ(0x77, cart.ram()[0x0000]);
+}
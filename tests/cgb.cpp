@@ -0,0 +1,114 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "cpu/cartridge.h"
+#include "cpu/gameboy.h"
+
+class CgbTest : public testing::Test
+{
+protected:
+
+    CgbTest() :
+        _cartridge(_makeRom())
+    {
+        _gameBoy.insertCartridge(&_cartridge);
+    }
+
+    static std::vector<gb::Byte> _makeRom()
+    {
+        std::vector<gb::Byte> rom(0x8000, 0x00);
+        rom[0x143] = 0xC0;
+        return rom;
+    }
+
+    gb::Cartridge _cartridge;
+    gb::GameBoy _gameBoy;
+};
+
+TEST_F(CgbTest, VramBanks)
+{
+    gb::MMU& mmu = _gameBoy.mmu();
+    EXPECT_TRUE(_gameBoy.cgb().isEnabled());
+    EXPECT_EQ(0xFE, mmu.read(0xFF4F));
+
+    mmu.write(0x8010, 0x11);
+    mmu.write(0xFF4F, 0x01);
+    EXPECT_EQ(0xFF, mmu.read(0xFF4F));
+    EXPECT_EQ(0x00, mmu.read(0x8010));
+    mmu.write(0x9FFF, 0x22);
+    EXPECT_EQ(0x22, _gameBoy.vram()[0x3FFF]);
+
+    mmu.write(0xFF4F, 0x00);
+    EXPECT_EQ(0x11, mmu.read(0x8010));
+    EXPECT_EQ(0x00, mmu.read(0x9FFF));
+}
+
+TEST_F(CgbTest, WramBanks)
+{
+    gb::MMU& mmu = _gameBoy.mmu();
+    mmu.write(0xD000, 0x11);
+
+    mmu.write(0xFF70, 0x05);
+    EXPECT_EQ(0xFD, mmu.read(0xFF70));
+    EXPECT_EQ(5, _gameBoy.cgb().wramBank());
+    mmu.write(0xD000, 0x55);
+    EXPECT_EQ(0x55, _gameBoy.wram()[0x5000]);
+    EXPECT_EQ(0x55, mmu.read(0xF000));
+
+    // Bank 0 selects bank 1, bank 0 itself stays at 0xC000
+    mmu.write(0xFF70, 0x00);
+    EXPECT_EQ(0xF8, mmu.read(0xFF70));
+    EXPECT_EQ(0x11, mmu.read(0xD000));
+    mmu.write(0xC000, 0x33);
+    EXPECT_EQ(0x33, mmu.read(0xE000));
+}
+
+TEST_F(CgbTest, SpeedSwitch)
+{
+    // LD A,1; LDH (KEY1),A; STOP; NOP...
+    gb::Memory& rom = _cartridge.rom();
+    rom[0x0000] = 0x3E;
+    rom[0x0001] = 0x01;
+    rom[0x0002] = 0xE0;
+    rom[0x0003] = 0x4D;
+    rom[0x0004] = 0x10;
+
+    gb::Cpu& cpu = _gameBoy.cpu();
+    gb::MMU& mmu = _gameBoy.mmu();
+    cpu.processNextInstruction();
+    cpu.processNextInstruction();
+    EXPECT_EQ(0x7F, mmu.read(0xFF4D));
+    cpu.processNextInstruction();
+    EXPECT_FALSE(cpu.isStopped());
+    EXPECT_TRUE(cpu.isDoubleSpeed());
+    EXPECT_EQ(0xFE, mmu.read(0xFF4D));
+
+    // Instructions now take half as long on the peripheral clock, and DIV
+    // follows the CPU
+    mmu.write(0xFF04, 0x00);
+    uint64_t start = cpu.cycles();
+    uint64_t clock = cpu.clock();
+    while (cpu.cycles() - start < 4096) {
+        cpu.processNextInstruction();
+    }
+    EXPECT_EQ(clock + 2048, cpu.clock());
+    EXPECT_EQ(cpu.clock(), _gameBoy.scheduler().now());
+    EXPECT_EQ(0x10, mmu.read(0xFF04));
+}
+
+TEST_F(CgbTest, DisabledOnDmg)
+{
+    gb::Cartridge cartridge(std::vector<gb::Byte>(0x8000, 0x00));
+    gb::GameBoy gameBoy;
+    gameBoy.insertCartridge(&cartridge);
+
+    gb::MMU& mmu = gameBoy.mmu();
+    EXPECT_FALSE(gameBoy.cgb().isEnabled());
+    mmu.write(0xFF4F, 0x01);
+    mmu.write(0xFF70, 0x03);
+    EXPECT_EQ(0xFF, mmu.read(0xFF4F));
+    EXPECT_EQ(0xFF, mmu.read(0xFF70));
+    EXPECT_EQ(0, gameBoy.cgb().vramBank());
+    EXPECT_EQ(1, gameBoy.cgb().wramBank());
+}
@@ -1,7 +1,10 @@
 #include <gtest/gtest.h>
 
 #include "cpu/cpu.h"
+#include "cpu/interrupts.h"
 #include "cpu/memory.h"
+#include "cpu/scheduler.h"
+#include "cpu/timer.h"
 #include "util/units.h"
 #include "util/util.h"
 
@@ -79,6 +82,52 @@ TEST_F(CpuTest, PCIncTest)
     EXPECT_EQ(0x03, _cpu.registers().PC);
 }
 
+TEST_F(CpuTest, CyclesTest)
+{
+    // NOP
+    _loadAndExecute(0x00);
+    EXPECT_EQ(4, _cpu.cycles());
+
+    // LD A,(HL)
+    _loadAndExecute(0x7E);
+    EXPECT_EQ(12, _cpu.cycles());
+
+    // JR NZ,(PC+e) not taken then taken
+    _cpu.registers().F = 0x80;
+    _loadAndExecute(0x20, 0x00);
+    EXPECT_EQ(20, _cpu.cycles());
+    _cpu.registers().F = 0x00;
+    _loadAndExecute(0x20, 0x00);
+    EXPECT_EQ(32, _cpu.cycles());
+
+    // CB RLC B, BIT 0,(HL), SET 0,(HL)
+    _loadAndExecute(0xCB, 0x00);
+    EXPECT_EQ(40, _cpu.cycles());
+    _loadAndExecute(0xCB, 0x46);
+    EXPECT_EQ(52, _cpu.cycles());
+    _loadAndExecute(0xCB, 0xC6);
+    EXPECT_EQ(68, _cpu.cycles());
+
+    // CALL (nn)
+    _cpu.registers().SP = 0xFF00;
+    _loadAndExecute(0xCD, 0x00, 0x10);
+    EXPECT_EQ(92, _cpu.cycles());
+
+    _cpu.reset();
+    EXPECT_EQ(0, _cpu.cycles());
+}
+
+TEST_F(CpuTest, InstructionsTest)
+{
+    // A CB prefixed instruction counts once
+    _loadAndExecute(0x00);
+    _loadAndExecute(0xCB, 0x00);
+    EXPECT_EQ(2, _cpu.instructions());
+
+    _cpu.reset();
+    EXPECT_EQ(0, _cpu.instructions());
+}
+
 TEST_F(CpuTest, Opcode0x00Test)
 {
     // NOP
@@ -183,13 +232,21 @@ TEST_F(CpuTest, Opcode0x07Test)
     _loadAndExecute(0x07);
     EXPECT_EQ(18, _cpu.registers().A);
     EXPECT_FLAGS(0,0,0,0);
+
+    // z is cleared even for a zero result
+    _cpu.registers().A = 0;
+    _loadAndExecute(0x07);
+    EXPECT_EQ(0, _cpu.registers().A);
+    EXPECT_FLAGS(0,0,0,0);
 }
 
 TEST_F(CpuTest, Opcode0x08Test)
 {
     // LD (nn),SP
+    _cpu.registers().SP = 0xABCD;
     _loadAndExecute(0x08, 0x10, 0xF0);
-    EXPECT_EQ(_cpu.registers().SP, _mem[0xF010]);
+    EXPECT_EQ(0xCD, _mem[0xF010]);
+    EXPECT_EQ(0xAB, _mem[0xF011]);
     EXPECT_FLAGS(0,0,0,0);
 }
 
@@ -746,6 +803,13 @@ TEST_F(CpuTest, Opcode0x27Test)
     _loadAndExecute(0x27);
     EXPECT_EQ(0x00, _cpu.registers().A);
     EXPECT_FLAGS(1,1,0,1);
+
+    // Outside of the table, a subtract with a borrow keeps c
+    _cpu.registers().A = 0x00;
+    _cpu.registers().F = 0x50;
+    _loadAndExecute(0x27);
+    EXPECT_EQ(0xA0, _cpu.registers().A);
+    EXPECT_FLAGS(0,1,0,1);
 }
 
 TEST_F(CpuTest, Opcode0x28Test)
@@ -2920,11 +2984,12 @@ TEST_F(CpuTest, Opcode0x9FTest)
     EXPECT_EQ(0xFF, _cpu.registers().A);
     EXPECT_FLAGS(0,1,1,1);
 
+    // The carry in borrows from both nibbles
     _cpu.registers().F = 0xFF;
     _cpu.registers().A = 0xFF;
     _loadAndExecute(0x9F);
     EXPECT_EQ(0xFF, _cpu.registers().A);
-    EXPECT_FLAGS(0,1,0,0);
+    EXPECT_FLAGS(0,1,1,1);
 }
 
 TEST_F(CpuTest, Opcode0xA0Test)
@@ -6995,6 +7060,13 @@ TEST_F(CpuTest, Opcode0xCETest)
     _loadAndExecute(0xCE, 0x01);
     EXPECT_EQ(0x00, _cpu.registers().A);
     EXPECT_FLAGS(1,0,1,1);
+
+    // A carry in of 0xFF wraps to 0x00 but still carries
+    _cpu.registers().F = 0xFF;
+    _cpu.registers().A = 0x01;
+    _loadAndExecute(0xCE, 0xFF);
+    EXPECT_EQ(0x01, _cpu.registers().A);
+    EXPECT_FLAGS(0,0,1,1);
 }
 
 TEST_F(CpuTest, Opcode0xCFTest)
@@ -7357,25 +7429,26 @@ TEST_F(CpuTest, Opcode0xE8Test)
     EXPECT_EQ(val, _cpu.registers().SP);
     EXPECT_FLAGS(0,0,0,0);
 
+    // Flags come from adding the unsigned offset to the low byte
     val = _cpu.registers().SP - 100;
     _loadAndExecute(0xE8, gb::toSigned8(-100));
     EXPECT_EQ(val, _cpu.registers().SP);
-    EXPECT_FLAGS(0,0,0,0);
+    EXPECT_FLAGS(0,0,1,1);
 
     _cpu.registers().SP = 0x0F0F;
 
     val = _cpu.registers().SP + gb::toSigned8(0x11);
     _loadAndExecute(0xE8, gb::toSigned8(0x11));
     EXPECT_EQ(val, _cpu.registers().SP);
-    EXPECT_FLAGS(0,0,0,0);
+    EXPECT_FLAGS(0,0,1,0);
 
-    // Not a half carry -- only applies to highest byte
+    // Half carry out of the low nibble
     _cpu.registers().SP = 0x000F;
 
     val = _cpu.registers().SP + gb::toSigned8(1);
     _loadAndExecute(0xE8, gb::toSigned8(1));
     EXPECT_EQ(val, _cpu.registers().SP);
-    EXPECT_FLAGS(0,0,0,0);
+    EXPECT_FLAGS(0,0,1,0);
 
     // Full carry
     _cpu.registers().SP = 0xFFFF;
@@ -7385,20 +7458,20 @@ TEST_F(CpuTest, Opcode0xE8Test)
     EXPECT_EQ(val, _cpu.registers().SP);
     EXPECT_FLAGS(0,0,1,1);
 
-    // Underflow carry
+    // Underflow of SP doesn't carry, 0x0A + 0xF4 fits in the low byte
     _cpu.registers().SP = 0x000A;
 
     val = _cpu.registers().SP - 12;
     _loadAndExecute(0xE8, gb::toSigned8(-12));
     EXPECT_EQ(val, _cpu.registers().SP);
-    EXPECT_FLAGS(0,0,1,1);
+    EXPECT_FLAGS(0,0,0,0);
 }
 
 TEST_F(CpuTest, Opcode0xE9Test)
 {
     // JP (HL)
     _loadAndExecute(0xE9);
-    EXPECT_EQ(_mem[_cpu.registers().HL], _cpu.registers().PC);
+    EXPECT_EQ(_cpu.registers().HL, _cpu.registers().PC);
     EXPECT_FLAGS(0,0,0,0);
 }
 
@@ -7455,7 +7528,7 @@ TEST_F(CpuTest, Opcode0xF1Test)
     _mem[0x0038] = 0xFE;
     _loadAndExecute(0xF1);
     EXPECT_EQ(0xAB, _cpu.registers().A);
-    EXPECT_EQ(0xFE, _cpu.registers().F);
+    EXPECT_EQ(0xF0, _cpu.registers().F);
     EXPECT_EQ(_cpu.registers().SP, 0x003A);
     EXPECT_FLAGS(1,1,1,1);
 }
@@ -7526,25 +7599,26 @@ TEST_F(CpuTest, Opcode0xF8Test)
     EXPECT_EQ(val, _cpu.registers().HL);
     EXPECT_FLAGS(0,0,0,0);
 
+    // Flags come from adding the unsigned offset to the low byte
     val = _cpu.registers().SP - 100;
     _loadAndExecute(0xF8, gb::toSigned8(-100));
     EXPECT_EQ(val, _cpu.registers().HL);
-    EXPECT_FLAGS(0,0,0,0);
+    EXPECT_FLAGS(0,0,1,0);
 
     _cpu.registers().SP = 0x0FF0;
 
     val = _cpu.registers().SP + gb::toSigned8(0x0010);
     _loadAndExecute(0xF8, gb::toSigned8(0x0010));
     EXPECT_EQ(val, _cpu.registers().HL);
-    EXPECT_FLAGS(0,0,1,0);
+    EXPECT_FLAGS(0,0,0,1);
 
-    // Not a half carry -- only applies to highest byte
+    // Half carry out of the low nibble
     _cpu.registers().SP = 0x000F;
 
     val = _cpu.registers().SP + gb::toSigned8(1);
     _loadAndExecute(0xF8, gb::toSigned8(1));
     EXPECT_EQ(val, _cpu.registers().HL);
-    EXPECT_FLAGS(0,0,0,0);
+    EXPECT_FLAGS(0,0,1,0);
 
     // Full carry
     _cpu.registers().SP = 0xFFFF;
@@ -7554,13 +7628,13 @@ TEST_F(CpuTest, Opcode0xF8Test)
     EXPECT_EQ(val, _cpu.registers().HL);
     EXPECT_FLAGS(0,0,1,1);
 
-    // Underflow carry
+    // Underflow of SP doesn't carry, 0x0A + 0xF4 fits in the low byte
     _cpu.registers().SP = 0x000A;
 
     val = _cpu.registers().SP - 12;
     _loadAndExecute(0xF8, gb::toSigned8(-12));
     EXPECT_EQ(val, _cpu.registers().HL);
-    EXPECT_FLAGS(0,0,1,1);
+    EXPECT_FLAGS(0,0,0,0);
 }
 
 TEST_F(CpuTest, Opcode0xF9Test)
@@ -7622,3 +7696,55 @@ TEST_F(CpuTest, Opcode0xFFTest)
     EXPECT_FLAGS(0,0,0,0);
 }
 
+
+TEST_F(CpuTest, InterruptTest)
+{
+    gb::Interrupts interrupts;
+    _cpu.setInterrupts(&interrupts);
+    interrupts.write(gb::Interrupts::RegIE, 0x1F);
+
+    // Nothing serviced while IME is off
+    interrupts.request(gb::Interrupts::InterruptTimer);
+    _loadAndExecute(0x00);
+    EXPECT_EQ(0x0001, _cpu.registers().PC);
+
+    _cpu.setInterruptsEnabled(true);
+    interrupts.request(gb::Interrupts::InterruptVBlank);
+    _cpu.registers().SP = 0xFF00;
+    _cpu.processNextInstruction();
+    EXPECT_EQ(0x0040, _cpu.registers().PC);
+    EXPECT_EQ(0xFEFE, _cpu.registers().SP);
+    EXPECT_EQ(0x01, (int)_mem[0xFEFE]);
+    EXPECT_FALSE(_cpu.interruptsEnabled());
+    EXPECT_EQ(1 << gb::Interrupts::InterruptTimer, interrupts.pending());
+
+    _cpu.setInterruptsEnabled(true);
+    _cpu.processNextInstruction();
+    EXPECT_EQ(0x0050, _cpu.registers().PC);
+    EXPECT_EQ(0x00, interrupts.pending());
+}
+
+TEST_F(CpuTest, HaltWaitsForEventTest)
+{
+    gb::Scheduler scheduler;
+    gb::Interrupts interrupts;
+    gb::Timer timer(&scheduler, &interrupts);
+    _cpu.setScheduler(&scheduler);
+    _cpu.setInterrupts(&interrupts);
+    _cpu.setInterruptsEnabled(true);
+    interrupts.write(gb::Interrupts::RegIE, 0x1F);
+
+    timer.write(gb::Timer::RegTIMA, 0xFF);
+    timer.write(gb::Timer::RegTAC, 0x04);
+
+    // HALT, then the wait skips straight to the TIMA overflow at 1024
+    _loadAndExecute(0x76);
+    EXPECT_TRUE(_cpu.isHalted());
+    _cpu.processNextInstruction();
+    EXPECT_EQ(1024, _cpu.cycles());
+    EXPECT_EQ(1024, scheduler.now());
+
+    _cpu.processNextInstruction();
+    EXPECT_FALSE(_cpu.isHalted());
+    EXPECT_EQ(0x0050, _cpu.registers().PC);
+}
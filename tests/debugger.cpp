@@ -0,0 +1,95 @@
+#include <gtest/gtest.h>
+
+#include "cpu/cpu.h"
+#include "cpu/debugger.h"
+#include "cpu/memory.h"
+#include "cpu/mmu.h"
+
+class DebuggerTest : public testing::Test
+{
+protected:
+
+    DebuggerTest() :
+        _mem(0x10000),
+        _debugger(&_cpu, &_mmu)
+    {
+        _mmu.map(&_mem, gb::Range(0x0000, 0xFFFF), gb::Range(0x0000, 0xFFFF));
+        std::fill(_mem.data(), _mem.data() + _mem.size(), 0x00);
+        _cpu.setMemory(&_mmu);
+
+        // loop: INC A; LD (0xC000),A; JR loop
+        gb::Byte program[] = {0x3C, 0xEA, 0x00, 0xC0, 0x18, 0xFA};
+        std::copy(program, program + sizeof(program), _mem.data() + 0x100);
+        _cpu.registers().PC = 0x100;
+    }
+
+    gb::MMU _mmu;
+    gb::Memory _mem;
+    gb::Cpu _cpu;
+    gb::Debugger _debugger;
+};
+
+TEST_F(DebuggerTest, Breakpoint)
+{
+    _debugger.addBreakpoint(0x0101);
+    EXPECT_EQ(gb::Debugger::StopBreakpoint, _debugger.run(1000));
+    EXPECT_EQ(0x0101, _cpu.registers().PC);
+    EXPECT_EQ(0x01, _cpu.registers().A);
+
+    // Continuing steps over the breakpoint it stopped on
+    EXPECT_EQ(gb::Debugger::StopBreakpoint, _debugger.run(1000));
+    EXPECT_EQ(0x02, _cpu.registers().A);
+
+    _debugger.removeBreakpoint(0x0101);
+    EXPECT_FALSE(_debugger.hasBreakpoint(0x0101));
+    EXPECT_EQ(gb::Debugger::StopNone, _debugger.run(1000));
+    EXPECT_GE(_cpu.cycles(), 1000);
+}
+
+TEST_F(DebuggerTest, DoubleSpeed)
+{
+    // The limit is on the machine clock, which runs at half the CPU's rate
+    _cpu.setDoubleSpeed(true);
+    EXPECT_EQ(gb::Debugger::StopNone, _debugger.run(1000));
+    EXPECT_GE(_cpu.clock(), 1000);
+    EXPECT_GE(_cpu.cycles(), 2000);
+}
+
+TEST_F(DebuggerTest, Condition)
+{
+    _debugger.addBreakpoint(0x0104, [](const gb::Cpu::Registers& regs) { return regs.A == 5; });
+    EXPECT_EQ(gb::Debugger::StopBreakpoint, _debugger.run(1000));
+    EXPECT_EQ(0x05, _cpu.registers().A);
+}
+
+TEST_F(DebuggerTest, Watchpoint)
+{
+    _debugger.addWatchpoint(0xC000, gb::MMU::AccessWrite);
+    EXPECT_EQ(nullptr, _mmu.directData(0xC000, 1));
+
+    EXPECT_EQ(gb::Debugger::StopWatchpoint, _debugger.run(1000));
+    EXPECT_EQ(0xC000, _debugger.watchAddress());
+    EXPECT_EQ(gb::MMU::AccessWrite, _debugger.watchAccess());
+    EXPECT_EQ(0x01, _debugger.watchValue());
+    EXPECT_EQ(0x01, _mem[0xC000]);
+    EXPECT_EQ(0x0104, _cpu.registers().PC);
+
+    // Reads of the page still go through, and aren't reported
+    _mmu.write(0xC001, 0x22);
+    EXPECT_EQ(0x22, _mmu.read(0xC001));
+
+    _debugger.removeWatchpoint(0xC000, gb::MMU::AccessWrite);
+    EXPECT_FALSE(_mmu.hasWatches());
+    EXPECT_EQ(_mem.data() + 0xC000, _mmu.directData(0xC000, 1));
+    EXPECT_EQ(gb::Debugger::StopNone, _debugger.run(1000));
+}
+
+TEST_F(DebuggerTest, ReadWatchpoint)
+{
+    // Fetching the operand of LD (nn),A reads it
+    _debugger.addWatchpoint(0x0102, gb::MMU::AccessRead);
+    EXPECT_EQ(gb::Debugger::StopNone, _debugger.step());
+    EXPECT_EQ(gb::Debugger::StopWatchpoint, _debugger.step());
+    EXPECT_EQ(0x0102, _debugger.watchAddress());
+    EXPECT_EQ(0x00, _debugger.watchValue());
+}
@@ -0,0 +1,67 @@
+#include <gtest/gtest.h>
+
+#include "cpu/dma.h"
+#include "cpu/memory.h"
+#include "cpu/mmu.h"
+#include "cpu/scheduler.h"
+
+class DmaTest : public testing::Test
+{
+protected:
+
+    DmaTest() :
+        _ram(0x2000),
+        _oam(gb::Dma::TransferSize),
+        _dma(&_mmu, &_scheduler, &_oam, gb::Range(0xFE00, 0xFE9F))
+    {
+        _mmu.map(&_ram, gb::Range(0x0000, 0x1FFF), gb::Range(0xC000, 0xDFFF));
+        _mmu.map(&_oam, gb::Range(0x00, 0x9F), gb::Range(0xFE00, 0xFE9F));
+        _mmu.map(&_dma, gb::Range(0x00, 0x00), gb::Range(0xFF46, 0xFF46));
+
+        for (size_t i = 0; i < _ram.size(); ++i) {
+            _ram[i] = i & 0xFF;
+        }
+    }
+
+    gb::Scheduler _scheduler;
+    gb::MMU _mmu;
+    gb::Memory _ram;
+    gb::Memory _oam;
+    gb::Dma _dma;
+};
+
+TEST_F(DmaTest, Transfer)
+{
+    _scheduler.advanceTo(100);
+    _mmu.write(0xFF46, 0xC1);
+    EXPECT_TRUE(_dma.isActive());
+    EXPECT_EQ(0xC1, _mmu.read(0xFF46));
+
+    // Copied up front, but hidden from the CPU until the transfer time passes
+    EXPECT_EQ(0x00, _oam[0x00]);
+    EXPECT_EQ(0x9F, _oam[0x9F]);
+    EXPECT_EQ(0xFF, _mmu.read(0xFE10));
+    _mmu.write(0xFE10, 0x55);
+    EXPECT_EQ(0x10, _oam[0x10]);
+
+    _scheduler.advanceTo(100 + gb::Dma::TransferCycles - 1);
+    EXPECT_TRUE(_dma.isActive());
+    _scheduler.advanceTo(100 + gb::Dma::TransferCycles);
+    EXPECT_FALSE(_dma.isActive());
+    EXPECT_EQ(0x10, _mmu.read(0xFE10));
+    EXPECT_EQ(_oam.data(), _mmu.directData(0xFE00, gb::Dma::TransferSize));
+}
+
+TEST_F(DmaTest, Restart)
+{
+    _mmu.write(0xFF46, 0xC0);
+    _scheduler.advanceTo(320);
+    _ram[0x1000] = 0x77;
+    _mmu.write(0xFF46, 0xD0);
+    EXPECT_EQ(0x77, _oam[0x00]);
+
+    _scheduler.advanceTo(640);
+    EXPECT_TRUE(_dma.isActive());
+    _scheduler.advanceTo(960);
+    EXPECT_FALSE(_dma.isActive());
+}
@@ -0,0 +1,147 @@
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <vector>
+
+#include "util/framedump.h"
+#include "util/units.h"
+
+TEST(FrameDumpTest, DeltaRoundTrip)
+{
+    std::vector<gb::Byte> prev(64, 0x00);
+    std::vector<gb::Byte> cur(prev);
+    cur[0] = 0x01;
+    cur[10] = 0xFF;
+    cur[11] = 0x7E;
+    cur[63] = 0x42;
+
+    std::vector<gb::Byte> encoded;
+    gb::encodeFrameDelta(prev.data(), cur.data(), cur.size(), encoded);
+    EXPECT_LT(encoded.size(), cur.size());
+
+    std::vector<gb::Byte> frame(prev);
+    EXPECT_TRUE(gb::decodeFrameDelta(encoded.data(), encoded.size(), frame.data(), frame.size()));
+    EXPECT_EQ(cur, frame);
+}
+
+TEST(FrameDumpTest, DeltaUnchanged)
+{
+    std::vector<gb::Byte> frame(1024, 0xAB);
+
+    std::vector<gb::Byte> encoded;
+    gb::encodeFrameDelta(frame.data(), frame.data(), frame.size(), encoded);
+    EXPECT_EQ(3, encoded.size());
+}
+
+TEST(FrameDumpTest, DeltaMalformed)
+{
+    std::vector<gb::Byte> frame(4, 0x00);
+    gb::Byte tooLong[] = {0x02, 0x04, 0x01, 0x01, 0x01, 0x01};
+    EXPECT_FALSE(gb::decodeFrameDelta(tooLong, sizeof(tooLong), frame.data(), frame.size()));
+
+    gb::Byte truncated[] = {0x00, 0x02, 0x01};
+    EXPECT_FALSE(gb::decodeFrameDelta(truncated, sizeof(truncated), frame.data(), frame.size()));
+}
+
+TEST(FrameDumpTest, WriteRead)
+{
+    const std::string path = "framedump_test.gbfd";
+    const size_t FrameSize = 256;
+
+    std::vector<std::vector<gb::Byte>> written;
+    std::vector<uint32_t> numbers;
+    {
+        gb::FrameDumpWriter writer(path, FrameSize);
+        ASSERT_TRUE(writer.isOpen());
+
+        for (uint32_t i = 0; i < 50; ++i) {
+            gb::Byte* buffer = writer.frameBuffer();
+            for (size_t j = 0; j < FrameSize; ++j) {
+                buffer[j] = static_cast<gb::Byte>(j < i ? i : j);
+            }
+
+            std::vector<gb::Byte> frame(buffer, buffer + FrameSize);
+            if (writer.submit(i)) {
+                written.push_back(frame);
+                numbers.push_back(i);
+            }
+        }
+
+        EXPECT_TRUE(writer.close());
+        EXPECT_FALSE(writer.hasFailed());
+        EXPECT_EQ(written.size(), writer.framesWritten());
+        EXPECT_EQ(50 - written.size(), writer.framesDropped());
+    }
+
+    gb::FrameDumpReader reader(path);
+    ASSERT_TRUE(reader.isOpen());
+    EXPECT_EQ(FrameSize, reader.frameSize());
+
+    uint32_t number = 0;
+    std::vector<gb::Byte> frame;
+    for (size_t i = 0; i < written.size(); ++i) {
+        ASSERT_TRUE(reader.next(number, frame));
+        EXPECT_EQ(numbers[i], number);
+        EXPECT_EQ(written[i], frame);
+    }
+    EXPECT_FALSE(reader.next(number, frame));
+
+    std::remove(path.c_str());
+}
+
+TEST(FrameDumpTest, Burst)
+{
+    // A burst shorter than the ring is queued whole however slow the disk is
+    const std::string path = "framedump_burst.gbfd";
+    const size_t FrameSize = 0x2000;
+    const uint32_t Burst = gb::FrameDumpWriter::NumBuffers - 1;
+    {
+        gb::FrameDumpWriter writer(path, FrameSize);
+        ASSERT_TRUE(writer.isOpen());
+
+        for (uint32_t i = 0; i < Burst; ++i) {
+            gb::Byte* buffer = writer.frameBuffer();
+            for (size_t j = 0; j < FrameSize; ++j) {
+                buffer[j] = static_cast<gb::Byte>(i + j);
+            }
+            EXPECT_TRUE(writer.submit(i));
+        }
+
+        EXPECT_TRUE(writer.close());
+        EXPECT_EQ(Burst, writer.framesWritten());
+        EXPECT_EQ(0u, writer.framesDropped());
+    }
+
+    gb::FrameDumpReader reader(path);
+    ASSERT_TRUE(reader.isOpen());
+
+    uint32_t number = 0;
+    std::vector<gb::Byte> frame;
+    for (uint32_t i = 0; i < Burst; ++i) {
+        ASSERT_TRUE(reader.next(number, frame));
+        EXPECT_EQ(i, number);
+        EXPECT_EQ(static_cast<gb::Byte>(i + FrameSize - 1), frame[FrameSize - 1]);
+    }
+    EXPECT_FALSE(reader.next(number, frame));
+
+    std::remove(path.c_str());
+}
+
+TEST(FrameDumpTest, WriteFailure)
+{
+    // Frames too big for the stream's buffer hit the full disk right away
+    const size_t FrameSize = 0x10000;
+
+    gb::FrameDumpWriter writer("/dev/full", FrameSize);
+    ASSERT_TRUE(writer.isOpen());
+
+    gb::Byte* buffer = writer.frameBuffer();
+    for (size_t i = 0; i < FrameSize; ++i) {
+        buffer[i] = static_cast<gb::Byte>(i*7 + 1);
+    }
+    writer.submit(0);
+
+    EXPECT_FALSE(writer.close());
+    EXPECT_TRUE(writer.hasFailed());
+    EXPECT_EQ(0u, writer.framesWritten());
+}
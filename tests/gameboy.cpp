@@ -0,0 +1,113 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "cpu/cartridge.h"
+#include "cpu/gameboy.h"
+
+class GameBoyTest : public testing::Test
+{
+protected:
+
+    GameBoyTest() :
+        _cartridge(std::vector<gb::Byte>(0x8000, 0x00))
+    {
+        _gameBoy.insertCartridge(&_cartridge);
+    }
+
+    gb::Cartridge _cartridge;
+    gb::GameBoy _gameBoy;
+};
+
+TEST_F(GameBoyTest, MemoryMap)
+{
+    gb::MMU& mmu = _gameBoy.mmu();
+
+    mmu.write(0xC010, 0x11);
+    EXPECT_EQ(0x11, mmu.read(0xE010));
+    mmu.write(0xFF90, 0x22);
+    EXPECT_EQ(0x22, _gameBoy.hram()[0x10]);
+    mmu.write(0x8000, 0x33);
+    EXPECT_EQ(0x33, _gameBoy.vram()[0x00]);
+    EXPECT_EQ(0xFF, mmu.read(0xFEA0));
+
+    // Registers without a device yet still hold their value
+    mmu.write(0xFF40, 0x91);
+    EXPECT_EQ(0x91, mmu.read(0xFF40));
+
+    for (size_t address = 0; address < 0x10000; ++address) {
+        EXPECT_TRUE(mmu.isValidAddress(address));
+    }
+}
+
+TEST_F(GameBoyTest, TimerInterrupt)
+{
+    // EI; HALT; at the timer vector: STOP
+    gb::Memory& rom = _cartridge.rom();
+    rom[0x0000] = 0xFB;
+    rom[0x0001] = 0x76;
+    rom[0x0050] = 0x10;
+
+    gb::MMU& mmu = _gameBoy.mmu();
+    mmu.write(0xFFFF, 0x04);
+    mmu.write(0xFF05, 0xFF);
+    mmu.write(0xFF07, 0x05);
+
+    gb::Cpu& cpu = _gameBoy.cpu();
+    cpu.registers().SP = 0xFFFE;
+    while (!cpu.isStopped() && cpu.cycles() < 10000) {
+        cpu.processNextInstruction();
+    }
+    EXPECT_TRUE(cpu.isStopped());
+    EXPECT_EQ(0x0051, cpu.registers().PC);
+}
+
+TEST(GameBoyBootTest, BootRom)
+{
+    std::vector<gb::Byte> rom(0x8000, 0x00);
+    rom[0x0000] = 0x11;
+    rom[0x0100] = 0x22;
+    gb::Cartridge cartridge(rom);
+
+    // LD A,1; LDH (0x50),A
+    std::vector<gb::Byte> image(gb::BootRom::Size, 0x00);
+    image[0x00] = 0x3E;
+    image[0x01] = 0x01;
+    image[0x02] = 0xE0;
+    image[0x03] = 0x50;
+
+    gb::GameBoy gameBoy;
+    EXPECT_FALSE(gameBoy.loadBootRom(std::vector<gb::Byte>(0x900, 0x00)));
+    EXPECT_TRUE(gameBoy.loadBootRom(image));
+    gameBoy.insertCartridge(&cartridge);
+
+    gb::MMU& mmu = gameBoy.mmu();
+    EXPECT_TRUE(gameBoy.bootRom().isMapped());
+    EXPECT_EQ(0x3E, mmu.read(0x0000));
+    EXPECT_EQ(0x22, mmu.read(0x0100));
+
+    gb::Cpu& cpu = gameBoy.cpu();
+    cpu.processNextInstruction();
+    cpu.processNextInstruction();
+    EXPECT_FALSE(gameBoy.bootRom().isMapped());
+    EXPECT_EQ(0x11, mmu.read(0x0000));
+}
+
+TEST_F(GameBoyTest, SkipBoot)
+{
+    _gameBoy.skipBoot();
+
+    gb::Cpu::Registers& regs = _gameBoy.cpu().registers();
+    EXPECT_EQ(0x01B0, regs.AF);
+    EXPECT_EQ(0x0013, regs.BC);
+    EXPECT_EQ(0x00D8, regs.DE);
+    EXPECT_EQ(0x014D, regs.HL);
+    EXPECT_EQ(0xFFFE, regs.SP);
+    EXPECT_EQ(0x0100, regs.PC);
+
+    gb::MMU& mmu = _gameBoy.mmu();
+    EXPECT_EQ(0xAB, mmu.read(0xFF04));
+    EXPECT_EQ(0x91, mmu.read(0xFF40));
+    EXPECT_EQ(0xFC, mmu.read(0xFF47));
+    EXPECT_EQ(0x77, mmu.read(0xFF24));
+}
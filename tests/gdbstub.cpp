@@ -0,0 +1,88 @@
+#include <gtest/gtest.h>
+
+#include "cpu/cpu.h"
+#include "cpu/debugger.h"
+#include "cpu/gdbstub.h"
+#include "cpu/memory.h"
+#include "cpu/mmu.h"
+
+class GdbStubTest : public testing::Test
+{
+protected:
+
+    GdbStubTest() :
+        _mem(0x10000),
+        _debugger(&_cpu, &_mmu),
+        _stub(&_cpu, &_mmu, &_debugger)
+    {
+        _mmu.map(&_mem, gb::Range(0x0000, 0xFFFF), gb::Range(0x0000, 0xFFFF));
+        std::fill(_mem.data(), _mem.data() + _mem.size(), 0x00);
+        _cpu.setMemory(&_mmu);
+
+        // loop: INC A; LD (0xC000),A; JR loop
+        gb::Byte program[] = {0x3C, 0xEA, 0x00, 0xC0, 0x18, 0xFA};
+        std::copy(program, program + sizeof(program), _mem.data() + 0x100);
+        _cpu.registers().PC = 0x100;
+    }
+
+    gb::MMU _mmu;
+    gb::Memory _mem;
+    gb::Cpu _cpu;
+    gb::Debugger _debugger;
+    gb::GdbStub _stub;
+};
+
+TEST_F(GdbStubTest, Encode)
+{
+    EXPECT_EQ("$OK#9a", gb::GdbStub::encodePacket("OK"));
+    EXPECT_EQ("$#00", gb::GdbStub::encodePacket(""));
+}
+
+TEST_F(GdbStubTest, Registers)
+{
+    _cpu.registers().AF = 0x1234;
+    _cpu.registers().SP = 0xFFFE;
+    EXPECT_EQ("3412000000000000feff0001", _stub.handlePacket("g"));
+    EXPECT_EQ("0001", _stub.handlePacket("p5"));
+
+    EXPECT_EQ("OK", _stub.handlePacket("G010002000300040005000602"));
+    EXPECT_EQ(0x0001, _cpu.registers().AF);
+    EXPECT_EQ(0x0206, _cpu.registers().PC);
+
+    EXPECT_EQ("OK", _stub.handlePacket("P1=3412"));
+    EXPECT_EQ(0x1234, _cpu.registers().BC);
+    EXPECT_EQ("E01", _stub.handlePacket("G01"));
+}
+
+TEST_F(GdbStubTest, Memory)
+{
+    EXPECT_EQ("3cea00c0", _stub.handlePacket("m100,4"));
+    EXPECT_EQ("OK", _stub.handlePacket("Mc000,2:abcd"));
+    EXPECT_EQ(0xAB, _mem[0xC000]);
+    EXPECT_EQ(0xCD, _mem[0xC001]);
+    EXPECT_EQ("E01", _stub.handlePacket("mzz"));
+}
+
+TEST_F(GdbStubTest, ContinueAndStep)
+{
+    EXPECT_EQ("S05", _stub.handlePacket("?"));
+    EXPECT_EQ("OK", _stub.handlePacket("Z0,104,1"));
+    EXPECT_EQ("S05", _stub.handlePacket("c"));
+    EXPECT_EQ(0x0104, _cpu.registers().PC);
+
+    EXPECT_EQ("S05", _stub.handlePacket("s"));
+    EXPECT_EQ(0x0100, _cpu.registers().PC);
+
+    EXPECT_EQ("OK", _stub.handlePacket("z0,104,1"));
+    EXPECT_EQ("OK", _stub.handlePacket("Z2,c000,1"));
+    EXPECT_EQ("T05watch:c000;", _stub.handlePacket("c"));
+    EXPECT_EQ(0x02, _mem[0xC000]);
+}
+
+TEST_F(GdbStubTest, Queries)
+{
+    EXPECT_EQ("PacketSize=1000", _stub.handlePacket("qSupported:multiprocess+"));
+    EXPECT_EQ("1", _stub.handlePacket("qAttached"));
+    EXPECT_EQ("", _stub.handlePacket("vMustReplyEmpty"));
+    EXPECT_EQ("OK", _stub.handlePacket("D"));
+}
@@ -0,0 +1,109 @@
+#include <gtest/gtest.h>
+
+#include "cpu/hdma.h"
+#include "cpu/memory.h"
+#include "cpu/mmu.h"
+#include "cpu/scheduler.h"
+
+class HdmaTest : public testing::Test
+{
+protected:
+
+    HdmaTest() :
+        _vram(0x2000),
+        _ram(0x2000),
+        _hdma(&_mmu, &_scheduler)
+    {
+        _mmu.map(&_vram, gb::Range(0x0000, 0x1FFF), gb::Range(0x8000, 0x9FFF));
+        _mmu.map(&_ram, gb::Range(0x0000, 0x1FFF), gb::Range(0xC000, 0xDFFF));
+        _mmu.map(&_hdma, gb::Range(0x00, 0x04), gb::Range(0xFF51, 0xFF55));
+        _hdma.setEnabled(true);
+
+        for (size_t i = 0; i < _ram.size(); ++i) {
+            _ram[i] = i & 0xFF;
+            _vram[i] = 0x00;
+        }
+    }
+
+    void _setAddresses(gb::Word source, gb::Word dest)
+    {
+        _mmu.write(0xFF51, source >> 8);
+        _mmu.write(0xFF52, source & 0xFF);
+        _mmu.write(0xFF53, dest >> 8);
+        _mmu.write(0xFF54, dest & 0xFF);
+    }
+
+    gb::Scheduler _scheduler;
+    gb::MMU _mmu;
+    gb::Memory _vram;
+    gb::Memory _ram;
+    gb::Hdma _hdma;
+};
+
+TEST_F(HdmaTest, GeneralPurpose)
+{
+    _setAddresses(0xC123, 0x8105);
+    _mmu.write(0xFF55, 0x01);
+
+    // Low nibbles of the addresses are ignored
+    EXPECT_EQ(0x20, _vram[0x100]);
+    EXPECT_EQ(0x3F, _vram[0x11F]);
+    EXPECT_EQ(0x00, _vram[0x120]);
+    EXPECT_FALSE(_hdma.isActive());
+    EXPECT_EQ(0xFF, _mmu.read(0xFF55));
+}
+
+TEST_F(HdmaTest, DestinationWraps)
+{
+    _setAddresses(0xC000, 0x9FF0);
+    _mmu.write(0xFF55, 0x01);
+    EXPECT_EQ(0x0F, _vram[0x1FFF]);
+    EXPECT_EQ(0x10, _vram[0x0000]);
+}
+
+TEST_F(HdmaTest, HBlank)
+{
+    _setAddresses(0xC000, 0x8000);
+    _mmu.write(0xFF55, 0x82);
+    EXPECT_TRUE(_hdma.isActive());
+    EXPECT_EQ(0x02, _mmu.read(0xFF55));
+    EXPECT_EQ(0x00, _vram[0x00]);
+
+    // One block at the start of each line's HBlank
+    _scheduler.advanceTo(gb::Hdma::HBlankStart);
+    EXPECT_EQ(0x0F, _vram[0x0F]);
+    EXPECT_EQ(0x00, _vram[0x10]);
+    EXPECT_EQ(0x01, _mmu.read(0xFF55));
+
+    _scheduler.advanceTo(gb::Hdma::LineCycles + gb::Hdma::HBlankStart - 1);
+    EXPECT_EQ(0x00, _vram[0x10]);
+    _scheduler.advanceTo(gb::Hdma::LineCycles + gb::Hdma::HBlankStart);
+    EXPECT_EQ(0x1F, _vram[0x1F]);
+
+    // Stopped early, the remaining length reads back with bit 7 set
+    _mmu.write(0xFF55, 0x00);
+    EXPECT_FALSE(_hdma.isActive());
+    EXPECT_EQ(0x80, _mmu.read(0xFF55));
+    _scheduler.advanceTo(gb::Hdma::FrameCycles);
+    EXPECT_EQ(0x00, _vram[0x20]);
+}
+
+TEST_F(HdmaTest, NextHBlank)
+{
+    uint64_t hblank = gb::Hdma::HBlankStart;
+    uint64_t vblank = gb::Hdma::VisibleLines*gb::Hdma::LineCycles;
+    uint64_t frame = gb::Hdma::FrameCycles;
+
+    EXPECT_EQ(hblank, gb::Hdma::nextHBlank(0));
+    EXPECT_EQ(hblank + 10, gb::Hdma::nextHBlank(hblank + 10));
+    EXPECT_EQ(frame + hblank, gb::Hdma::nextHBlank(vblank));
+}
+
+TEST_F(HdmaTest, Disabled)
+{
+    _hdma.setEnabled(false);
+    _setAddresses(0xC000, 0x8000);
+    _mmu.write(0xFF55, 0x00);
+    EXPECT_EQ(0x00, _vram[0x01]);
+    EXPECT_EQ(0xFF, _mmu.read(0xFF55));
+}
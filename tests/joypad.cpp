@@ -0,0 +1,88 @@
+#include <gtest/gtest.h>
+
+#include <thread>
+
+#include "cpu/interrupts.h"
+#include "cpu/joypad.h"
+#include "cpu/scheduler.h"
+
+class JoypadTest : public testing::Test
+{
+protected:
+
+    JoypadTest() :
+        _joypad(&_scheduler, &_interrupts)
+    {
+    }
+
+    bool _hasInterrupt()
+    {
+        return (_interrupts.read(gb::Interrupts::RegIF) & (1 << gb::Interrupts::InterruptJoypad)) != 0;
+    }
+
+    gb::Scheduler _scheduler;
+    gb::Interrupts _interrupts;
+    gb::Joypad _joypad;
+};
+
+TEST_F(JoypadTest, Read)
+{
+    EXPECT_EQ(0xFF, _joypad.read(0));
+
+    _joypad.setPressed(gb::Joypad::ButtonDown, true);
+    _joypad.setPressed(gb::Joypad::ButtonStart, true);
+    EXPECT_EQ(0xFF, _joypad.read(0));
+
+    _joypad.write(0, 0x20);
+    EXPECT_EQ(0xE7, _joypad.read(0));
+    _joypad.write(0, 0x10);
+    EXPECT_EQ(0xD7, _joypad.read(0));
+    _joypad.write(0, 0x00);
+    EXPECT_EQ(0xC7, _joypad.read(0));
+
+    _joypad.setPressed(gb::Joypad::ButtonDown, false);
+    EXPECT_EQ(0xC7, _joypad.read(0));
+    _joypad.setPressed(gb::Joypad::ButtonStart, false);
+    EXPECT_EQ(0xCF, _joypad.read(0));
+}
+
+TEST_F(JoypadTest, Interrupt)
+{
+    // Unselected rows don't interrupt
+    _joypad.write(0, 0x20);
+    _joypad.setPressed(gb::Joypad::ButtonA, true);
+    EXPECT_FALSE(_hasInterrupt());
+
+    _joypad.setPressed(gb::Joypad::ButtonLeft, true);
+    EXPECT_TRUE(_hasInterrupt());
+}
+
+TEST_F(JoypadTest, Events)
+{
+    _joypad.write(0, 0x10);
+
+    gb::Joypad::Event now = {0, gb::Joypad::ButtonB, true};
+    gb::Joypad::Event later = {200000, gb::Joypad::ButtonA, true};
+    gb::Joypad::Event release = {200000, gb::Joypad::ButtonB, false};
+    std::thread frontend([&] {
+        _joypad.post(now);
+        _joypad.post(later);
+        _joypad.post(release);
+    });
+    frontend.join();
+
+    // Nothing changes until the queue is polled
+    EXPECT_EQ(0x00, _joypad.pressed());
+    _scheduler.advanceTo(gb::Joypad::PollInterval);
+    EXPECT_EQ(0x20, _joypad.pressed());
+    EXPECT_TRUE(_hasInterrupt());
+    _interrupts.acknowledge(gb::Interrupts::InterruptJoypad);
+
+    // Future events apply at their own time
+    _scheduler.advanceTo(199999);
+    EXPECT_EQ(0x20, _joypad.pressed());
+    _scheduler.advanceTo(200000);
+    EXPECT_EQ(0x10, _joypad.pressed());
+    EXPECT_EQ(0xDE, _joypad.read(0));
+    EXPECT_TRUE(_hasInterrupt());
+}
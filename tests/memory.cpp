@@ -1,5 +1,9 @@
 #include <gtest/gtest.h>
 
+#include <cstdio>
+#include <string>
+
+#include "cpu/mappedmemory.h"
 #include "cpu/memory.h"
 #include "util/units.h"
 
@@ -39,3 +43,23 @@ TEST_F(MemoryTest, ValidAddress)
     EXPECT_FALSE(_mem.isValidAddress(0xFF));
 }
 
+
+TEST(MappedMemoryTest, Persist)
+{
+    std::string path = testing::TempDir() + "mapped_memory.bin";
+    std::remove(path.c_str());
+    {
+        gb::MappedMemory mem(path, 0x2000);
+        ASSERT_TRUE(mem.isOpen());
+        EXPECT_EQ(0x00, mem[0x1FFF]);
+        mem[0x1FFF] = 0xAB;
+        EXPECT_TRUE(mem.flush());
+    }
+
+    gb::MappedMemory mem(path, 0x2000);
+    ASSERT_TRUE(mem.isOpen());
+    EXPECT_EQ(0xAB, mem[0x1FFF]);
+    EXPECT_TRUE(mem.flush(true));
+
+    std::remove(path.c_str());
+}
@@ -0,0 +1,65 @@
+#include <gtest/gtest.h>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <sstream>
+#include <string>
+
+#include "util/metrics.h"
+
+TEST(MetricsTest, Write)
+{
+    gb::Metrics metrics;
+    gb::Metrics::Metric* cycles = metrics.add("gbe_cycles_total", "", gb::Metrics::TypeCounter, "Cycles.");
+    gb::Metrics::Metric* cpu = metrics.add("gbe_seconds_total", "subsystem=\"cpu\"", gb::Metrics::TypeCounter,
+                                           "Seconds.");
+    metrics.add("gbe_seconds_total", "subsystem=\"audio\"", gb::Metrics::TypeCounter, "Seconds.");
+    cycles->set(123456789012);
+    cpu->set(1.5);
+
+    std::stringstream ss;
+    metrics.write(ss);
+    EXPECT_EQ("# HELP gbe_cycles_total Cycles.\n"
+              "# TYPE gbe_cycles_total counter\n"
+              "gbe_cycles_total 123456789012\n"
+              "# HELP gbe_seconds_total Seconds.\n"
+              "# TYPE gbe_seconds_total counter\n"
+              "gbe_seconds_total{subsystem=\"cpu\"} 1.5\n"
+              "gbe_seconds_total{subsystem=\"audio\"} 0\n", ss.str());
+}
+
+TEST(MetricsTest, Serve)
+{
+    std::string path = testing::TempDir() + "gbe-metrics.sock";
+    gb::Metrics metrics;
+    metrics.add("gbe_frames_total", "", gb::Metrics::TypeCounter, "Frames.")->set(42);
+    ASSERT_TRUE(metrics.listen(path));
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    std::strcpy(addr.sun_path, path.c_str());
+    ASSERT_EQ(0, connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)));
+
+    const char request[] = "GET /metrics HTTP/1.0\r\n\r\n";
+    ASSERT_EQ(static_cast<ssize_t>(sizeof(request) - 1), send(fd, request, sizeof(request) - 1, 0));
+
+    std::string response;
+    char buf[256];
+    ssize_t n = 0;
+    while ((n = recv(fd, buf, sizeof(buf), 0)) > 0) {
+        response.append(buf, n);
+    }
+    close(fd);
+
+    EXPECT_EQ(0, response.find("HTTP/1.0 200 OK\r\n"));
+    EXPECT_NE(std::string::npos, response.find("\r\n\r\n# HELP gbe_frames_total Frames.\n"));
+    EXPECT_NE(std::string::npos, response.find("gbe_frames_total 42\n"));
+
+    metrics.close();
+    EXPECT_NE(0, access(path.c_str(), F_OK));
+}
@@ -50,3 +50,103 @@ TEST_F(MMUTest, ValidAddress)
     EXPECT_FALSE(_mmu.isValidAddress(0x110));
 }
 
+
+TEST_F(MMUTest, ReadWrite)
+{
+    _mmu.write(0x02, 7);
+    _mmu.write(0x104, 9);
+    EXPECT_EQ(7, _mem1[0x12]);
+    EXPECT_EQ(9, _mem2[0x04]);
+    EXPECT_EQ(7, _mmu.read(0x02));
+    EXPECT_EQ(9, _mmu.read(0x104));
+}
+
+class Register : public gb::Addressable
+{
+public:
+    Register() : reads(0), writes(0), value(0) { }
+
+    virtual gb::Byte& operator[](size_t address) override { return value; }
+    virtual bool isValidAddress(size_t address) const override { return address == 0; }
+    virtual gb::Byte read(size_t address) override { ++reads; return value; }
+    virtual void write(size_t address, gb::Byte val) override { ++writes; value = val; }
+
+    int reads;
+    int writes;
+    gb::Byte value;
+};
+
+TEST(MMUPageTest, HandlerPage)
+{
+    gb::MMU mmu;
+    gb::Memory ram(0x100);
+    Register reg;
+    mmu.map(&ram, gb::Range(0x00, 0x7F), gb::Range(0xFF80, 0xFFFF));
+    mmu.map(&reg, gb::Range(0x00, 0x00), gb::Range(0xFF04, 0xFF04));
+
+    mmu.write(0xFF04, 0x12);
+    EXPECT_EQ(0x12, mmu.read(0xFF04));
+    EXPECT_EQ(1, reg.writes);
+    EXPECT_EQ(1, reg.reads);
+
+    mmu.write(0xFF81, 0x34);
+    EXPECT_EQ(0x34, ram[0x01]);
+    EXPECT_TRUE(mmu.isValidAddress(0xFF04));
+    EXPECT_FALSE(mmu.isValidAddress(0xFF05));
+    EXPECT_FALSE(mmu.isValidAddress(0xFF7F));
+}
+
+TEST(MMUPageTest, Remap)
+{
+    gb::MMU mmu;
+    gb::Memory banks(0x4000);
+    for (size_t i = 0; i < banks.size(); ++i) {
+        banks[i] = i >> 12;
+    }
+    mmu.map(&banks, gb::Range(0x0000, 0x0FFF), gb::Range(0x4000, 0x4FFF));
+    EXPECT_EQ(0, mmu.read(0x4123));
+
+    mmu.remap(&banks, gb::Range(0x2000, 0x2FFF), gb::Range(0x4000, 0x4FFF));
+    EXPECT_EQ(2, mmu.read(0x4123));
+    mmu.write(0x4000, 0xAA);
+    EXPECT_EQ(0xAA, banks[0x2000]);
+}
+
+TEST(MMUPageTest, DirectData)
+{
+    gb::MMU mmu;
+    gb::Memory ram(0x2000);
+    gb::Memory oam(0xA0);
+    Register reg;
+    mmu.map(&ram, gb::Range(0x0000, 0x1FFF), gb::Range(0xC000, 0xDFFF));
+    mmu.map(&oam, gb::Range(0x00, 0x9F), gb::Range(0xFE00, 0xFE9F));
+    mmu.map(&reg, gb::Range(0x00, 0x00), gb::Range(0xFF46, 0xFF46));
+
+    EXPECT_EQ(ram.data() + 0x100, mmu.directData(0xC100, 0x200));
+    EXPECT_EQ(oam.data(), mmu.directData(0xFE00, 0xA0));
+    EXPECT_EQ(nullptr, mmu.directData(0xFE00, 0xA1));
+    EXPECT_EQ(nullptr, mmu.directData(0xFF46, 1));
+}
+
+TEST(MMUPageTest, Copy)
+{
+    gb::MMU mmu;
+    gb::Memory ram(0x100);
+    gb::Memory oam(0xA0);
+    Register reg;
+    mmu.map(&ram, gb::Range(0x00, 0xFF), gb::Range(0xC000, 0xC0FF));
+    mmu.map(&oam, gb::Range(0x00, 0x9F), gb::Range(0xFE00, 0xFE9F));
+    mmu.map(&reg, gb::Range(0x00, 0x00), gb::Range(0xFF46, 0xFF46));
+    for (size_t i = 0; i < ram.size(); ++i) {
+        ram[i] = i;
+    }
+
+    mmu.copy(0xFE00, 0xC010, 0xA0);
+    EXPECT_EQ(0x10, oam[0x00]);
+    EXPECT_EQ(0xAF, oam[0x9F]);
+
+    // Handler pages are copied through read() and write()
+    mmu.copy(0xFF46, 0xC005, 1);
+    EXPECT_EQ(0x05, reg.value);
+    EXPECT_EQ(1, reg.writes);
+}
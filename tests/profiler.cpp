@@ -0,0 +1,71 @@
+#include <gtest/gtest.h>
+
+#include <sstream>
+
+#include "cpu/cpu.h"
+#include "cpu/memory.h"
+#include "cpu/profiler.h"
+
+TEST(ProfilerTest, Counts)
+{
+    gb::Profiler profiler;
+    profiler.record(0x0100, 0x3C, 4);
+    profiler.record(0x0100, 0x3C, 4);
+    profiler.record(0x0101, 0x100 + 0x37, 8);
+
+    EXPECT_EQ(2, profiler.opcodeCount(0x3C));
+    EXPECT_EQ(8, profiler.opcodeCycles(0x3C));
+    EXPECT_EQ(1, profiler.opcodeCount(0x137));
+    EXPECT_EQ(2, profiler.pcCount(0x0100));
+    EXPECT_EQ(8, profiler.pcCycles(0x0101));
+    EXPECT_EQ(3, profiler.instructions());
+    EXPECT_EQ(16, profiler.cycles());
+
+    EXPECT_EQ("3c", gb::Profiler::opcodeName(0x3C));
+    EXPECT_EQ("cb 37", gb::Profiler::opcodeName(0x137));
+}
+
+TEST(ProfilerTest, Json)
+{
+    gb::Profiler profiler;
+    profiler.record(0x0100, 0x00, 4);
+    profiler.record(0x0101, 0x100 + 0x37, 8);
+
+    std::stringstream ss;
+    profiler.writeJson(ss);
+    std::string json = ss.str();
+
+    // Sorted by cycles, so the CB opcode comes first
+    size_t cb = json.find("{\"opcode\": \"cb 37\", \"count\": 1, \"cycles\": 8}");
+    size_t nop = json.find("{\"opcode\": \"00\", \"count\": 1, \"cycles\": 4}");
+    EXPECT_NE(std::string::npos, cb);
+    EXPECT_NE(std::string::npos, nop);
+    EXPECT_LT(cb, nop);
+    EXPECT_NE(std::string::npos, json.find("{\"pc\": 257, \"count\": 1, \"cycles\": 8}"));
+    EXPECT_NE(std::string::npos, json.find("\"instructions\": 2,"));
+}
+
+TEST(ProfilerTest, Cpu)
+{
+    // NOP; SWAP A
+    gb::Memory mem(0x10000);
+    std::fill(mem.data(), mem.data() + mem.size(), 0x00);
+    mem[0x0001] = 0xCB;
+    mem[0x0002] = 0x37;
+
+    gb::Profiler profiler;
+    gb::Cpu cpu;
+    cpu.setMemory(&mem);
+    cpu.setProfiler(&profiler);
+    cpu.processNextInstruction();
+    cpu.processNextInstruction();
+
+    if (!gb::IsProfileEnabled) {
+        EXPECT_EQ(0, profiler.instructions());
+        return;
+    }
+
+    EXPECT_EQ(1, profiler.opcodeCount(0x00));
+    EXPECT_EQ(1, profiler.opcodeCount(gb::Profiler::CbOpcodes + 0x37));
+    EXPECT_EQ(8, profiler.pcCycles(0x0001));
+}
@@ -0,0 +1,69 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+#include "util/ringbuffer.h"
+
+TEST(RingBufferTest, Capacity)
+{
+    gb::RingBuffer<int> ring(100);
+    EXPECT_EQ(128, ring.capacity());
+    EXPECT_EQ(0, ring.size());
+}
+
+TEST(RingBufferTest, WrapAround)
+{
+    gb::RingBuffer<int> ring(8);
+    int in[6] = {1, 2, 3, 4, 5, 6};
+    int out[8] = {0};
+
+    EXPECT_EQ(6, ring.write(in, 6));
+    EXPECT_EQ(4, ring.read(out, 4));
+    EXPECT_EQ(4, out[3]);
+
+    // Only 6 fit, wrapping past the end
+    EXPECT_EQ(6, ring.write(in, 6));
+    EXPECT_EQ(0, ring.write(in, 6));
+    EXPECT_EQ(8, ring.size());
+
+    EXPECT_EQ(8, ring.read(out, 8));
+    int expected[8] = {5, 6, 1, 2, 3, 4, 5, 6};
+    for (int i = 0; i < 8; ++i) {
+        EXPECT_EQ(expected[i], out[i]);
+    }
+    EXPECT_EQ(0, ring.read(out, 8));
+}
+
+TEST(RingBufferTest, Threads)
+{
+    const int Count = 100000;
+    gb::RingBuffer<int> ring(64);
+
+    std::thread producer([&ring] {
+        int next = 0;
+        while (next < Count) {
+            int chunk[7];
+            int n = std::min(7, Count - next);
+            for (int i = 0; i < n; ++i) {
+                chunk[i] = next + i;
+            }
+            next += ring.write(chunk, n);
+        }
+    });
+
+    int expected = 0;
+    bool isOrdered = true;
+    while (expected < Count) {
+        int chunk[5];
+        size_t n = ring.read(chunk, 5);
+        for (size_t i = 0; i < n; ++i) {
+            isOrdered = isOrdered && chunk[i] == expected++;
+        }
+    }
+    producer.join();
+
+    EXPECT_TRUE(isOrdered);
+    EXPECT_EQ(0, ring.size());
+}
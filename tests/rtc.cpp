@@ -0,0 +1,87 @@
+#include <gtest/gtest.h>
+
+#include "cpu/rtc.h"
+#include "cpu/scheduler.h"
+
+class RtcTest : public testing::Test
+{
+protected:
+
+    RtcTest()
+    {
+        _rtc.setScheduler(&_scheduler);
+    }
+
+    gb::Byte _readLatched(gb::Rtc::Register reg)
+    {
+        _rtc.select(reg);
+        return _rtc.read(0x0000);
+    }
+
+    void _write(gb::Rtc::Register reg, gb::Byte val)
+    {
+        _rtc.select(reg);
+        _rtc.write(0x0000, val);
+    }
+
+    gb::Scheduler _scheduler;
+    gb::Rtc _rtc;
+};
+
+TEST_F(RtcTest, Latch)
+{
+    _scheduler.advanceTo(61*gb::Rtc::CyclesPerSecond + 10);
+    EXPECT_EQ(0, _readLatched(gb::Rtc::RegSeconds));
+
+    _rtc.latch();
+    EXPECT_EQ(1, _readLatched(gb::Rtc::RegSeconds));
+    EXPECT_EQ(1, _readLatched(gb::Rtc::RegMinutes));
+
+    // Latched values don't move until the next latch
+    _scheduler.advanceTo(3700*gb::Rtc::CyclesPerSecond);
+    EXPECT_EQ(1, _readLatched(gb::Rtc::RegMinutes));
+    _rtc.latch();
+    EXPECT_EQ(40, _readLatched(gb::Rtc::RegSeconds));
+    EXPECT_EQ(1, _readLatched(gb::Rtc::RegMinutes));
+    EXPECT_EQ(1, _readLatched(gb::Rtc::RegHours));
+}
+
+TEST_F(RtcTest, WriteAndHalt)
+{
+    _write(gb::Rtc::RegDaysHigh, gb::Rtc::DaysHighHalt);
+    _write(gb::Rtc::RegHours, 23);
+    _write(gb::Rtc::RegMinutes, 59);
+    _write(gb::Rtc::RegSeconds, 59);
+    _write(gb::Rtc::RegDaysLow, 0xFF);
+
+    // Halted clocks don't move
+    _scheduler.advanceTo(10*gb::Rtc::CyclesPerSecond);
+    _rtc.latch();
+    EXPECT_EQ(59, _readLatched(gb::Rtc::RegSeconds));
+
+    _write(gb::Rtc::RegDaysHigh, gb::Rtc::DaysHighDay8);
+    _scheduler.advanceTo(11*gb::Rtc::CyclesPerSecond);
+    _rtc.latch();
+    EXPECT_EQ(0, _readLatched(gb::Rtc::RegSeconds));
+    EXPECT_EQ(0, _readLatched(gb::Rtc::RegHours));
+    EXPECT_EQ(0, _readLatched(gb::Rtc::RegDaysLow));
+    EXPECT_EQ(gb::Rtc::DaysHighCarry, _readLatched(gb::Rtc::RegDaysHigh));
+}
+
+TEST_F(RtcTest, SaveLoad)
+{
+    _write(gb::Rtc::RegMinutes, 12);
+    _scheduler.advanceTo(5*gb::Rtc::CyclesPerSecond);
+    _rtc.latch();
+
+    gb::Byte data[gb::Rtc::SaveSize];
+    _rtc.save(data);
+
+    gb::Rtc loaded;
+    loaded.load(data);
+    loaded.select(gb::Rtc::RegSeconds);
+    EXPECT_EQ(5, loaded.read(0x0000));
+    loaded.latch();
+    loaded.select(gb::Rtc::RegMinutes);
+    EXPECT_EQ(12, loaded.read(0x0000));
+}
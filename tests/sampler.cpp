@@ -0,0 +1,93 @@
+#include <gtest/gtest.h>
+
+#include <sstream>
+
+#include "cpu/cpu.h"
+#include "cpu/memory.h"
+#include "cpu/profiler.h"
+#include "cpu/sampler.h"
+#include "cpu/scheduler.h"
+#include "util/symbols.h"
+
+class SamplerTest : public testing::Test
+{
+protected:
+
+    SamplerTest() :
+        _mem(0x10000),
+        _sampler(&_cpu, &_scheduler, 100)
+    {
+        std::fill(_mem.data(), _mem.data() + _mem.size(), 0x00);
+        _cpu.setMemory(&_mem);
+        _cpu.setScheduler(&_scheduler);
+        _cpu.setSampler(&_sampler);
+        _cpu.registers().SP = 0xFFFE;
+    }
+
+    gb::Memory _mem;
+    gb::Scheduler _scheduler;
+    gb::Cpu _cpu;
+    gb::Sampler _sampler;
+};
+
+TEST_F(SamplerTest, ShadowStack)
+{
+    _sampler.onCall(0x0200, 0xFFFC);
+    _sampler.onCall(0x0300, 0xFFFA);
+    EXPECT_EQ(std::vector<uint32_t>({0x0200, 0x0300}), _sampler.callStack());
+
+    _sampler.onReturn(0xFFFA);
+    EXPECT_EQ(std::vector<uint32_t>({0x0200}), _sampler.callStack());
+
+    // A call at the same depth replaces a frame that was jumped out of
+    _sampler.onCall(0x0400, 0xFFFA);
+    _sampler.onCall(0x0500, 0xFFFA);
+    EXPECT_EQ(std::vector<uint32_t>({0x0200, 0x0500}), _sampler.callStack());
+
+    // Returning to the outermost frame unwinds everything below it
+    _sampler.onReturn(0xFFFC);
+    EXPECT_TRUE(_sampler.callStack().empty());
+}
+
+TEST_F(SamplerTest, Cpu)
+{
+    // 0x0000: CALL 0x0010; JR -2
+    // 0x0010: JR -2
+    _mem[0x0000] = 0xCD;
+    _mem[0x0001] = 0x10;
+    _mem[0x0002] = 0x00;
+    _mem[0x0003] = 0x18;
+    _mem[0x0004] = 0xFE;
+    _mem[0x0010] = 0x18;
+    _mem[0x0011] = 0xFE;
+
+    while (_cpu.cycles() < 1000) {
+        _cpu.processNextInstruction();
+    }
+    EXPECT_EQ(10, _sampler.samples());
+
+    if (!gb::IsProfileEnabled) {
+        return;
+    }
+
+    ASSERT_EQ(1, _sampler.stacks().size());
+    std::vector<uint32_t> stack({0x0010, 0x0010});
+    EXPECT_EQ(10, _sampler.stacks().at(stack));
+}
+
+TEST_F(SamplerTest, Folded)
+{
+    _sampler.onCall(0x0200, 0xFFFC);
+    _scheduler.advanceTo(100);
+    _sampler.onCall(0x0300, 0xFFFA);
+    _scheduler.advanceTo(200);
+    _scheduler.advanceTo(300);
+
+    gb::SymbolTable symbols;
+    symbols.add(0, 0x0200, "Outer");
+    symbols.add(0, 0x0300, "Inner");
+
+    std::stringstream ss;
+    _sampler.writeFolded(ss, symbols);
+    EXPECT_EQ("Outer;0000 1\nOuter;Inner;0000 2\n", ss.str());
+}
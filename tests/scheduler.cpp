@@ -0,0 +1,62 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "cpu/scheduler.h"
+
+TEST(SchedulerTest, RunsDueEventsInOrder)
+{
+    gb::Scheduler scheduler;
+    std::vector<int> order;
+    gb::Scheduler::EventId a = scheduler.addEvent([&](uint64_t) { order.push_back(1); });
+    gb::Scheduler::EventId b = scheduler.addEvent([&](uint64_t) { order.push_back(2); });
+
+    scheduler.schedule(a, 100);
+    scheduler.schedule(b, 50);
+    EXPECT_EQ(50, scheduler.nextEventTime());
+
+    scheduler.advanceTo(49);
+    EXPECT_TRUE(order.empty());
+
+    scheduler.advanceTo(120);
+    ASSERT_EQ(2, order.size());
+    EXPECT_EQ(2, order[0]);
+    EXPECT_EQ(1, order[1]);
+    EXPECT_FALSE(scheduler.isScheduled(a));
+    EXPECT_EQ(gb::Scheduler::Never, scheduler.nextEventTime());
+}
+
+TEST(SchedulerTest, Reschedule)
+{
+    gb::Scheduler scheduler;
+    std::vector<uint64_t> times;
+    gb::Scheduler::EventId e = 0;
+    e = scheduler.addEvent([&](uint64_t when) {
+        times.push_back(when);
+        scheduler.schedule(e, when + 10);
+    });
+
+    scheduler.schedule(e, 10);
+    scheduler.advanceTo(35);
+    ASSERT_EQ(3, times.size());
+    EXPECT_EQ(10, times[0]);
+    EXPECT_EQ(20, times[1]);
+    EXPECT_EQ(30, times[2]);
+    EXPECT_EQ(40, scheduler.nextEventTime());
+
+    scheduler.cancel(e);
+    scheduler.advanceTo(100);
+    EXPECT_EQ(3, times.size());
+}
+
+TEST(SchedulerTest, Reset)
+{
+    gb::Scheduler scheduler;
+    gb::Scheduler::EventId e = scheduler.addEvent([](uint64_t) {});
+    scheduler.schedule(e, 10);
+    scheduler.advanceTo(5);
+
+    scheduler.reset();
+    EXPECT_EQ(0, scheduler.now());
+    EXPECT_FALSE(scheduler.isScheduled(e));
+}
@@ -0,0 +1,167 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+
+#include "cpu/interrupts.h"
+#include "cpu/linkcable.h"
+#include "cpu/scheduler.h"
+#include "cpu/serial.h"
+
+namespace {
+
+struct Port
+{
+    Port() :
+        serial(&scheduler, &interrupts)
+    {
+    }
+
+    void run(uint64_t until)
+    {
+        while (scheduler.now() < until) {
+            scheduler.advanceTo(scheduler.now() + 4);
+        }
+    }
+
+    gb::Scheduler scheduler;
+    gb::Interrupts interrupts;
+    gb::Serial serial;
+};
+
+bool hasSerialInterrupt(Port& port)
+{
+    return (port.interrupts.read(gb::Interrupts::RegIF) & (1 << gb::Interrupts::InterruptSerial)) != 0;
+}
+
+}
+
+TEST(SerialTest, Unconnected)
+{
+    Port port;
+    port.serial.write(gb::Serial::RegSB, 'A');
+    port.serial.write(gb::Serial::RegSC, 0x81);
+    EXPECT_EQ(0xFF, port.serial.read(gb::Serial::RegSC));
+    EXPECT_EQ("A", port.serial.output());
+
+    port.run(gb::Serial::TransferCycles - 4);
+    EXPECT_TRUE(port.serial.isTransferring());
+    port.run(gb::Serial::TransferCycles);
+    EXPECT_FALSE(port.serial.isTransferring());
+    EXPECT_EQ(0xFF, port.serial.read(gb::Serial::RegSB));
+    EXPECT_EQ(0x7F, port.serial.read(gb::Serial::RegSC));
+    EXPECT_TRUE(hasSerialInterrupt(port));
+
+    // The external clock never comes
+    port.serial.write(gb::Serial::RegSC, 0x80);
+    port.run(4*gb::Serial::TransferCycles);
+    EXPECT_TRUE(port.serial.isTransferring());
+}
+
+TEST(SerialTest, ReplyTime)
+{
+    // Whether the slave is ready is judged ReplyDelay after the start, on
+    // its own clock, whichever thread happens to run first
+    const uint64_t armTimes[] = {gb::Serial::ReplyDelay - 64, gb::Serial::ReplyDelay + 64};
+    for (uint64_t armTime : armTimes) {
+        for (int i = 0; i < 20; ++i) {
+            gb::LinkCable cable;
+            Port master;
+            Port slave;
+            master.serial.connect(&cable, 0);
+            slave.serial.connect(&cable, 1);
+
+            std::thread masterThread([&master] {
+                master.serial.write(gb::Serial::RegSB, 0x12);
+                master.serial.write(gb::Serial::RegSC, 0x81);
+                master.run(4*gb::Serial::TransferCycles);
+                master.serial.disconnect();
+            });
+            std::thread slaveThread([&slave, armTime] {
+                slave.run(armTime);
+                slave.serial.write(gb::Serial::RegSB, 0x34);
+                slave.serial.write(gb::Serial::RegSC, 0x80);
+                slave.run(4*gb::Serial::TransferCycles);
+                slave.serial.disconnect();
+            });
+            masterThread.join();
+            slaveThread.join();
+
+            bool isInTime = armTime < gb::Serial::ReplyDelay;
+            EXPECT_EQ(isInTime ? 0x34 : 0xFF, master.serial.read(gb::Serial::RegSB));
+            EXPECT_EQ(!isInTime, slave.serial.isTransferring());
+        }
+    }
+}
+
+TEST(SerialTest, FullInbox)
+{
+    gb::LinkCable cable;
+    Port master;
+    master.serial.connect(&cable, 0);
+
+    // A first transfer leaves a reply behind
+    master.serial.write(gb::Serial::RegSB, 0x12);
+    master.serial.write(gb::Serial::RegSC, 0x81);
+    gb::LinkCable::Message reply = {gb::LinkCable::Message::TypeReply, 0x34, 0};
+    ASSERT_TRUE(cable.send(1, reply));
+    master.run(gb::Serial::TransferCycles);
+    EXPECT_EQ(0x34, master.serial.read(gb::Serial::RegSB));
+
+    // The next start can't be sent, so nothing answers it
+    gb::LinkCable::Message start = {gb::LinkCable::Message::TypeStart, 0x00, 0};
+    while (cable.send(0, start)) {
+    }
+    master.serial.write(gb::Serial::RegSB, 0x56);
+    master.serial.write(gb::Serial::RegSC, 0x81);
+    master.run(2*gb::Serial::TransferCycles);
+    EXPECT_FALSE(master.serial.isTransferring());
+    EXPECT_EQ(0xFF, master.serial.read(gb::Serial::RegSB));
+}
+
+TEST(SerialTest, LinkedThreads)
+{
+    gb::LinkCable cable;
+    Port master;
+    Port slave;
+    master.serial.connect(&cable, 0);
+    slave.serial.connect(&cable, 1);
+
+    slave.serial.write(gb::Serial::RegSB, 0x34);
+    slave.serial.write(gb::Serial::RegSC, 0x80);
+    master.serial.write(gb::Serial::RegSB, 0x12);
+    master.serial.write(gb::Serial::RegSC, 0x81);
+
+    std::atomic<uint64_t> maxLead(0);
+    std::thread masterThread([&master] {
+        master.run(200000);
+        master.serial.disconnect();
+    });
+    std::thread slaveThread([&slave, &cable, &maxLead] {
+        while (slave.scheduler.now() < 200000) {
+            // Run slower than the master
+            slave.scheduler.advanceTo(slave.scheduler.now() + 4);
+            if (slave.scheduler.now() % 256 == 0) {
+                std::this_thread::yield();
+            }
+
+            uint64_t partner = cable.partnerClock(1);
+            uint64_t now = slave.scheduler.now();
+            if (partner != UINT64_MAX && partner > now && partner - now > maxLead) {
+                maxLead = partner - now;
+            }
+        }
+        slave.serial.disconnect();
+    });
+    masterThread.join();
+    slaveThread.join();
+
+    EXPECT_EQ(0x34, master.serial.read(gb::Serial::RegSB));
+    EXPECT_EQ(0x12, slave.serial.read(gb::Serial::RegSB));
+    EXPECT_TRUE(hasSerialInterrupt(master));
+    EXPECT_TRUE(hasSerialInterrupt(slave));
+    EXPECT_EQ(std::string(1, 0x34), slave.serial.output());
+    EXPECT_LE(maxLead, gb::Serial::MaxSkew + gb::Serial::SyncQuantum);
+}
@@ -0,0 +1,49 @@
+#include <gtest/gtest.h>
+
+#include <sstream>
+
+#include "util/symbols.h"
+
+TEST(SymbolTableTest, Load)
+{
+    std::stringstream sym(
+        "; File generated by rgblink\n"
+        "00:0150 Main\n"
+        "00:0158 Main.loop\n"
+        "00:0200 Wait ; trailing comment\n"
+        "01:4000 BankedInit\n"
+        "00:c000 wBuffer\n");
+
+    gb::SymbolTable symbols;
+    EXPECT_TRUE(symbols.load(sym));
+    EXPECT_EQ(4, symbols.size());
+
+    // Local labels resolve to their function
+    EXPECT_EQ("Main", symbols.name(0, 0x0150));
+    EXPECT_EQ("Main", symbols.name(0, 0x0160));
+    EXPECT_EQ("Wait", symbols.name(0, 0x0210));
+    EXPECT_EQ("BankedInit", symbols.name(1, 0x4100));
+    EXPECT_EQ("wBuffer", symbols.name(0, 0xC010));
+
+    // Never across banks or memory areas
+    EXPECT_EQ("0100", symbols.name(0, 0x0100));
+    EXPECT_EQ("02:4100", symbols.name(2, 0x4100));
+    EXPECT_EQ(nullptr, symbols.find(0, 0x4100));
+}
+
+TEST(SymbolTableTest, Add)
+{
+    gb::SymbolTable symbols;
+    symbols.add(0, 0x0200, "Second");
+    symbols.add(0, 0x0100, "First");
+    EXPECT_EQ("First", symbols.name(0, 0x01FF));
+    EXPECT_EQ("Second", symbols.name(0, 0x0200));
+}
+
+TEST(SymbolTableTest, Invalid)
+{
+    std::stringstream sym("0150 Main\n");
+    gb::SymbolTable symbols;
+    EXPECT_FALSE(symbols.load(sym));
+    EXPECT_FALSE(symbols.load(testing::TempDir() + "missing.sym"));
+}
@@ -0,0 +1,89 @@
+#include <gtest/gtest.h>
+
+#include "cpu/interrupts.h"
+#include "cpu/scheduler.h"
+#include "cpu/timer.h"
+
+class TimerTest : public testing::Test
+{
+protected:
+
+    TimerTest() :
+        _timer(&_scheduler, &_interrupts)
+    {
+        _interrupts.write(gb::Interrupts::RegIE, 0xFF);
+    }
+
+    bool _timerRequested()
+    {
+        return (_interrupts.pending() & (1 << gb::Interrupts::InterruptTimer)) != 0;
+    }
+
+    gb::Scheduler _scheduler;
+    gb::Interrupts _interrupts;
+    gb::Timer _timer;
+};
+
+TEST_F(TimerTest, Div)
+{
+    EXPECT_EQ(0x00, _timer.read(gb::Timer::RegDIV));
+    _scheduler.advanceTo(255);
+    EXPECT_EQ(0x00, _timer.read(gb::Timer::RegDIV));
+    _scheduler.advanceTo(256);
+    EXPECT_EQ(0x01, _timer.read(gb::Timer::RegDIV));
+    _scheduler.advanceTo(256*0x42 + 10);
+    EXPECT_EQ(0x42, _timer.read(gb::Timer::RegDIV));
+
+    // Any write resets it
+    _timer.write(gb::Timer::RegDIV, 0x99);
+    EXPECT_EQ(0x00, _timer.read(gb::Timer::RegDIV));
+    _scheduler.advanceTo(256*0x43 + 10);
+    EXPECT_EQ(0x01, _timer.read(gb::Timer::RegDIV));
+}
+
+TEST_F(TimerTest, TimaDisabled)
+{
+    _timer.write(gb::Timer::RegTAC, 0x01);
+    _scheduler.advanceTo(10000);
+    EXPECT_EQ(0x00, _timer.read(gb::Timer::RegTIMA));
+    EXPECT_EQ(0xF9, _timer.read(gb::Timer::RegTAC));
+    EXPECT_EQ(gb::Scheduler::Never, _scheduler.nextEventTime());
+}
+
+TEST_F(TimerTest, TimaCounts)
+{
+    // 16 cycles per increment
+    _timer.write(gb::Timer::RegTAC, 0x05);
+    _scheduler.advanceTo(15);
+    EXPECT_EQ(0x00, _timer.read(gb::Timer::RegTIMA));
+    _scheduler.advanceTo(16);
+    EXPECT_EQ(0x01, _timer.read(gb::Timer::RegTIMA));
+    _scheduler.advanceTo(16*0x80 + 3);
+    EXPECT_EQ(0x80, _timer.read(gb::Timer::RegTIMA));
+
+    // Switching to 1024 cycles per increment keeps the current count
+    _timer.write(gb::Timer::RegTAC, 0x04);
+    _scheduler.advanceTo(3071);
+    EXPECT_EQ(0x80, _timer.read(gb::Timer::RegTIMA));
+    _scheduler.advanceTo(3072);
+    EXPECT_EQ(0x81, _timer.read(gb::Timer::RegTIMA));
+}
+
+TEST_F(TimerTest, TimaOverflow)
+{
+    _timer.write(gb::Timer::RegTMA, 0xF0);
+    _timer.write(gb::Timer::RegTIMA, 0xFE);
+    _timer.write(gb::Timer::RegTAC, 0x05);
+    EXPECT_EQ(32, _scheduler.nextEventTime());
+
+    _scheduler.advanceTo(31);
+    EXPECT_FALSE(_timerRequested());
+    EXPECT_EQ(0xFF, _timer.read(gb::Timer::RegTIMA));
+
+    _scheduler.advanceTo(40);
+    EXPECT_TRUE(_timerRequested());
+    EXPECT_EQ(0xF0, _timer.read(gb::Timer::RegTIMA));
+
+    // Next overflow after another 16 increments of 16 cycles
+    EXPECT_EQ(32 + 16*16, _scheduler.nextEventTime());
+}
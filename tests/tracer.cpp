@@ -0,0 +1,78 @@
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "cpu/cpu.h"
+#include "cpu/memory.h"
+#include "cpu/tracer.h"
+
+TEST(TracerTest, Ring)
+{
+    gb::Tracer tracer(3);
+    EXPECT_EQ(4, tracer.capacity());
+
+    gb::Cpu::Registers regs = {};
+    for (int i = 0; i < 6; ++i) {
+        regs.AF = i;
+        tracer.record(i*4, 0x100 + i, regs, 0x3C);
+    }
+
+    std::vector<gb::TraceRecord> records = tracer.records();
+    ASSERT_EQ(4, records.size());
+    EXPECT_EQ(6, tracer.count());
+    EXPECT_EQ(8, records[0].cycles);
+    EXPECT_EQ(0x102, records[0].pc);
+    EXPECT_EQ(0x105, records[3].pc);
+    EXPECT_EQ(5, records[3].af);
+}
+
+TEST(TracerTest, SaveLoad)
+{
+    gb::Tracer tracer(16);
+    gb::Cpu::Registers regs = {};
+    regs.BC = 0x1234;
+    regs.SP = 0xFFFE;
+    tracer.record(0x123456789ULL, 0x0150, regs, 0xCB);
+
+    std::string path = testing::TempDir() + "trace.bin";
+    ASSERT_TRUE(tracer.save(path));
+
+    std::vector<gb::TraceRecord> records;
+    ASSERT_TRUE(gb::loadTrace(path, records));
+    ASSERT_EQ(1, records.size());
+    EXPECT_EQ(0x123456789ULL, records[0].cycles);
+    EXPECT_EQ(0x0150, records[0].pc);
+    EXPECT_EQ(0x1234, records[0].bc);
+    EXPECT_EQ(0xFFFE, records[0].sp);
+    EXPECT_EQ(0xCB, records[0].opcode);
+    std::remove(path.c_str());
+
+    EXPECT_FALSE(gb::loadTrace(path, records));
+}
+
+TEST(TracerTest, Cpu)
+{
+    gb::Memory mem(0x10000);
+    std::fill(mem.data(), mem.data() + mem.size(), 0x00);
+    mem[0x0001] = 0x3C;
+
+    gb::Tracer tracer(16);
+    gb::Cpu cpu;
+    cpu.setMemory(&mem);
+    cpu.setTracer(&tracer);
+    cpu.processNextInstruction();
+    cpu.processNextInstruction();
+
+    if (!gb::IsTraceEnabled) {
+        EXPECT_EQ(0, tracer.count());
+        return;
+    }
+
+    std::vector<gb::TraceRecord> records = tracer.records();
+    ASSERT_EQ(2, records.size());
+    EXPECT_EQ(0x0001, records[1].pc);
+    EXPECT_EQ(0x3C, records[1].opcode);
+    EXPECT_EQ(4, records[1].cycles);
+}